@@ -0,0 +1,57 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct BenchOptions {
+    int iterations = 200;
+    int warmup = 10;
+    std::string scripts_dir = "scripts";
+    bool render = true;
+    bool ruby = true;
+};
+
+struct BenchResult {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> params;
+    std::vector<double> samples_us;
+};
+
+// Collects timed samples and writes them as one JSON document
+class BenchReport {
+public:
+    // Times body() individually for `iterations` runs after `warmup` untimed ones
+    template<typename F>
+    BenchResult& measure(const std::string& name, int warmup, int iterations, F&& body) {
+        for (int i = 0; i < warmup; ++i) {
+            body();
+        }
+        BenchResult result;
+        result.name = name;
+        result.samples_us.reserve(iterations);
+        for (int i = 0; i < iterations; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            result.samples_us.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+        }
+        results.push_back(std::move(result));
+        return results.back();
+    }
+
+    void note(const std::string& key, const std::string& value) {
+        meta.emplace_back(key, value);
+    }
+
+    void write_json(std::ostream& out) const;
+
+private:
+    std::vector<BenchResult> results;
+    std::vector<std::pair<std::string, std::string>> meta;
+};
+
+void run_render_benchmarks(BenchReport& report, const BenchOptions& options);
+void run_ruby_benchmarks(BenchReport& report, const BenchOptions& options);
@@ -0,0 +1,127 @@
+#include "bench_harness.hpp"
+#include "utils/log.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+std::string escape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+double percentile(std::vector<double> sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(std::ceil(p * sorted.size())) - 1;
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+void usage() {
+    std::cerr << "usage: modernx_bench [--output FILE] [--iterations N] [--scripts DIR] [--only render|ruby]\n";
+}
+
+} // namespace
+
+void BenchReport::write_json(std::ostream& out) const {
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"meta\": {";
+    for (size_t i = 0; i < meta.size(); ++i) {
+        out << (i ? ", " : "") << "\"" << escape(meta[i].first) << "\": \"" << escape(meta[i].second) << "\"";
+    }
+    out << "},\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        std::vector<double> sorted = r.samples_us;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double sample : sorted) {
+            sum += sample;
+        }
+        double mean = sorted.empty() ? 0.0 : sum / sorted.size();
+
+        out << "    {\"name\": \"" << escape(r.name) << "\", \"params\": {";
+        for (size_t j = 0; j < r.params.size(); ++j) {
+            out << (j ? ", " : "") << "\"" << escape(r.params[j].first) << "\": \"" << escape(r.params[j].second) << "\"";
+        }
+        out << "}, \"iterations\": " << sorted.size()
+            << ", \"mean_us\": " << mean
+            << ", \"min_us\": " << (sorted.empty() ? 0.0 : sorted.front())
+            << ", \"p50_us\": " << percentile(sorted, 0.50)
+            << ", \"p99_us\": " << percentile(sorted, 0.99)
+            << ", \"max_us\": " << (sorted.empty() ? 0.0 : sorted.back())
+            << ", \"ops_per_sec\": " << (mean > 0.0 ? 1e6 / mean : 0.0)
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    std::string output = "modernx_bench.json";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            options.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--scripts" && i + 1 < argc) {
+            options.scripts_dir = argv[++i];
+        } else if (arg == "--only" && i + 1 < argc) {
+            std::string only = argv[++i];
+            options.render = only == "render";
+            options.ruby = only == "ruby";
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    // Benchmarks measure the code, not the terminal
+    logging::configure("warn");
+
+    BenchReport report;
+    std::time_t now = std::time(nullptr);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    report.note("timestamp", stamp);
+    const char* display = std::getenv("DISPLAY");
+    report.note("display", display ? display : "");
+    report.note("iterations", std::to_string(options.iterations));
+
+    int status = 0;
+    try {
+        if (options.ruby) {
+            run_ruby_benchmarks(report, options);
+        }
+        if (options.render) {
+            run_render_benchmarks(report, options);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        status = 1;
+    }
+
+    std::ofstream out(output);
+    if (!out) {
+        std::cerr << "Failed to open " << output << std::endl;
+        logging::shutdown();
+        return 1;
+    }
+    report.write_json(out);
+    std::cerr << "Wrote " << output << std::endl;
+    logging::shutdown();
+    return status;
+}
@@ -0,0 +1,342 @@
+#include "bench_harness.hpp"
+#include "core/container.hpp"
+#include "gui/label.hpp"
+#include "gui/plot.hpp"
+#include "gui/image.hpp"
+#include "gui/raster_kernels.hpp"
+#include "gui/text_editor.hpp"
+#include "modules/app_module.hpp"
+#include "services/image_cache.hpp"
+#include "services/resource_cache.hpp"
+#include "services/ruby_service.hpp"
+#include "services/window_service.hpp"
+#include <X11/keysym.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <poll.h>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct WindowSize {
+    int width;
+    int height;
+};
+
+const int kLabelCounts[] = { 10, 100, 1000 };
+const WindowSize kWindowSizes[] = { { 350, 250 }, { 800, 600 }, { 1920, 1080 } };
+const RenderBackend kBackends[] = { RenderBackend::Xft, RenderBackend::Software };
+
+const char* backend_name(RenderBackend backend) {
+    return backend == RenderBackend::Software ? "software" : "xft";
+}
+
+std::unique_ptr<Label> make_label(WindowService& ws, int index, const std::string& text) {
+    int column = index % 8;
+    int row = index / 8;
+    return std::make_unique<Label>(ws.getDisplay(), ws.getWindow(), ws.getGC(), ws.getResources(),
+                                   10 + column * 230, 20 + row * 18, 220, 18,
+                                   text, "monospace-10", "#004400");
+}
+
+std::unique_ptr<TextEditor> make_editor(WindowService& ws) {
+    return std::make_unique<TextEditor>(ws.getDisplay(), ws.getWindow(), ws.getGC(), ws.getResources(),
+                                        10, 10, 780, 300, "monospace-10", "#004400");
+}
+
+std::shared_ptr<WindowService> make_window(const std::shared_ptr<IRubyService>& ruby,
+                                           RenderBackend backend = RenderBackend::Xft) {
+    return std::make_shared<WindowService>(ruby, std::make_shared<ResourceCache>(),
+                                           std::make_shared<Telemetry>(), backend);
+}
+
+XEvent key_event(WindowService& ws, KeySym sym) {
+    XEvent event = {};
+    event.xkey.type = KeyPress;
+    event.xkey.display = ws.getDisplay();
+    event.xkey.window = ws.getWindow();
+    event.xkey.root = DefaultRootWindow(ws.getDisplay());
+    event.xkey.keycode = XKeysymToKeycode(ws.getDisplay(), sym);
+    event.xkey.same_screen = True;
+    return event;
+}
+
+} // namespace
+
+void run_render_benchmarks(BenchReport& report, const BenchOptions& options) {
+    // Span kernels alone: one 1920-pixel row of glyph coverage and of a solid fill
+    {
+        report.note("raster_isa", raster::isa());
+        std::vector<uint32_t> row(1920, 0xffffff);
+        std::vector<uint8_t> mask(row.size());
+        for (size_t i = 0; i < mask.size(); ++i) {
+            mask[i] = static_cast<uint8_t>(i * 7);
+        }
+        BenchResult& blend = report.measure("raster_span", options.warmup, options.iterations, [&]() {
+            raster::blend_mask(row.data(), mask.data(), row.size(), 0x004400);
+        });
+        blend.params = { { "kernel", "blend_mask" }, { "pixels", "1920" } };
+        BenchResult& fill = report.measure("raster_span", options.warmup, options.iterations, [&]() {
+            raster::fill(row.data(), row.size(), 0xffffff);
+        });
+        fill.params = { { "kernel", "fill" }, { "pixels", "1920" } };
+    }
+
+    Display* probe = XOpenDisplay("");
+    if (!probe) {
+        report.note("render", "skipped: no X display (run under Xvfb)");
+        return;
+    }
+    XCloseDisplay(probe);
+
+    auto ruby = std::make_shared<RubyService>();
+
+    // Full-window redraw cost for N labels at several window sizes, per renderer
+    for (RenderBackend backend : kBackends) {
+        for (int count : kLabelCounts) {
+            auto ws = make_window(ruby, backend);
+            if (ws->getRenderBackend() != backend) {
+                report.note(std::string("render_") + backend_name(backend), "skipped: unsupported visual");
+                break;
+            }
+            for (int i = 0; i < count; ++i) {
+                ws->addWidget(make_label(*ws, i, "label " + std::to_string(i)));
+            }
+            for (const WindowSize& size : kWindowSizes) {
+                ws->resize(size.width, size.height);
+                ws->render_frame();
+                XSync(ws->getDisplay(), False);
+
+                BenchResult& result = report.measure("redraw_full", options.warmup, options.iterations, [&]() {
+                    ws->invalidate_all();
+                    ws->render_frame();
+                    XSync(ws->getDisplay(), False); // Until the server has the pixels
+                });
+                result.params = { { "labels", std::to_string(count) },
+                                  { "window", std::to_string(size.width) + "x" + std::to_string(size.height) },
+                                  { "backend", backend_name(backend) } };
+            }
+        }
+    }
+
+    // Key press to pixels: one typed character (or its deletion) per sample
+    for (int count : kLabelCounts) {
+        auto ws = make_window(ruby);
+        ws->setInputEditor(make_editor(*ws));
+        for (int i = 1; i < count; ++i) {
+            ws->addWidget(make_label(*ws, i, "label " + std::to_string(i)));
+        }
+        ws->resize(800, 600);
+        ws->render_frame();
+        XSync(ws->getDisplay(), False);
+
+        XEvent type_a = key_event(*ws, XK_a);
+        XEvent backspace = key_event(*ws, XK_BackSpace);
+        bool erase = false;
+        BenchResult& result = report.measure("keypress_to_pixels", options.warmup, options.iterations, [&]() {
+            XEvent event = erase ? backspace : type_a;
+            erase = !erase;
+            ws->dispatch_event(event);
+            XSync(ws->getDisplay(), False);
+        });
+        result.params = { { "labels", std::to_string(count) }, { "window", "800x600" } };
+    }
+
+    // Pointer routing alone: motion over the labels, which take no events
+    for (int count : kLabelCounts) {
+        auto ws = make_window(ruby);
+        ws->setInputEditor(make_editor(*ws));
+        for (int i = 1; i < count; ++i) {
+            ws->addWidget(make_label(*ws, i, "label " + std::to_string(i)));
+        }
+        ws->resize(800, 600);
+        ws->render_frame();
+
+        XEvent motion = {};
+        motion.xmotion.type = MotionNotify;
+        motion.xmotion.display = ws->getDisplay();
+        motion.xmotion.window = ws->getWindow();
+        int step = 0;
+        BenchResult& result = report.measure("pointer_dispatch", options.warmup, options.iterations, [&]() {
+            motion.xmotion.x = 10 + (step * 37) % 780;
+            motion.xmotion.y = 320 + (step * 13) % 270;
+            ++step;
+            ws->dispatch_event(motion);
+        });
+        result.params = { { "labels", std::to_string(count) } };
+    }
+
+    // Editing inside a large script: middle of a 5000-line buffer
+    {
+        auto ws = make_window(ruby);
+        auto editor = make_editor(*ws);
+        TextEditor* input = editor.get();
+        ws->setInputEditor(std::move(editor));
+        std::string script;
+        for (int i = 0; i < 5000; ++i) {
+            script += "value_" + std::to_string(i) + " = compute(" + std::to_string(i) + ")\n";
+        }
+        input->setText(script);
+        for (int i = 0; i < 2500; ++i) {
+            input->handleKey(XK_Up, 0, "", 0);
+        }
+        ws->resize(800, 600);
+        ws->render_frame();
+        XSync(ws->getDisplay(), False);
+
+        XEvent type_a = key_event(*ws, XK_a);
+        XEvent backspace = key_event(*ws, XK_BackSpace);
+        XEvent newline = key_event(*ws, XK_Return);
+        newline.xkey.state = ShiftMask;
+        bool erase = false;
+        BenchResult& typing = report.measure("editor_keypress", options.warmup, options.iterations, [&]() {
+            XEvent event = erase ? backspace : type_a;
+            erase = !erase;
+            ws->dispatch_event(event);
+            XSync(ws->getDisplay(), False);
+        });
+        typing.params = { { "lines", "5000" }, { "edit", "char" } };
+
+        erase = false;
+        BenchResult& split = report.measure("editor_keypress", options.warmup, options.iterations, [&]() {
+            XEvent event = erase ? backspace : newline;
+            erase = !erase;
+            ws->dispatch_event(event);
+            XSync(ws->getDisplay(), False);
+        });
+        split.params = { { "lines", "5000" }, { "edit", "newline" } };
+
+        BenchResult& paste = report.measure("editor_paste", 1, std::max(1, options.iterations / 10), [&]() {
+            input->setText("");
+            input->insert(script);
+            ws->render_frame();
+            XSync(ws->getDisplay(), False);
+        });
+        paste.params = { { "lines", "5000" } };
+    }
+
+    // Label construction with a warm (shared) and a cold (fresh) resource cache
+    {
+        auto ws = make_window(ruby);
+        // Kept alive so the cache holds the font and color for the whole loop
+        auto warm_up = make_label(*ws, 0, "warm-up");
+        BenchResult& warm = report.measure("label_construct", options.warmup, options.iterations, [&]() {
+            auto label = make_label(*ws, 1, "benchmark label");
+        });
+        warm.params = { { "cache", "warm" } };
+
+        BenchResult& cold = report.measure("label_construct", 1, std::max(1, options.iterations / 10), [&]() {
+            ResourceCache fresh;
+            fresh.attach(ws->getDisplay(), DefaultScreen(ws->getDisplay()));
+            Label label(ws->getDisplay(), ws->getWindow(), ws->getGC(), fresh,
+                        10, 20, 220, 18, "benchmark label", "monospace-10", "#004400");
+        });
+        cold.params = { { "cache", "cold" } };
+    }
+
+    // Plot redraw: column decimation should keep a million points near the cost of a thousand
+    for (RenderBackend backend : kBackends) {
+        for (size_t points : { size_t(1000), size_t(1000000) }) {
+            auto ws = make_window(ruby, backend);
+            if (ws->getRenderBackend() != backend) {
+                break;
+            }
+            auto plot = std::make_unique<Plot>(ws->getDisplay(), ws->getWindow(), ws->getGC(), ws->getResources(),
+                                               10, 10, 780, 300);
+            std::vector<float> samples(points);
+            for (size_t i = 0; i < points; ++i) {
+                samples[i] = std::sin(static_cast<float>(i) * 0.001f) + static_cast<float>(i % 97) * 0.01f;
+            }
+            plot->setSeries(0, std::move(samples), ws->getResources().color("#004400"));
+            ws->addWidget(std::move(plot));
+            ws->resize(800, 600);
+            ws->render_frame();
+            XSync(ws->getDisplay(), False);
+
+            BenchResult& result = report.measure("plot_redraw", options.warmup, options.iterations, [&]() {
+                ws->invalidate_all();
+                ws->render_frame();
+                XSync(ws->getDisplay(), False);
+            });
+            result.params = { { "points", std::to_string(points) }, { "width", "780" },
+                              { "backend", backend_name(backend) } };
+        }
+    }
+
+    // Image widget from a 512x512 PPM: decoded and uploaded by a fresh cache, then served by a warm one
+    {
+        const std::string path = "/tmp/modernx_bench_image.ppm";
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << "P6\n512 512\n255\n";
+            for (int i = 0; i < 512 * 512; ++i) {
+                char rgb[3] = { static_cast<char>(i), static_cast<char>(i >> 9), static_cast<char>(i >> 3) };
+                file.write(rgb, 3);
+            }
+        }
+        auto ws = make_window(ruby);
+        ws->resize(800, 600);
+        auto wait_ready = [&](IImageCache& cache, const Image& image) {
+            while (!image.ready()) {
+                pollfd fd = { cache.completion_fd(), POLLIN, 0 };
+                poll(&fd, 1, 1000);
+                cache.dispatch_completions();
+            }
+        };
+
+        BenchResult& cold = report.measure("image_load", 1, std::max(1, options.iterations / 10), [&]() {
+            auto cache = std::make_shared<ImageCache>();
+            cache->attach(ws->getDisplay(), DefaultScreen(ws->getDisplay()), true);
+            Image image(ws->getDisplay(), ws->getWindow(), ws->getGC(), *cache, ws->getResources(),
+                        10, 10, 256, 256, path);
+            wait_ready(*cache, image);
+            XSync(ws->getDisplay(), False);
+            cache->attach(nullptr, 0, false);
+        });
+        cold.params = { { "cache", "cold" }, { "source", "512x512" }, { "size", "256x256" } };
+
+        auto images = std::make_shared<ImageCache>();
+        ws->setImageCache(images);
+        auto first = std::make_unique<Image>(ws->getDisplay(), ws->getWindow(), ws->getGC(), *images,
+                                             ws->getResources(), 10, 10, 256, 256, path);
+        wait_ready(*images, *first);
+        ws->addWidget(std::move(first));
+        BenchResult& warm = report.measure("image_load", options.warmup, options.iterations, [&]() {
+            Image image(ws->getDisplay(), ws->getWindow(), ws->getGC(), *images, ws->getResources(),
+                        300, 10, 256, 256, path);
+        });
+        warm.params = { { "cache", "warm" }, { "source", "512x512" }, { "size", "256x256" } };
+
+        BenchResult& redraw = report.measure("image_redraw", options.warmup, options.iterations, [&]() {
+            ws->invalidate_all();
+            ws->render_frame();
+            XSync(ws->getDisplay(), False);
+        });
+        redraw.params = { { "size", "256x256" }, { "backend", "xft" } };
+        ImageCacheStats stats = images->stats();
+        report.note("image_cache_hits", std::to_string(stats.hits));
+        report.note("image_cache_bytes", std::to_string(stats.bytes));
+        std::remove(path.c_str());
+    }
+
+    // Container setup to the first frame, services built one after another versus overlapped.
+    // fontconfig stays warm after the first run in this process, so this mostly shows mruby overlap.
+    for (bool parallel : { false, true }) {
+        BenchResult& startup = report.measure("startup_first_frame", 1, std::max(1, options.iterations / 10), [&]() {
+            Container container;
+            AppOptions app_options;
+            app_options.parallel_startup = parallel;
+            AppModule::configure(container, app_options);
+            container.initialize();
+            auto ws = std::dynamic_pointer_cast<WindowService>(container.resolve<IWindowService>());
+            ws->render_frame();
+            XSync(ws->getDisplay(), False);
+        });
+        startup.params = { { "startup", parallel ? "parallel" : "serial" } };
+    }
+}
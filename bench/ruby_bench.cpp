@@ -0,0 +1,153 @@
+#include "bench_harness.hpp"
+#include "services/ruby_service.hpp"
+#include "bindings/timer_module.hpp"
+#include "core/reactor.hpp"
+#include "services/ruby_heap.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include <string>
+
+namespace {
+
+struct Snippet {
+    const char* name;
+    const char* code;
+};
+
+// Representative panel expressions, from trivial to allocation heavy
+const Snippet kSnippets[] = {
+    { "arith", "1 + 2 * 3" },
+    { "string_build", "s = ''; 200.times { |i| s << i.to_s }; s.size" },
+    { "array_fill", "a = []; 1000.times { |i| a << i * i }; a.size" },
+    { "hash_build", "h = {}; 500.times { |i| h[i] = i.to_s }; h.size" },
+    { "class_def", "class BenchPoint; def initialize(x); @x = x; end; def x; @x; end; end; BenchPoint.new(3).x" },
+};
+
+} // namespace
+
+void run_ruby_benchmarks(BenchReport& report, const BenchOptions& options) {
+    RubyService ruby;
+
+    for (const Snippet& snippet : kSnippets) {
+        // Same source every time: served from the compiled-bytecode cache
+        BenchResult& cached = report.measure("execute_code", options.warmup, options.iterations, [&]() {
+            ruby.execute_code(snippet.code);
+        });
+        cached.params = { { "script", snippet.name }, { "compile", "cached" } };
+
+        // Unique trailing comment forces a parse on every run
+        int serial = 0;
+        BenchResult& parsed = report.measure("execute_code", options.warmup, options.iterations, [&]() {
+            ruby.execute_code(std::string(snippet.code) + " # " + std::to_string(serial++));
+        });
+        parsed.params = { { "script", snippet.name }, { "compile", "uncached" } };
+    }
+
+    // Large result: full inspect string versus capped streaming inspect
+    const char* big = "(1..200000).map { |i| [i, i.to_s] }";
+    BenchResult& full = report.measure("inspect_large", 1, std::max(1, options.iterations / 10), [&]() {
+        ruby.execute_code(big);
+    });
+    full.params = { { "mode", "full" } };
+
+    InspectLimits limits;
+    size_t streamed_bytes = 0;
+    BenchResult& streamed = report.measure("inspect_large", 1, std::max(1, options.iterations / 10), [&]() {
+        streamed_bytes = 0;
+        std::string tail = ruby.stream_code(big, limits, [&](std::string chunk) {
+            streamed_bytes += chunk.size();
+        });
+        streamed_bytes += tail.size();
+    });
+    streamed.params = { { "mode", "streamed" }, { "max_bytes", std::to_string(limits.max_bytes) } };
+    report.note("inspect_streamed_bytes", std::to_string(streamed_bytes));
+
+    std::string hello = options.scripts_dir + "/hello.rb";
+    BenchResult& file = report.measure("load_file", options.warmup, options.iterations, [&]() {
+        ruby.load_file(hello);
+    });
+    file.params = { { "script", hello } };
+
+    // Same script from the bytecode linked in at build time: no I/O, no parse
+    BenchResult& embedded = report.measure("load_script", options.warmup, options.iterations, [&]() {
+        ruby.load_script("hello.rb");
+    });
+    embedded.params = { { "script", "hello.rb" }, { "source", std::getenv("MODERNX_SCRIPT_DIR") ? "disk" : "embedded" } };
+
+    // Idle GC: one 2 ms slice after an evaluation that leaves garbage behind
+    const std::string garbage = "a = nil; 20000.times { |i| a = [i.to_s, {k: i}] }; nil";
+    BenchResult& gc = report.measure("eval_then_idle_gc", 1, std::max(1, options.iterations / 10), [&]() {
+        ruby.execute_code(garbage);
+        ruby.collect_garbage(std::chrono::microseconds(2000));
+    });
+    gc.params = { { "slice_us", "2000" } };
+    RubyHeapStats heap = ruby.heap_stats();
+    report.note("ruby_heap_bytes", std::to_string(heap.heap_bytes));
+    report.note("ruby_live_objects", std::to_string(heap.live_objects));
+    report.note("ruby_gc_max_pause_us", std::to_string(heap.max_pause_us));
+
+    // Same loop with the sampling profiler off and on (1 ms interval)
+    const std::string loop = "def bench_leaf(i); i * 2; end; t = 0; 20000.times { |i| t += bench_leaf(i) }; t";
+    for (bool on : { false, true }) {
+        if (on) {
+            ruby.start_profiling(std::chrono::microseconds(1000));
+        }
+        BenchResult& profiled = report.measure("profiled_eval", options.warmup, options.iterations, [&]() {
+            ruby.execute_code(loop);
+        });
+        profiled.params = { { "profiler", on ? "on" : "off" } };
+    }
+    ruby.stop_profiling();
+    std::string folded = ruby.profile_folded(true);
+    report.note("profile_stacks", std::to_string(std::count(folded.begin(), folded.end(), '\n')));
+
+    // Timer round trip: after(0) from Ruby, through the reactor and back into the interpreter
+    Reactor reactor;
+    bool fired = false;
+    ruby.add_extension([&](mrb_state* mrb) {
+        install_timer_module(mrb, &reactor, [&](uint64_t id) {
+            ruby.execute_async("Timer.fire(" + std::to_string(id) + ")", [&](const std::string&) { fired = true; });
+        });
+    });
+    reactor.add_fd(ruby.completion_fd(), [&]() { ruby.dispatch_completions(); });
+    BenchResult& tick = report.measure("timer_fire", options.warmup, options.iterations, [&]() {
+        fired = false;
+        ruby.execute_code("after(0) { nil }");
+        while (!fired) {
+            reactor.run_once(std::chrono::milliseconds(100));
+        }
+    });
+    tick.params = { { "kind", "after" } };
+    reactor.remove_fd(ruby.completion_fd());
+
+    // Allocator alone: object-sized blocks freed in a different order than allocated
+    const size_t kChurnBlocks = 4096;
+    std::vector<void*> blocks(kChurnBlocks);
+    RubyHeap pool;
+    BenchResult& pooled = report.measure("heap_churn", options.warmup, options.iterations, [&]() {
+        for (size_t i = 0; i < kChurnBlocks; ++i) {
+            blocks[i] = pool.reallocate(nullptr, 40 + (i % 4) * 24);
+        }
+        for (size_t i = 0; i < kChurnBlocks; ++i) {
+            pool.reallocate(blocks[(i * 7919) % kChurnBlocks], 0);
+        }
+    });
+    pooled.params = { { "allocator", "size_class" }, { "blocks", std::to_string(kChurnBlocks) } };
+    BenchResult& system = report.measure("heap_churn", options.warmup, options.iterations, [&]() {
+        for (size_t i = 0; i < kChurnBlocks; ++i) {
+            blocks[i] = std::malloc(40 + (i % 4) * 24);
+        }
+        for (size_t i = 0; i < kChurnBlocks; ++i) {
+            std::free(blocks[(i * 7919) % kChurnBlocks]);
+        }
+    });
+    system.params = { { "allocator", "malloc" }, { "blocks", std::to_string(kChurnBlocks) } };
+    heap = ruby.heap_stats();
+    report.note("ruby_heap_reserved", std::to_string(heap.heap_reserved));
+    report.note("ruby_pool_reuses", std::to_string(heap.pool_reuses));
+
+    RubyCacheStats stats = ruby.cache_stats();
+    report.note("ruby_cache_hits", std::to_string(stats.hits));
+    report.note("ruby_cache_misses", std::to_string(stats.misses));
+}
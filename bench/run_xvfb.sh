@@ -0,0 +1,15 @@
+#!/bin/bash
+# Runs modernx_bench against a private Xvfb display.
+# usage: bench/run_xvfb.sh [path/to/modernx_bench] [bench args...]
+#        bench/run_xvfb.sh build/modernx --replay trace.mxt --checksum
+set -e
+BENCH=${1:-build/modernx_bench}
+shift || true
+DISPLAY_NUM=${BENCH_DISPLAY:-:99}
+
+Xvfb "$DISPLAY_NUM" -screen 0 1920x1080x24 -nolisten tcp &
+XVFB_PID=$!
+trap 'kill $XVFB_PID 2>/dev/null' EXIT
+sleep 1
+
+DISPLAY="$DISPLAY_NUM" "$BENCH" "$@"
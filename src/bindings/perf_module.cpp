@@ -0,0 +1,73 @@
+#include "perf_module.hpp"
+#include <mruby.h>
+#include <mruby/array.h>
+#include <mruby/hash.h>
+#include <mruby/string.h>
+#include <mruby/variable.h>
+
+namespace {
+
+Telemetry* telemetry_of(mrb_state* mrb, mrb_value self) {
+    mrb_value ptr = mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "__telemetry__"));
+    if (mrb_type(ptr) != MRB_TT_CPTR) {
+        mrb_raise(mrb, E_RUNTIME_ERROR, "Perf telemetry is not attached");
+    }
+    return static_cast<Telemetry*>(mrb_ptr(ptr));
+}
+
+void set(mrb_state* mrb, mrb_value hash, const char* key, mrb_value value) {
+    mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_cstr(mrb, key)), value);
+}
+
+mrb_value summary_hash(mrb_state* mrb, const TelemetrySnapshot::Summary& summary) {
+    mrb_value hash = mrb_hash_new(mrb);
+    set(mrb, hash, "count", mrb_int_value(mrb, static_cast<mrb_int>(summary.count)));
+    set(mrb, hash, "mean_us", mrb_float_value(mrb, summary.mean_us));
+    set(mrb, hash, "p50_us", mrb_float_value(mrb, summary.p50_us));
+    set(mrb, hash, "p99_us", mrb_float_value(mrb, summary.p99_us));
+    set(mrb, hash, "max_us", mrb_float_value(mrb, summary.max_us));
+    return hash;
+}
+
+// Perf.stats -> {frame: {...}, batch: {...}, xflush: {...}, ruby_eval: {...}, ruby_gc: {...},
+//                ruby_allocations: n, ruby_allocated_bytes: n, ruby_heap_bytes: n,
+//                ruby_live_objects: n, widgets: [...]}
+mrb_value perf_stats(mrb_state* mrb, mrb_value self) {
+    TelemetrySnapshot snap = telemetry_of(mrb, self)->snapshot();
+    mrb_value stats = mrb_hash_new(mrb);
+    set(mrb, stats, "frame", summary_hash(mrb, snap.metrics[static_cast<int>(Metric::Frame)]));
+    set(mrb, stats, "batch", summary_hash(mrb, snap.metrics[static_cast<int>(Metric::Batch)]));
+    set(mrb, stats, "xflush", summary_hash(mrb, snap.metrics[static_cast<int>(Metric::XFlush)]));
+    set(mrb, stats, "ruby_eval", summary_hash(mrb, snap.metrics[static_cast<int>(Metric::RubyEval)]));
+    set(mrb, stats, "ruby_gc", summary_hash(mrb, snap.metrics[static_cast<int>(Metric::RubyGc)]));
+    set(mrb, stats, "ruby_allocations", mrb_int_value(mrb, static_cast<mrb_int>(snap.ruby_allocations)));
+    set(mrb, stats, "ruby_allocated_bytes", mrb_int_value(mrb, static_cast<mrb_int>(snap.ruby_allocated_bytes)));
+    set(mrb, stats, "ruby_heap_bytes", mrb_int_value(mrb, static_cast<mrb_int>(snap.ruby_heap_bytes)));
+    set(mrb, stats, "ruby_live_objects", mrb_int_value(mrb, static_cast<mrb_int>(snap.ruby_live_objects)));
+
+    mrb_value widgets = mrb_ary_new_capa(mrb, static_cast<mrb_int>(snap.widgets.size()));
+    for (const WidgetCost& cost : snap.widgets) {
+        mrb_value entry = mrb_hash_new(mrb);
+        set(mrb, entry, "kind", mrb_str_new_cstr(mrb, cost.kind.c_str()));
+        set(mrb, entry, "draws", mrb_int_value(mrb, static_cast<mrb_int>(cost.draws)));
+        set(mrb, entry, "total_us", mrb_float_value(mrb, cost.total_us));
+        set(mrb, entry, "max_us", mrb_float_value(mrb, cost.max_us));
+        mrb_ary_push(mrb, widgets, entry);
+    }
+    set(mrb, stats, "widgets", widgets);
+    return stats;
+}
+
+mrb_value perf_reset(mrb_state* mrb, mrb_value self) {
+    telemetry_of(mrb, self)->reset();
+    return mrb_nil_value();
+}
+
+} // namespace
+
+void install_perf_module(mrb_state* mrb, Telemetry* telemetry) {
+    struct RClass* perf = mrb_define_module(mrb, "Perf");
+    mrb_iv_set(mrb, mrb_obj_value(perf), mrb_intern_lit(mrb, "__telemetry__"), mrb_cptr_value(mrb, telemetry));
+    mrb_define_module_function(mrb, perf, "stats", perf_stats, MRB_ARGS_NONE());
+    mrb_define_module_function(mrb, perf, "reset", perf_reset, MRB_ARGS_NONE());
+}
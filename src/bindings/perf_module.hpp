@@ -0,0 +1,8 @@
+#pragma once
+#include "../core/telemetry.hpp"
+
+struct mrb_state;
+
+// Defines the Ruby `Perf` module (Perf.stats, Perf.reset) over telemetry.
+// telemetry must outlive the interpreter.
+void install_perf_module(mrb_state* mrb, Telemetry* telemetry);
@@ -0,0 +1,195 @@
+#include "timer_module.hpp"
+#include "../utils/log.hpp"
+#include <mruby.h>
+#include <mruby/array.h>
+#include <mruby/data.h>
+#include <mruby/hash.h>
+#include <mruby/variable.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// mrb_raise unwinds with longjmp, so everything that can raise runs before
+// any C++ object with a destructor is constructed
+
+namespace {
+
+// Shortest period and longest delay; outside them a timer is a busy loop or
+// overflows the reactor's nanosecond clock. One-shot timers may use 0.
+constexpr double kMinSeconds = 0.001;
+constexpr double kMaxSeconds = 365.0 * 24 * 3600;
+
+struct TimerHost {
+    Reactor* reactor;
+    TimerFire fire;
+    // Timer#id values, handed out before the reactor knows the timer, so the
+    // block is registered before anything can fire it
+    uint64_t next_id = 1;
+    // Scheduled from the Ruby thread, fired and cancelled from others
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Reactor::TimerId> active; // Timer#id => reactor timer
+};
+
+void free_host(mrb_state* mrb, void* ptr) {
+    (void)mrb;
+    auto* host = static_cast<TimerHost*>(ptr);
+    // Nothing may fire into an interpreter that is going away
+    for (const auto& timer : host->active) {
+        host->reactor->cancel_timer(timer.second);
+    }
+    delete host;
+}
+
+const mrb_data_type kHostType = { "TimerHost", free_host };
+
+mrb_sym id_sym(mrb_state* mrb) { return mrb_intern_lit(mrb, "__id__"); }
+
+struct RClass* timer_class(mrb_state* mrb) { return mrb_class_get(mrb, "Timer"); }
+
+TimerHost* host_of(mrb_state* mrb) {
+    mrb_value host = mrb_iv_get(mrb, mrb_obj_value(timer_class(mrb)), mrb_intern_lit(mrb, "__host__"));
+    return static_cast<TimerHost*>(mrb_data_get_ptr(mrb, host, &kHostType));
+}
+
+// id => [block, periodic]; keeps the blocks reachable for the GC
+mrb_value registry(mrb_state* mrb) {
+    return mrb_iv_get(mrb, mrb_obj_value(timer_class(mrb)), mrb_intern_lit(mrb, "__blocks__"));
+}
+
+void start_timer(TimerHost* host, uint64_t id, double seconds, bool periodic) {
+    auto delay = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(seconds));
+    std::lock_guard<std::mutex> lock(host->mutex);
+    Reactor::TimerId timer = host->reactor->add_timer(delay, periodic ? delay : std::chrono::nanoseconds(0),
+                                                      [host, id]() { host->fire(id); });
+    host->active.emplace(id, timer);
+}
+
+void stop_timer(TimerHost* host, uint64_t id) {
+    std::lock_guard<std::mutex> lock(host->mutex);
+    auto it = host->active.find(id);
+    if (it != host->active.end()) {
+        host->reactor->cancel_timer(it->second);
+        host->active.erase(it);
+    }
+}
+
+mrb_value schedule(mrb_state* mrb, bool periodic) {
+    mrb_float seconds;
+    mrb_value block;
+    mrb_get_args(mrb, "f&", &seconds, &block);
+    if (mrb_nil_p(block)) {
+        mrb_raise(mrb, E_ARGUMENT_ERROR, "no block given");
+    }
+    if (!std::isfinite(seconds) || (periodic ? !(seconds > 0) : !(seconds >= 0))) {
+        mrb_raise(mrb, E_ARGUMENT_ERROR, "interval must be a positive number of seconds");
+    }
+    if (seconds > kMaxSeconds) {
+        mrb_raise(mrb, E_ARGUMENT_ERROR, "interval must be at most a year");
+    }
+    if (periodic) {
+        seconds = std::max<double>(seconds, kMinSeconds);
+    }
+    TimerHost* host = host_of(mrb);
+    mrb_value blocks = registry(mrb);
+    mrb_value timer = mrb_obj_new(mrb, timer_class(mrb), 0, nullptr);
+
+    // Everything that can raise happens before the reactor has the timer: a
+    // timer started without its block would fire into nothing forever
+    uint64_t id = host->next_id++;
+    mrb_value key = mrb_int_value(mrb, static_cast<mrb_int>(id));
+    mrb_hash_set(mrb, blocks, key, mrb_assoc_new(mrb, block, mrb_bool_value(periodic)));
+    mrb_iv_set(mrb, timer, id_sym(mrb), key);
+    start_timer(host, id, seconds, periodic);
+    return timer;
+}
+
+// every(seconds) { ... }
+mrb_value kernel_every(mrb_state* mrb, mrb_value self) {
+    (void)self;
+    return schedule(mrb, true);
+}
+
+// after(seconds) { ... }
+mrb_value kernel_after(mrb_state* mrb, mrb_value self) {
+    (void)self;
+    return schedule(mrb, false);
+}
+
+mrb_value timer_id(mrb_state* mrb, mrb_value self) {
+    return mrb_iv_get(mrb, self, id_sym(mrb));
+}
+
+mrb_value timer_active_p(mrb_state* mrb, mrb_value self) {
+    mrb_value id = mrb_iv_get(mrb, self, id_sym(mrb));
+    return mrb_bool_value(!mrb_nil_p(mrb_hash_get(mrb, registry(mrb), id)));
+}
+
+mrb_value timer_cancel(mrb_state* mrb, mrb_value self) {
+    mrb_value id = mrb_iv_get(mrb, self, id_sym(mrb));
+    if (!mrb_integer_p(id)) {
+        return mrb_false_value();
+    }
+    TimerHost* host = host_of(mrb);
+    mrb_value removed = mrb_hash_delete_key(mrb, registry(mrb), id);
+    stop_timer(host, static_cast<uint64_t>(mrb_integer(id)));
+    return mrb_bool_value(!mrb_nil_p(removed));
+}
+
+// Timer.fire(id): runs the block; a one-shot timer is forgotten first
+mrb_value timer_fire(mrb_state* mrb, mrb_value self) {
+    (void)self;
+    mrb_int id;
+    mrb_get_args(mrb, "i", &id);
+    mrb_value blocks = registry(mrb);
+    mrb_value key = mrb_int_value(mrb, id);
+    mrb_value entry = mrb_hash_get(mrb, blocks, key);
+    if (mrb_nil_p(entry)) {
+        return mrb_nil_value(); // Cancelled after this tick was queued
+    }
+    mrb_value block = mrb_ary_ref(mrb, entry, 0);
+    if (!mrb_test(mrb_ary_ref(mrb, entry, 1))) {
+        mrb_hash_delete_key(mrb, blocks, key);
+        TimerHost* host = host_of(mrb);
+        stop_timer(host, static_cast<uint64_t>(id));
+    }
+    return mrb_yield_argv(mrb, block, 0, nullptr);
+}
+
+} // namespace
+
+void install_timer_module(mrb_state* mrb, Reactor* reactor, TimerFire fire) {
+    struct RClass* timer = mrb_define_class(mrb, "Timer", mrb->object_class);
+    struct RData* host = mrb_data_object_alloc(mrb, mrb->object_class, nullptr, &kHostType);
+    host->data = new TimerHost{reactor, std::move(fire), 1, {}, {}};
+    mrb_iv_set(mrb, mrb_obj_value(timer), mrb_intern_lit(mrb, "__host__"), mrb_obj_value(host));
+    mrb_iv_set(mrb, mrb_obj_value(timer), mrb_intern_lit(mrb, "__blocks__"), mrb_hash_new(mrb));
+
+    mrb_define_method(mrb, timer, "id", timer_id, MRB_ARGS_NONE());
+    mrb_define_method(mrb, timer, "active?", timer_active_p, MRB_ARGS_NONE());
+    mrb_define_method(mrb, timer, "cancel", timer_cancel, MRB_ARGS_NONE());
+    mrb_define_class_method(mrb, timer, "fire", timer_fire, MRB_ARGS_REQ(1));
+
+    mrb_define_method(mrb, mrb->kernel_module, "every", kernel_every, MRB_ARGS_REQ(1) | MRB_ARGS_BLOCK());
+    mrb_define_method(mrb, mrb->kernel_module, "after", kernel_after, MRB_ARGS_REQ(1) | MRB_ARGS_BLOCK());
+}
+
+TimerFire async_timer_fire(IRubyService* ruby) {
+    // Touched only on the loop thread: fire from the reactor, erase from dispatch_completions
+    auto in_flight = std::make_shared<std::unordered_set<uint64_t>>();
+    return [ruby, in_flight](uint64_t id) {
+        if (!in_flight->insert(id).second) {
+            return; // Previous tick still running: skip rather than pile up
+        }
+        ruby->execute_async("Timer.fire(" + std::to_string(id) + ")", [in_flight, id](const std::string& result) {
+            in_flight->erase(id);
+            if (result.compare(0, 7, "Error: ") == 0) {
+                LOG_WARN(Ruby, "Timer %llu failed: %s", static_cast<unsigned long long>(id), result.c_str());
+            }
+        });
+    };
+}
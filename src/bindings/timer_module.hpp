@@ -0,0 +1,22 @@
+#pragma once
+#include "../core/reactor.hpp"
+#include "../interfaces/iruby_service.hpp"
+#include <cstdint>
+#include <functional>
+
+struct mrb_state;
+
+// Re-enters the interpreter for a due timer (id is Timer#id); called on the
+// reactor thread, which never holds the interpreter itself
+using TimerFire = std::function<void(uint64_t id)>;
+
+// Defines Kernel#every(seconds) { } and Kernel#after(seconds) { }, both
+// returning a Timer (#id, #cancel, #active?), plus Timer.fire(id) for the
+// host. Delays are capped at a year; periods under 1 ms are rounded up.
+// Timers still pending when the interpreter closes are cancelled. reactor
+// must outlive the interpreter.
+void install_timer_module(mrb_state* mrb, Reactor* reactor, TimerFire fire);
+
+// Fires through ruby->execute_async. A tick is skipped while the previous
+// run of the same timer is still queued or running.
+TimerFire async_timer_fire(IRubyService* ruby);
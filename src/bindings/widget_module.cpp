@@ -0,0 +1,349 @@
+#include "widget_module.hpp"
+#include "../gui/plot.hpp"
+#include <mruby.h>
+#include <mruby/array.h>
+#include <mruby/string.h>
+#include <mruby/variable.h>
+#include <cstring>
+
+// mrb_raise unwinds with longjmp, so everything that can raise runs before
+// any C++ object with a destructor is constructed
+
+namespace {
+
+// Hidden ivars: names without '@' cannot be reached from Ruby code
+mrb_sym id_sym(mrb_state* mrb) { return mrb_intern_lit(mrb, "__id__"); }
+
+UiCommandBuffer* commands_of(mrb_state* mrb) {
+    mrb_value widget_class = mrb_obj_value(mrb_class_get(mrb, "Widget"));
+    mrb_value ptr = mrb_iv_get(mrb, widget_class, mrb_intern_lit(mrb, "__commands__"));
+    if (mrb_type(ptr) != MRB_TT_CPTR) {
+        mrb_raise(mrb, E_RUNTIME_ERROR, "widget commands are not attached");
+    }
+    return static_cast<UiCommandBuffer*>(mrb_ptr(ptr));
+}
+
+uint32_t widget_id(mrb_state* mrb, mrb_value self) {
+    mrb_value id = mrb_iv_get(mrb, self, id_sym(mrb));
+    if (!mrb_integer_p(id) || mrb_integer(id) == 0) {
+        mrb_raise(mrb, E_RUNTIME_ERROR, "widget has been removed");
+    }
+    return static_cast<uint32_t>(mrb_integer(id));
+}
+
+mrb_value ivar(mrb_state* mrb, mrb_value self, const char* name) {
+    return mrb_iv_get(mrb, self, mrb_intern_cstr(mrb, name));
+}
+
+void set_ivar(mrb_state* mrb, mrb_value self, const char* name, mrb_value value) {
+    mrb_iv_set(mrb, self, mrb_intern_cstr(mrb, name), value);
+}
+
+UiCommand command(UiCommand::Op op, uint32_t id) {
+    UiCommand cmd;
+    cmd.op = op;
+    cmd.id = id;
+    return cmd;
+}
+
+// Sets the ivars every widget has and returns its create command. Callers set
+// their own ivars first: once the command exists nothing may raise.
+UiCommand create_command(mrb_state* mrb, mrb_value self, UiCommandBuffer* commands, UiCommand::Op op,
+                         mrb_int x, mrb_int y, mrb_int width, mrb_int height) {
+    uint32_t id = commands->next_id();
+    mrb_iv_set(mrb, self, id_sym(mrb), mrb_int_value(mrb, id));
+    set_ivar(mrb, self, "@x", mrb_int_value(mrb, x));
+    set_ivar(mrb, self, "@y", mrb_int_value(mrb, y));
+    UiCommand cmd = command(op, id);
+    cmd.x = static_cast<int>(x);
+    cmd.y = static_cast<int>(y);
+    cmd.width = static_cast<int>(width);
+    cmd.height = static_cast<int>(height);
+    return cmd;
+}
+
+// Label.new(text = "", x = 0, y = 0, width = 200, height = 20)
+mrb_value label_initialize(mrb_state* mrb, mrb_value self) {
+    static const char font[] = "monospace-10";
+    static const char color[] = "#000000";
+    const char* text = "";
+    mrb_int text_len = 0;
+    mrb_int x = 0, y = 0, width = 200, height = 20;
+    mrb_get_args(mrb, "|siiii", &text, &text_len, &x, &y, &width, &height);
+
+    UiCommandBuffer* commands = commands_of(mrb);
+    set_ivar(mrb, self, "@text", mrb_str_new(mrb, text, text_len));
+    set_ivar(mrb, self, "@font", mrb_str_new_lit(mrb, font));
+    set_ivar(mrb, self, "@color", mrb_str_new_lit(mrb, color));
+    set_ivar(mrb, self, "@align", mrb_symbol_value(mrb_intern_lit(mrb, "left")));
+    UiCommand cmd = create_command(mrb, self, commands, UiCommand::Op::CreateLabel, x, y, width, height);
+    cmd.text.assign(text, static_cast<size_t>(text_len));
+    cmd.font = font;
+    cmd.color = color;
+    commands->record(std::move(cmd));
+    return self;
+}
+
+mrb_value widget_id_get(mrb_state* mrb, mrb_value self) {
+    mrb_value id = mrb_iv_get(mrb, self, id_sym(mrb));
+    return mrb_integer_p(id) && mrb_integer(id) != 0 ? id : mrb_nil_value();
+}
+
+mrb_value widget_x(mrb_state* mrb, mrb_value self) { return ivar(mrb, self, "@x"); }
+mrb_value widget_y(mrb_state* mrb, mrb_value self) { return ivar(mrb, self, "@y"); }
+
+mrb_value widget_move(mrb_state* mrb, mrb_value self) {
+    mrb_int x, y;
+    mrb_get_args(mrb, "ii", &x, &y);
+    UiCommandBuffer* commands = commands_of(mrb);
+    uint32_t id = widget_id(mrb, self);
+    set_ivar(mrb, self, "@x", mrb_int_value(mrb, x));
+    set_ivar(mrb, self, "@y", mrb_int_value(mrb, y));
+    UiCommand cmd = command(UiCommand::Op::Move, id);
+    cmd.x = static_cast<int>(x);
+    cmd.y = static_cast<int>(y);
+    commands->record(std::move(cmd));
+    return self;
+}
+
+mrb_value widget_remove(mrb_state* mrb, mrb_value self) {
+    UiCommandBuffer* commands = commands_of(mrb);
+    uint32_t id = widget_id(mrb, self);
+    mrb_iv_set(mrb, self, id_sym(mrb), mrb_int_value(mrb, 0));
+    commands->record(command(UiCommand::Op::Remove, id));
+    return mrb_nil_value();
+}
+
+mrb_value widget_removed_p(mrb_state* mrb, mrb_value self) {
+    return mrb_bool_value(mrb_nil_p(widget_id_get(mrb, self)));
+}
+
+mrb_value label_text(mrb_state* mrb, mrb_value self) { return ivar(mrb, self, "@text"); }
+mrb_value label_font(mrb_state* mrb, mrb_value self) { return ivar(mrb, self, "@font"); }
+mrb_value label_color(mrb_state* mrb, mrb_value self) { return ivar(mrb, self, "@color"); }
+mrb_value label_align(mrb_state* mrb, mrb_value self) { return ivar(mrb, self, "@align"); }
+
+// Shared shape of text=, font= and color=: a string argument mirrored into an ivar
+mrb_value set_string(mrb_state* mrb, mrb_value self, UiCommand::Op op,
+                     std::string UiCommand::*field, const char* name) {
+    mrb_value value;
+    mrb_get_args(mrb, "S", &value);
+    UiCommandBuffer* commands = commands_of(mrb);
+    uint32_t id = widget_id(mrb, self);
+    set_ivar(mrb, self, name, value);
+    UiCommand cmd = command(op, id);
+    (cmd.*field).assign(RSTRING_PTR(value), static_cast<size_t>(RSTRING_LEN(value)));
+    commands->record(std::move(cmd));
+    return value;
+}
+
+mrb_value label_set_text(mrb_state* mrb, mrb_value self) {
+    return set_string(mrb, self, UiCommand::Op::SetText, &UiCommand::text, "@text");
+}
+
+mrb_value label_set_font(mrb_state* mrb, mrb_value self) {
+    return set_string(mrb, self, UiCommand::Op::SetFont, &UiCommand::font, "@font");
+}
+
+mrb_value label_set_color(mrb_state* mrb, mrb_value self) {
+    return set_string(mrb, self, UiCommand::Op::SetColor, &UiCommand::color, "@color");
+}
+
+// label.align = :left | :center | :right
+mrb_value label_set_align(mrb_state* mrb, mrb_value self) {
+    mrb_sym align;
+    mrb_get_args(mrb, "n", &align);
+    const char* name = mrb_sym_name(mrb, align);
+    TextAlign value = TextAlign::Left;
+    if (std::strcmp(name, "center") == 0) {
+        value = TextAlign::Center;
+    } else if (std::strcmp(name, "right") == 0) {
+        value = TextAlign::Right;
+    } else if (std::strcmp(name, "left") != 0) {
+        mrb_raisef(mrb, E_ARGUMENT_ERROR, "unknown alignment :%s", name);
+    }
+    UiCommandBuffer* commands = commands_of(mrb);
+    uint32_t id = widget_id(mrb, self);
+    set_ivar(mrb, self, "@align", mrb_symbol_value(align));
+    UiCommand cmd = command(UiCommand::Op::SetAlign, id);
+    cmd.align = value;
+    commands->record(std::move(cmd));
+    return mrb_symbol_value(align);
+}
+
+// Plot.new(x = 0, y = 0, width = 300, height = 100, background = "#ffffff")
+mrb_value plot_initialize(mrb_state* mrb, mrb_value self) {
+    mrb_int x = 0, y = 0, width = 300, height = 100;
+    const char* background = "#ffffff";
+    mrb_int background_len = 7;
+    mrb_get_args(mrb, "|iiiis", &x, &y, &width, &height, &background, &background_len);
+
+    UiCommandBuffer* commands = commands_of(mrb);
+    UiCommand cmd = create_command(mrb, self, commands, UiCommand::Op::CreatePlot, x, y, width, height);
+    cmd.color.assign(background, static_cast<size_t>(background_len));
+    commands->record(std::move(cmd));
+    return self;
+}
+
+// Series data is an Array of numbers or a String of packed float32
+// (Array#pack("e*")). Checks every element and returns the sample count;
+// raises on anything else.
+size_t series_length(mrb_state* mrb, mrb_value data) {
+    if (mrb_string_p(data)) {
+        mrb_int bytes = RSTRING_LEN(data);
+        if (bytes % static_cast<mrb_int>(sizeof(float)) != 0) {
+            mrb_raisef(mrb, E_ARGUMENT_ERROR, "packed series of %d bytes is not whole float32 values", bytes);
+        }
+        return static_cast<size_t>(bytes) / sizeof(float);
+    }
+    if (!mrb_array_p(data)) {
+        mrb_raise(mrb, E_TYPE_ERROR, "series must be an Array or a packed String");
+    }
+    const mrb_value* values = RARRAY_PTR(data);
+    mrb_int count = RARRAY_LEN(data);
+    for (mrb_int i = 0; i < count; ++i) {
+        if (!mrb_integer_p(values[i]) && !mrb_float_p(values[i])) {
+            mrb_raisef(mrb, E_TYPE_ERROR, "series value %d is not a number", i);
+        }
+    }
+    return static_cast<size_t>(count);
+}
+
+// Only for data series_length accepted, so it cannot raise. Reads the array
+// slots and string bytes in place: no Ruby object per sample.
+void read_series(mrb_value data, std::vector<float>& out, size_t count) {
+    out.resize(count);
+    if (mrb_string_p(data)) {
+        // "e" is little-endian, as on every host we build for
+        std::memcpy(out.data(), RSTRING_PTR(data), count * sizeof(float));
+        return;
+    }
+    const mrb_value* values = RARRAY_PTR(data);
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = mrb_float_p(values[i]) ? static_cast<float>(mrb_float(values[i]))
+                                        : static_cast<float>(mrb_integer(values[i]));
+    }
+}
+
+// Capped so a stray index cannot make the window allocate millions of series
+size_t series_index(mrb_state* mrb, mrb_int index) {
+    if (index < 0 || index >= static_cast<mrb_int>(Plot::kMaxSeries)) {
+        mrb_raisef(mrb, E_ARGUMENT_ERROR, "series index %d outside 0...%d", index,
+                   static_cast<mrb_int>(Plot::kMaxSeries));
+    }
+    return static_cast<size_t>(index);
+}
+
+// plot.series(index, data, color = current) replaces one series
+mrb_value plot_series(mrb_state* mrb, mrb_value self) {
+    mrb_int index;
+    mrb_value data;
+    const char* color = "";
+    mrb_int color_len = 0;
+    mrb_get_args(mrb, "io|s", &index, &data, &color, &color_len);
+    UiCommandBuffer* commands = commands_of(mrb);
+    uint32_t id = widget_id(mrb, self);
+    size_t series = series_index(mrb, index);
+    size_t count = series_length(mrb, data);
+
+    UiCommand cmd = command(UiCommand::Op::SetSeries, id);
+    cmd.series = series;
+    cmd.color.assign(color, static_cast<size_t>(color_len));
+    read_series(data, cmd.samples, count);
+    commands->record(std::move(cmd));
+    return self;
+}
+
+// plot.append(index, data) adds samples to the end of a series
+mrb_value plot_append(mrb_state* mrb, mrb_value self) {
+    mrb_int index;
+    mrb_value data;
+    mrb_get_args(mrb, "io", &index, &data);
+    UiCommandBuffer* commands = commands_of(mrb);
+    uint32_t id = widget_id(mrb, self);
+    size_t series = series_index(mrb, index);
+    size_t count = series_length(mrb, data);
+
+    UiCommand cmd = command(UiCommand::Op::AppendSamples, id);
+    cmd.series = series;
+    read_series(data, cmd.samples, count);
+    commands->record(std::move(cmd));
+    return self;
+}
+
+// plot.scale(low, high) fixes the vertical range; plot.autoscale fits the data again
+mrb_value plot_scale(mrb_state* mrb, mrb_value self) {
+    mrb_float low, high;
+    mrb_get_args(mrb, "ff", &low, &high);
+    if (!(low < high)) {
+        mrb_raise(mrb, E_ARGUMENT_ERROR, "scale needs low < high");
+    }
+    UiCommandBuffer* commands = commands_of(mrb);
+    UiCommand cmd = command(UiCommand::Op::SetRange, widget_id(mrb, self));
+    cmd.low = static_cast<float>(low);
+    cmd.high = static_cast<float>(high);
+    commands->record(std::move(cmd));
+    return self;
+}
+
+mrb_value plot_autoscale(mrb_state* mrb, mrb_value self) {
+    commands_of(mrb)->record(command(UiCommand::Op::SetRange, widget_id(mrb, self)));
+    return self;
+}
+
+mrb_value plot_clear(mrb_state* mrb, mrb_value self) {
+    commands_of(mrb)->record(command(UiCommand::Op::ClearPlot, widget_id(mrb, self)));
+    return self;
+}
+
+// Image.new(path, x = 0, y = 0, width = 0, height = 0); a zero size follows the file
+mrb_value image_initialize(mrb_state* mrb, mrb_value self) {
+    mrb_value path;
+    mrb_int x = 0, y = 0, width = 0, height = 0;
+    mrb_get_args(mrb, "S|iiii", &path, &x, &y, &width, &height);
+
+    UiCommandBuffer* commands = commands_of(mrb);
+    set_ivar(mrb, self, "@path", path);
+    UiCommand cmd = create_command(mrb, self, commands, UiCommand::Op::CreateImage, x, y, width, height);
+    cmd.text.assign(RSTRING_PTR(path), static_cast<size_t>(RSTRING_LEN(path)));
+    commands->record(std::move(cmd));
+    return self;
+}
+
+mrb_value image_path(mrb_state* mrb, mrb_value self) { return ivar(mrb, self, "@path"); }
+
+} // namespace
+
+void install_widget_module(mrb_state* mrb, UiCommandBuffer* commands) {
+    struct RClass* widget = mrb_define_class(mrb, "Widget", mrb->object_class);
+    mrb_iv_set(mrb, mrb_obj_value(widget), mrb_intern_lit(mrb, "__commands__"), mrb_cptr_value(mrb, commands));
+    mrb_define_method(mrb, widget, "id", widget_id_get, MRB_ARGS_NONE());
+    mrb_define_method(mrb, widget, "x", widget_x, MRB_ARGS_NONE());
+    mrb_define_method(mrb, widget, "y", widget_y, MRB_ARGS_NONE());
+    mrb_define_method(mrb, widget, "move", widget_move, MRB_ARGS_REQ(2));
+    mrb_define_method(mrb, widget, "remove", widget_remove, MRB_ARGS_NONE());
+    mrb_define_method(mrb, widget, "removed?", widget_removed_p, MRB_ARGS_NONE());
+
+    struct RClass* label = mrb_define_class(mrb, "Label", widget);
+    mrb_define_method(mrb, label, "initialize", label_initialize, MRB_ARGS_OPT(5));
+    mrb_define_method(mrb, label, "text", label_text, MRB_ARGS_NONE());
+    mrb_define_method(mrb, label, "text=", label_set_text, MRB_ARGS_REQ(1));
+    mrb_define_method(mrb, label, "font", label_font, MRB_ARGS_NONE());
+    mrb_define_method(mrb, label, "font=", label_set_font, MRB_ARGS_REQ(1));
+    mrb_define_method(mrb, label, "color", label_color, MRB_ARGS_NONE());
+    mrb_define_method(mrb, label, "color=", label_set_color, MRB_ARGS_REQ(1));
+    mrb_define_method(mrb, label, "align", label_align, MRB_ARGS_NONE());
+    mrb_define_method(mrb, label, "align=", label_set_align, MRB_ARGS_REQ(1));
+
+    struct RClass* plot = mrb_define_class(mrb, "Plot", widget);
+    mrb_define_method(mrb, plot, "initialize", plot_initialize, MRB_ARGS_OPT(5));
+    mrb_define_method(mrb, plot, "series", plot_series, MRB_ARGS_ARG(2, 1));
+    mrb_define_method(mrb, plot, "append", plot_append, MRB_ARGS_REQ(2));
+    mrb_define_method(mrb, plot, "scale", plot_scale, MRB_ARGS_REQ(2));
+    mrb_define_method(mrb, plot, "autoscale", plot_autoscale, MRB_ARGS_NONE());
+    mrb_define_method(mrb, plot, "clear", plot_clear, MRB_ARGS_NONE());
+
+    struct RClass* image = mrb_define_class(mrb, "Image", widget);
+    mrb_define_method(mrb, image, "initialize", image_initialize, MRB_ARGS_ARG(1, 4));
+    mrb_define_method(mrb, image, "path", image_path, MRB_ARGS_NONE());
+}
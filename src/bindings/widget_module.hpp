@@ -0,0 +1,9 @@
+#pragma once
+#include "../gui/ui_command_buffer.hpp"
+
+struct mrb_state;
+
+// Defines the Ruby `Widget`, `Label`, `Plot` and `Image` classes. Setters only
+// record into commands; getters answer from the Ruby object, never from the
+// C++ widget. commands must outlive the interpreter.
+void install_widget_module(mrb_state* mrb, UiCommandBuffer* commands);
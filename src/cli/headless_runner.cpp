@@ -0,0 +1,91 @@
+#include "headless_runner.hpp"
+#include "../services/ruby_service_pool.hpp"
+#include "../bindings/perf_module.hpp"
+#include "../utils/log.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<std::string> collect_scripts(const std::vector<std::string>& paths) {
+    std::vector<std::string> scripts;
+    for (const std::string& path : paths) {
+        std::error_code error;
+        if (!fs::is_directory(path, error)) {
+            scripts.push_back(path); // Missing files surface as per-script errors
+            continue;
+        }
+        std::vector<std::string> found;
+        for (const auto& entry : fs::directory_iterator(path, error)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".rb") {
+                found.push_back(entry.path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        scripts.insert(scripts.end(), found.begin(), found.end());
+    }
+    return scripts;
+}
+
+} // namespace
+
+int run_headless(const HeadlessOptions& options) {
+    std::vector<std::string> scripts =
+        collect_scripts(options.paths.empty() ? std::vector<std::string>{"scripts"} : options.paths);
+    if (scripts.empty()) {
+        LOG_WARN(App, "No Ruby scripts to run.");
+        return 0;
+    }
+
+    auto telemetry = std::make_shared<Telemetry>();
+    RubyServicePool pool(options.jobs, telemetry);
+    pool.add_extension([&telemetry](mrb_state* mrb) {
+        install_perf_module(mrb, telemetry.get());
+    });
+    if (options.timeout.count() > 0) {
+        pool.set_eval_timeout(options.timeout);
+    }
+    if (options.memory_limit > 0) {
+        pool.set_memory_limit(options.memory_limit);
+    }
+    if (!options.profile_path.empty()) {
+        pool.start_profiling(options.profile_interval);
+    }
+
+    std::vector<ScriptJob> batch;
+    batch.reserve(scripts.size());
+    for (const std::string& script : scripts) {
+        batch.push_back(ScriptJob::file(script));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> results = pool.run_batch(batch);
+    [[maybe_unused]] double elapsed_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (!options.profile_path.empty()) {
+        pool.stop_profiling();
+        std::ofstream profile(options.profile_path);
+        profile << pool.profile_folded(true);
+        if (!profile) {
+            LOG_ERROR(App, "Failed to write profile to %s.", options.profile_path.c_str());
+        }
+    }
+
+    int status = 0;
+    for (size_t i = 0; i < scripts.size(); ++i) {
+        std::printf("%s: %s\n", scripts[i].c_str(), results[i].c_str());
+        if (results[i].compare(0, 7, "Error: ") == 0) {
+            status = 1;
+        }
+    }
+    std::fflush(stdout);
+    LOG_INFO(App, "Ran %zu scripts on %zu interpreters in %.2f ms.",
+             scripts.size(), pool.size(), elapsed_ms);
+    return status;
+}
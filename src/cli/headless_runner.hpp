@@ -0,0 +1,20 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Runs Ruby scripts through a RubyServicePool without opening a display
+struct HeadlessOptions {
+    // Files or directories (every *.rb inside, sorted); defaults to scripts/
+    std::vector<std::string> paths;
+    size_t jobs = 0; // 0 = one interpreter per hardware thread
+    std::chrono::milliseconds timeout{0};
+    size_t memory_limit = 0; // Bytes per interpreter, 0 = unlimited
+    // Folded-stack profile of the whole run is written here when set
+    std::string profile_path;
+    std::chrono::microseconds profile_interval{1000};
+};
+
+// Prints each script's result in input order; returns the process exit status
+int run_headless(const HeadlessOptions& options);
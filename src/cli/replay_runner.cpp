@@ -0,0 +1,57 @@
+#include "replay_runner.hpp"
+#include "../core/container.hpp"
+#include "../interfaces/iwindow_service.hpp"
+#include "../services/window_service.hpp"
+#include "../utils/log.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(std::ceil(p * sorted.size())) - 1;
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+int run_replay(const ReplayRunOptions& options, const AppOptions& app_options) {
+    EventTraceReader trace(options.trace_path);
+
+    Container container;
+    AppModule::configure(container, app_options);
+    container.initialize();
+    auto window_service = std::dynamic_pointer_cast<WindowService>(container.resolve<IWindowService>());
+    if (!window_service) {
+        throw std::runtime_error("Replay needs the X11 window service");
+    }
+
+    ReplayOptions replay_options;
+    replay_options.original_timing = options.original_timing;
+    replay_options.checksum = options.checksum || options.expected_checksum != 0;
+    ReplayReport report = window_service->replay(trace, replay_options);
+
+    std::vector<double> sorted = report.latency_us;
+    std::sort(sorted.begin(), sorted.end());
+    std::printf("events: %zu\nframes: %llu\nwall_ms: %.2f\n", report.events,
+                static_cast<unsigned long long>(report.frames), report.wall_ms);
+    std::printf("latency_us: p50 %.1f p95 %.1f p99 %.1f max %.1f\n", percentile(sorted, 0.50),
+                percentile(sorted, 0.95), percentile(sorted, 0.99), sorted.empty() ? 0.0 : sorted.back());
+    int status = 0;
+    if (replay_options.checksum) {
+        std::printf("checksum: %016" PRIx64 "\n", report.checksum);
+        if (options.expected_checksum != 0 && report.checksum != options.expected_checksum) {
+            LOG_ERROR(App, "Final frame differs: expected %016" PRIx64 ".", options.expected_checksum);
+            status = 1;
+        }
+    }
+    std::fflush(stdout);
+    return status;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "../modules/app_module.hpp"
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Replays a trace recorded with --record into the regular window setup
+struct ReplayRunOptions {
+    std::string trace_path;
+    bool original_timing = false;
+    bool checksum = false;
+    // Non-zero: the run fails unless the final frame hashes to this
+    uint64_t expected_checksum = 0;
+};
+
+// Prints latency percentiles, frames and the checksum; returns the process exit status
+int run_replay(const ReplayRunOptions& options, const AppOptions& app_options);
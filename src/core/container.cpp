@@ -1,2 +1,202 @@
 #include "core/container.hpp"
-// Empty implementation file as all methods are templated in header
\ No newline at end of file
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <thread>
+#include <unordered_map>
+
+std::atomic<size_t> Container::next_slot_id{0};
+
+namespace {
+
+// Services being constructed on this thread, innermost last
+thread_local std::vector<const void*> construction_stack;
+thread_local std::vector<const char*> construction_names;
+
+} // namespace
+
+void Container::initialize(size_t threads) {
+    std::vector<size_t> async;
+    for (size_t id : registration_order) {
+        if (slots[id]->init == Init::Async) {
+            async.push_back(id);
+        }
+    }
+    if (async.empty()) {
+        for (size_t id : registration_order) {
+            if (slots[id]->lifetime == Lifetime::Singleton && slots[id]->init == Init::Eager) {
+                singleton(*slots[id]);
+            }
+        }
+        return;
+    }
+    build_async(async, threads);
+}
+
+void Container::build_async(const std::vector<size_t>& async, size_t threads) {
+    // Count unbuilt async dependencies; other kinds are built on demand by the factory
+    std::unordered_map<size_t, size_t> waiting;
+    std::unordered_map<size_t, std::vector<size_t>> dependents;
+    for (size_t id : async) {
+        waiting[id] = 0;
+        for (size_t dep : slots[id]->dependencies) {
+            if (dep >= slots.size() || !slots[dep]) {
+                throw std::runtime_error(std::string("Undeclared dependency of ") + slots[id]->name);
+            }
+            if (slots[dep]->init == Init::Async) {
+                waiting[id]++;
+                dependents[dep].push_back(id);
+            }
+        }
+    }
+
+    // Reject cycles before any thread could block on one
+    std::deque<size_t> ready;
+    {
+        std::unordered_map<size_t, size_t> left = waiting;
+        std::vector<size_t> order;
+        for (size_t id : async) {
+            if (left[id] == 0) {
+                order.push_back(id);
+            }
+        }
+        for (size_t i = 0; i < order.size(); ++i) {
+            for (size_t next : dependents[order[i]]) {
+                if (--left[next] == 0) {
+                    order.push_back(next);
+                }
+            }
+        }
+        if (order.size() != async.size()) {
+            throw std::runtime_error("Dependency cycle among asynchronously built services");
+        }
+        for (size_t id : async) {
+            if (waiting[id] == 0) {
+                ready.push_back(id);
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t unfinished = async.size();
+    std::exception_ptr error;
+    auto work = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            cv.wait(lock, [&]() { return !ready.empty() || unfinished == 0 || error; });
+            if (ready.empty() || error) {
+                return; // Done, or what is left depends on a failed service
+            }
+            size_t id = ready.front();
+            ready.pop_front();
+            lock.unlock();
+            std::exception_ptr failure;
+            try {
+                singleton(*slots[id]);
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            lock.lock();
+            unfinished--;
+            if (failure && !error) {
+                error = failure;
+            }
+            if (!failure) {
+                for (size_t next : dependents[id]) {
+                    if (--waiting[next] == 0) {
+                        ready.push_back(next);
+                    }
+                }
+            }
+            cv.notify_all();
+        }
+    };
+
+    if (threads == 0) {
+        // Startup work waits on disk and the X server as much as on the CPU
+        threads = std::max(2u, std::thread::hardware_concurrency());
+    }
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::min(threads, async.size()); ++i) {
+        workers.emplace_back(work);
+    }
+
+    std::exception_ptr eager_error;
+    try {
+        for (size_t id : registration_order) {
+            if (slots[id]->lifetime == Lifetime::Singleton && slots[id]->init == Init::Eager) {
+                singleton(*slots[id]);
+            }
+        }
+    } catch (...) {
+        eager_error = std::current_exception();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+            error = eager_error;
+        }
+        cv.notify_all();
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (eager_error) {
+        std::rethrow_exception(eager_error);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+Container::Scope Container::create_scope() {
+    return Scope(*this);
+}
+
+const std::shared_ptr<void>& Container::singleton(Slot& slot) {
+    if (slot.instance.load(std::memory_order_acquire)) {
+        return slot.owner;
+    }
+
+    // A same-thread cycle would deadlock on the slot mutex: report it first
+    if (std::find(construction_stack.begin(), construction_stack.end(), &slot) != construction_stack.end()) {
+        construct(slot);
+    }
+
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    if (!slot.instance.load(std::memory_order_relaxed)) {
+        slot.owner = construct(slot);
+        slot.instance.store(slot.owner.get(), std::memory_order_release);
+    }
+    return slot.owner;
+}
+
+std::shared_ptr<void> Container::construct(Slot& slot) {
+    if (std::find(construction_stack.begin(), construction_stack.end(), &slot) != construction_stack.end()) {
+        std::string path;
+        for (const char* name : construction_names) {
+            path += name;
+            path += " -> ";
+        }
+        path += slot.name;
+        throw std::runtime_error("Dependency cycle: " + path);
+    }
+
+    construction_stack.push_back(&slot);
+    construction_names.push_back(slot.name);
+    std::shared_ptr<void> instance;
+    try {
+        instance = slot.factory();
+    } catch (...) {
+        construction_stack.pop_back();
+        construction_names.pop_back();
+        throw;
+    }
+    construction_stack.pop_back();
+    construction_names.pop_back();
+
+    if (!instance) {
+        throw std::runtime_error(std::string("Factory returned null for ") + slot.name);
+    }
+    return instance;
+}
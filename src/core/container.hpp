@@ -1,30 +1,180 @@
 #pragma once
-#include <unordered_map>
+#include <atomic>
 #include <functional>
 #include <memory>
-#include <typeindex>
-#include <any>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <typeinfo>
+#include <vector>
+
+enum class Lifetime {
+    Singleton, // One instance per container, built on first resolve
+    Transient, // New instance on every resolve
+    Scoped     // One instance per Container::Scope
+};
+
+enum class Init {
+    Lazy,  // Built on first resolve
+    Eager, // Built by Container::initialize()
+    Async  // Built by Container::initialize() on a worker thread, after its declared dependencies
+};
 
 class Container {
 public:
+    class Scope;
+
+    template<typename T>
+    void register_singleton(std::function<std::shared_ptr<T>()> factory, Init init = Init::Lazy) {
+        register_slot<T>(Lifetime::Singleton, init, std::move(factory));
+    }
+
+    // Singleton built in the background by initialize(). The factory may only
+    // resolve the listed services (and lazy ones), so independent slow
+    // services start together and nothing waits across threads in a cycle.
+    template<typename T, typename... Deps>
+    void register_async(std::function<std::shared_ptr<T>()> factory) {
+        register_slot<T>(Lifetime::Singleton, Init::Async, std::move(factory));
+        slots[slot_id<T>()]->dependencies = { slot_id<Deps>()... };
+    }
+
+    template<typename T>
+    void register_transient(std::function<std::shared_ptr<T>()> factory) {
+        register_slot<T>(Lifetime::Transient, Init::Lazy, std::move(factory));
+    }
+
+    template<typename T>
+    void register_scoped(std::function<std::shared_ptr<T>()> factory) {
+        register_slot<T>(Lifetime::Scoped, Init::Lazy, std::move(factory));
+    }
+
+    template<typename T>
+    std::shared_ptr<T> resolve() {
+        Slot& slot = slot_for<T>();
+        switch (slot.lifetime) {
+            case Lifetime::Singleton: {
+                // Aliasing constructor: shares ownership without another lookup
+                const std::shared_ptr<void>& owner = singleton(slot);
+                return std::shared_ptr<T>(owner, static_cast<T*>(owner.get()));
+            }
+            case Lifetime::Transient:
+                return std::static_pointer_cast<T>(construct(slot));
+            case Lifetime::Scoped:
+                break;
+        }
+        throw std::runtime_error(std::string("Scoped service resolved outside a scope: ") + slot.name);
+    }
+
+    // Hot-path access to a singleton: after first construction this is a
+    // bounds check and an atomic pointer load.
+    template<typename T>
+    T& get() {
+        size_t id = slot_id<T>();
+        if (id < slots.size() && slots[id]) {
+            if (void* instance = slots[id]->instance.load(std::memory_order_acquire)) {
+                return *static_cast<T*>(instance);
+            }
+        }
+        Slot& slot = slot_for<T>();
+        if (slot.lifetime != Lifetime::Singleton) {
+            throw std::runtime_error(std::string("get() requires a singleton: ") + slot.name);
+        }
+        return *static_cast<T*>(singleton(slot).get());
+    }
+
+    // Builds every Init::Async singleton on up to threads workers (0: one per
+    // hardware thread, at least two) while the calling thread builds the Init::Eager ones in
+    // registration order; an eager factory resolving an async service waits
+    // for it. Rethrows the first factory error once all workers are done.
+    void initialize(size_t threads = 0);
+
+    Scope create_scope();
+
+    // Registration must finish before services are resolved from other threads
+    class Scope {
+    public:
+        explicit Scope(Container& owner) : owner(owner) {}
+
+        template<typename T>
+        std::shared_ptr<T> resolve() {
+            Slot& slot = owner.slot_for<T>();
+            if (slot.lifetime != Lifetime::Scoped) {
+                return owner.resolve<T>();
+            }
+            size_t id = slot_id<T>();
+            if (instances.size() <= id) {
+                instances.resize(id + 1);
+            }
+            if (!instances[id]) {
+                instances[id] = owner.construct(slot);
+            }
+            return std::static_pointer_cast<T>(instances[id]);
+        }
+
+    private:
+        Container& owner;
+        std::vector<std::shared_ptr<void>> instances;
+    };
+
+private:
+    struct Slot {
+        Lifetime lifetime = Lifetime::Singleton;
+        Init init = Init::Lazy;
+        const char* name = "";
+        std::function<std::shared_ptr<void>()> factory;
+        std::vector<size_t> dependencies; // Slot ids, Init::Async only
+
+        // Singleton state: instance is published once owner is set
+        std::mutex mutex;
+        std::shared_ptr<void> owner;
+        std::atomic<void*> instance{nullptr};
+    };
+
+    // Indexed by slot_id<T>(); unique_ptr keeps Slot addresses stable
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::vector<size_t> registration_order;
+
+    static std::atomic<size_t> next_slot_id;
+
+    // Static per-type slot id, assigned once per process on first use
+    template<typename T>
+    static size_t slot_id() {
+        static const size_t id = next_slot_id.fetch_add(1);
+        return id;
+    }
+
     template<typename T>
-    void register_singleton(std::function<std::shared_ptr<T>()> factory) {
-        services[std::type_index(typeid(T))] = [factory]() -> std::any {
+    void register_slot(Lifetime lifetime, Init init, std::function<std::shared_ptr<T>()> factory) {
+        size_t id = slot_id<T>();
+        if (slots.size() <= id) {
+            slots.resize(id + 1);
+        }
+        auto slot = std::make_unique<Slot>();
+        slot->lifetime = lifetime;
+        slot->init = init;
+        slot->name = typeid(T).name();
+        // shared_ptr<void> keeps the T* unchanged, so static casts back to T are exact
+        slot->factory = [factory]() -> std::shared_ptr<void> {
             return factory();
         };
+        if (!slots[id]) {
+            registration_order.push_back(id);
+        }
+        slots[id] = std::move(slot);
     }
 
     template<typename T>
-    std::shared_ptr<T> resolve() {
-        auto it = services.find(std::type_index(typeid(T)));
-        if (it != services.end()) {
-            return std::any_cast<std::shared_ptr<T>>(it->second());
+    Slot& slot_for() {
+        size_t id = slot_id<T>();
+        if (id < slots.size() && slots[id]) {
+            return *slots[id];
         }
         throw std::runtime_error(std::string("Service not registered: ") + typeid(T).name());
     }
 
-private:
-    std::unordered_map<std::type_index, std::function<std::any()>> services;
-};
\ No newline at end of file
+    // Returns the owning pointer, constructing it once (thread-safe)
+    const std::shared_ptr<void>& singleton(Slot& slot);
+    // Runs the factory with cycle detection
+    std::shared_ptr<void> construct(Slot& slot);
+    void build_async(const std::vector<size_t>& async, size_t threads);
+};
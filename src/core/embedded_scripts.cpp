@@ -0,0 +1,10 @@
+#include "embedded_scripts.hpp"
+
+const EmbeddedScript* find_embedded_script(const std::string& name) {
+    for (const EmbeddedScript* script = kEmbeddedScripts; script->name; ++script) {
+        if (name == script->name) {
+            return script;
+        }
+    }
+    return nullptr;
+}
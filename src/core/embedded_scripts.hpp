@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// mruby bytecode compiled from scripts/*.rb by mrbc at build time
+struct EmbeddedScript {
+    const char* name;       // File name under scripts/, e.g. "hello.rb"
+    const uint8_t* bytecode; // RITE image, loadable with mrb_load_irep
+};
+
+// Generated table (see src/core/embedded_scripts.cpp.in), ended by a null entry
+extern const EmbeddedScript kEmbeddedScripts[];
+
+// nullptr when the script was not embedded (e.g. mrbc was unavailable)
+const EmbeddedScript* find_embedded_script(const std::string& name);
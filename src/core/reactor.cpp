@@ -0,0 +1,212 @@
+#include "reactor.hpp"
+#include "../utils/log.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+Reactor::Reactor() {
+    // steady_clock is CLOCK_MONOTONIC, so deadlines can be armed as absolute times
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        throw std::runtime_error("Failed to create timerfd for the reactor");
+    }
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        close(timer_fd);
+        throw std::runtime_error("Failed to create eventfd for the reactor");
+    }
+}
+
+Reactor::~Reactor() {
+    close(timer_fd);
+    close(wake_fd);
+}
+
+void Reactor::add_fd(int fd, Callback on_readable) {
+    remove_fd(fd);
+    watched.emplace_back(fd, std::move(on_readable));
+}
+
+void Reactor::remove_fd(int fd) {
+    watched.erase(std::remove_if(watched.begin(), watched.end(),
+                                 [fd](const std::pair<int, Callback>& entry) { return entry.first == fd; }),
+                  watched.end());
+}
+
+Reactor::TimerId Reactor::add_timer(std::chrono::nanoseconds delay, std::chrono::nanoseconds interval,
+                                    Callback callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    TimerId id = next_timer++;
+    Clock::time_point due = Clock::now() + std::max(delay, std::chrono::nanoseconds(0));
+    timers.emplace(id, Timer{due, interval, std::move(callback)});
+    schedule.emplace(due, id);
+    if (due < armed_due) {
+        arm_timer_fd();
+    }
+    return id;
+}
+
+bool Reactor::cancel_timer(TimerId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // The heap entry stays behind and is dropped when it comes up
+    if (timers.erase(id) == 0) {
+        return false;
+    }
+    arm_timer_fd(); // No spurious wakeup for a timer that no longer exists
+    return true;
+}
+
+size_t Reactor::timer_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return timers.size();
+}
+
+void Reactor::post(Callback callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        posted.push_back(std::move(callback));
+    }
+    wake();
+}
+
+void Reactor::add_idle(IdleCallback callback) {
+    idle.push_back(std::move(callback));
+}
+
+void Reactor::wake() {
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0) {
+        LOG_ERROR(App, "Failed to wake the reactor.");
+    }
+}
+
+void Reactor::run_once(std::chrono::milliseconds timeout) {
+    std::vector<pollfd> fds;
+    fds.reserve(watched.size() + 2);
+    for (const auto& entry : watched) {
+        fds.push_back({ entry.first, POLLIN, 0 });
+    }
+    fds.push_back({ timer_fd, POLLIN, 0 });
+    fds.push_back({ wake_fd, POLLIN, 0 });
+
+    int wait_ms = timeout.count() < 0 ? -1 : static_cast<int>(timeout.count());
+    int ready = poll(fds.data(), fds.size(), idle.empty() ? wait_ms : 0);
+    while (ready == 0 && !idle.empty() && wait_ms != 0) {
+        run_idle_round();
+        ready = poll(fds.data(), fds.size(), idle.empty() ? wait_ms : 0);
+    }
+    if (ready < 0) {
+        if (errno == EINTR) {
+            return;
+        }
+        throw std::runtime_error("poll failed in reactor");
+    }
+
+    uint64_t counter;
+    if (fds[fds.size() - 2].revents & POLLIN) {
+        while (read(timer_fd, &counter, sizeof(counter)) > 0) {
+        }
+    }
+    if (fds.back().revents & POLLIN) {
+        while (read(wake_fd, &counter, sizeof(counter)) > 0) {
+        }
+    }
+    run_due_timers();
+    run_posted();
+
+    // Callbacks may add or remove watches, so look each one up again
+    for (size_t i = 0; i + 2 < fds.size(); ++i) {
+        if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+            continue;
+        }
+        auto it = std::find_if(watched.begin(), watched.end(),
+                               [&](const std::pair<int, Callback>& entry) { return entry.first == fds[i].fd; });
+        if (it != watched.end()) {
+            Callback callback = it->second; // Survives remove_fd from inside the callback
+            callback();
+        }
+    }
+}
+
+void Reactor::arm_timer_fd() {
+    // Drop heap entries of cancelled timers and stale entries of rescheduled ones
+    while (!schedule.empty()) {
+        auto it = timers.find(schedule.top().second);
+        if (it != timers.end() && it->second.due == schedule.top().first) {
+            break;
+        }
+        schedule.pop();
+    }
+
+    itimerspec spec{};
+    if (schedule.empty()) {
+        armed_due = Clock::time_point::max();
+    } else {
+        armed_due = schedule.top().first;
+        auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(armed_due.time_since_epoch());
+        spec.it_value.tv_sec = static_cast<time_t>(since_epoch.count() / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(since_epoch.count() % 1000000000);
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+            spec.it_value.tv_nsec = 1; // All zeros would disarm it
+        }
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+void Reactor::run_due_timers() {
+    std::vector<Callback> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Clock::time_point now = Clock::now();
+        while (!schedule.empty() && schedule.top().first <= now) {
+            Scheduled entry = schedule.top();
+            schedule.pop();
+            auto it = timers.find(entry.second);
+            if (it == timers.end() || it->second.due != entry.first) {
+                continue;
+            }
+            Timer& timer = it->second;
+            due.push_back(timer.callback);
+            if (timer.interval.count() > 0) {
+                // Ticks missed while the loop was busy are skipped, not replayed
+                if (timer.due <= now) {
+                    auto missed = (now - timer.due) / timer.interval;
+                    timer.due += (missed + 1) * timer.interval;
+                }
+                schedule.emplace(timer.due, entry.second);
+            } else {
+                timers.erase(it);
+            }
+        }
+        arm_timer_fd();
+    }
+    for (Callback& callback : due) {
+        callback();
+    }
+}
+
+void Reactor::run_posted() {
+    std::vector<Callback> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(posted);
+    }
+    for (Callback& callback : ready) {
+        callback();
+    }
+}
+
+void Reactor::run_idle_round() {
+    // Callbacks added during the round wait for the next one
+    std::vector<IdleCallback> round;
+    round.swap(idle);
+    for (IdleCallback& callback : round) {
+        if (callback()) {
+            idle.push_back(std::move(callback));
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Single-threaded poll loop over watched fds, a timerfd for every timer
+// and an eventfd for cross-thread wakeups. Timers and posted callbacks may
+// be added from any thread; everything runs on the thread calling run_once.
+class Reactor {
+public:
+    using Callback = std::function<void()>;
+    // Returns true while it has more work; called again on the next idle pass
+    using IdleCallback = std::function<bool()>;
+    using TimerId = uint64_t;
+    using Clock = std::chrono::steady_clock;
+
+    Reactor();
+    ~Reactor();
+
+    // Loop thread only. The callback runs whenever fd is readable.
+    void add_fd(int fd, Callback on_readable);
+    void remove_fd(int fd);
+
+    // interval zero makes a one-shot timer; a periodic timer that falls
+    // behind skips the missed ticks instead of firing them back to back
+    TimerId add_timer(std::chrono::nanoseconds delay, std::chrono::nanoseconds interval, Callback callback);
+    bool cancel_timer(TimerId id);
+    size_t timer_count() const;
+
+    // Runs callback on the loop thread during the next run_once
+    void post(Callback callback);
+    // Runs when a poll finds nothing ready, until it returns false
+    void add_idle(IdleCallback callback);
+    // Interrupts a blocking run_once
+    void wake();
+
+    // Waits up to timeout (negative: no limit) for fds, due timers or posted
+    // callbacks and dispatches them. Idle callbacks run while nothing is
+    // ready, but only when the caller is willing to wait (timeout != 0).
+    void run_once(std::chrono::milliseconds timeout);
+
+    // Disable copy
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+private:
+    struct Timer {
+        Clock::time_point due;
+        std::chrono::nanoseconds interval;
+        Callback callback;
+    };
+    using Scheduled = std::pair<Clock::time_point, TimerId>;
+
+    int timer_fd = -1;
+    int wake_fd = -1;
+    std::vector<std::pair<int, Callback>> watched;
+    std::vector<IdleCallback> idle;
+
+    // Shared with other threads
+    mutable std::mutex mutex;
+    std::unordered_map<TimerId, Timer> timers;
+    // Min-heap by due time; cancelled or rescheduled entries are skipped lazily
+    std::priority_queue<Scheduled, std::vector<Scheduled>, std::greater<Scheduled>> schedule;
+    TimerId next_timer = 1;
+    Clock::time_point armed_due = Clock::time_point::max();
+    std::vector<Callback> posted;
+
+    void arm_timer_fd(); // mutex held
+    void run_due_timers();
+    void run_posted();
+    void run_idle_round();
+};
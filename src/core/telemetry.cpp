@@ -0,0 +1,123 @@
+#include "core/telemetry.hpp"
+#include <algorithm>
+
+int Histogram::bucket_for(uint64_t ns) {
+    if (ns < 4) {
+        return static_cast<int>(ns);
+    }
+    int msb = 63 - __builtin_clzll(ns);
+    int sub = static_cast<int>((ns >> (msb - 2)) & 3);
+    return std::min((msb - 1) * 4 + sub, kBuckets - 1);
+}
+
+uint64_t Histogram::bucket_upper(int index) {
+    if (index < 4) {
+        return static_cast<uint64_t>(index) + 1;
+    }
+    int msb = index / 4 + 1;
+    uint64_t sub = static_cast<uint64_t>(index % 4);
+    return ((4 + sub) << (msb - 2)) + (1ULL << (msb - 2));
+}
+
+void Histogram::record(uint64_t ns) {
+    buckets[bucket_for(ns)].fetch_add(1, std::memory_order_relaxed);
+    samples.fetch_add(1, std::memory_order_relaxed);
+    total_ns.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t seen = max_ns.load(std::memory_order_relaxed);
+    while (ns > seen && !max_ns.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void Histogram::reset() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    samples.store(0, std::memory_order_relaxed);
+    total_ns.store(0, std::memory_order_relaxed);
+    max_ns.store(0, std::memory_order_relaxed);
+}
+
+double Histogram::mean_us() const {
+    uint64_t n = count();
+    return n ? total_ns.load(std::memory_order_relaxed) / 1000.0 / n : 0.0;
+}
+
+double Histogram::percentile_us(double p) const {
+    uint64_t n = count();
+    if (n == 0) {
+        return 0.0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p * n);
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen > rank) {
+            // Bucket upper bound, but never above the observed maximum
+            return std::min(static_cast<double>(bucket_upper(i)) / 1000.0, max_us());
+        }
+    }
+    return max_us();
+}
+
+void Telemetry::record_widget_draws(const std::vector<WidgetSample>& samples) {
+    if (samples.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(widget_mutex);
+    for (const WidgetSample& sample : samples) {
+        WidgetCost& cost = widget_costs[sample.widget];
+        cost.kind = sample.kind;
+        double us = sample.ns / 1000.0;
+        cost.draws++;
+        cost.total_us += us;
+        cost.max_us = std::max(cost.max_us, us);
+    }
+}
+
+void Telemetry::forget_widget(const void* widget) {
+    std::lock_guard<std::mutex> lock(widget_mutex);
+    widget_costs.erase(widget);
+}
+
+TelemetrySnapshot Telemetry::snapshot(size_t max_widgets) const {
+    TelemetrySnapshot snap;
+    for (int i = 0; i < static_cast<int>(Metric::Count); ++i) {
+        const Histogram& h = histograms[i];
+        auto& summary = snap.metrics[i];
+        summary.count = h.count();
+        summary.mean_us = h.mean_us();
+        summary.p50_us = h.percentile_us(0.50);
+        summary.p99_us = h.percentile_us(0.99);
+        summary.max_us = h.max_us();
+    }
+    snap.ruby_allocations = ruby_allocations.load(std::memory_order_relaxed);
+    snap.ruby_allocated_bytes = ruby_allocated_bytes.load(std::memory_order_relaxed);
+    snap.ruby_heap_bytes = ruby_heap_bytes.load(std::memory_order_relaxed);
+    snap.ruby_live_objects = ruby_live_objects.load(std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(widget_mutex);
+        snap.widgets.reserve(widget_costs.size());
+        for (const auto& entry : widget_costs) {
+            snap.widgets.push_back(entry.second);
+        }
+    }
+    std::sort(snap.widgets.begin(), snap.widgets.end(), [](const WidgetCost& a, const WidgetCost& b) {
+        return a.total_us > b.total_us;
+    });
+    if (snap.widgets.size() > max_widgets) {
+        snap.widgets.resize(max_widgets);
+    }
+    return snap;
+}
+
+void Telemetry::reset() {
+    for (auto& h : histograms) {
+        h.reset();
+    }
+    ruby_allocations.store(0, std::memory_order_relaxed);
+    ruby_allocated_bytes.store(0, std::memory_order_relaxed);
+    // Heap gauges are levels, not counters: they survive a reset
+    std::lock_guard<std::mutex> lock(widget_mutex);
+    widget_costs.clear();
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Fixed-bucket latency histogram: four sub-buckets per power of two of
+// nanoseconds, so recording is a couple of atomic adds and percentiles are
+// within ~25% of the true value.
+class Histogram {
+public:
+    static constexpr int kBuckets = 160;
+
+    void record(uint64_t ns);
+    void reset();
+
+    uint64_t count() const { return samples.load(std::memory_order_relaxed); }
+    double mean_us() const;
+    double max_us() const { return max_ns.load(std::memory_order_relaxed) / 1000.0; }
+    double percentile_us(double p) const;
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+
+    static int bucket_for(uint64_t ns);
+    static uint64_t bucket_upper(int index);
+};
+
+enum class Metric {
+    Batch,     // One main_loop batch: drain, dispatch and render
+    Frame,     // One redraw that produced pixels
+    XFlush,    // XFlush at the end of a frame
+    RubyEval,  // One execute_code/load_file evaluation
+    RubyGc,    // One idle-time GC slice
+    Count
+};
+
+struct WidgetCost {
+    std::string kind;
+    uint64_t draws = 0;
+    double total_us = 0.0;
+    double max_us = 0.0;
+};
+
+struct TelemetrySnapshot {
+    struct Summary {
+        uint64_t count = 0;
+        double mean_us = 0.0;
+        double p50_us = 0.0;
+        double p99_us = 0.0;
+        double max_us = 0.0;
+    };
+    Summary metrics[static_cast<int>(Metric::Count)];
+    uint64_t ruby_allocations = 0;
+    uint64_t ruby_allocated_bytes = 0;
+    int64_t ruby_heap_bytes = 0;   // Currently held, summed over interpreters
+    int64_t ruby_live_objects = 0;
+    std::vector<WidgetCost> widgets; // Most expensive first
+};
+
+class Telemetry {
+public:
+    void record(Metric metric, std::chrono::nanoseconds elapsed) {
+        histograms[static_cast<int>(metric)].record(static_cast<uint64_t>(elapsed.count()));
+    }
+    const Histogram& histogram(Metric metric) const { return histograms[static_cast<int>(metric)]; }
+
+    // Per-frame bulk update, keyed by widget identity
+    struct WidgetSample {
+        const void* widget;
+        const char* kind;
+        uint64_t ns;
+    };
+    void record_widget_draws(const std::vector<WidgetSample>& samples);
+    void forget_widget(const void* widget);
+
+    void add_ruby_allocations(uint64_t count, uint64_t bytes) {
+        ruby_allocations.fetch_add(count, std::memory_order_relaxed);
+        ruby_allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // Heap gauges; each interpreter reports the change since its last report
+    void adjust_ruby_heap(int64_t bytes, int64_t objects) {
+        ruby_heap_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        ruby_live_objects.fetch_add(objects, std::memory_order_relaxed);
+    }
+
+    TelemetrySnapshot snapshot(size_t max_widgets = 8) const;
+    void reset();
+
+private:
+    std::array<Histogram, static_cast<int>(Metric::Count)> histograms;
+    std::atomic<uint64_t> ruby_allocations{0};
+    std::atomic<uint64_t> ruby_allocated_bytes{0};
+    std::atomic<int64_t> ruby_heap_bytes{0};
+    std::atomic<int64_t> ruby_live_objects{0};
+
+    mutable std::mutex widget_mutex;
+    std::unordered_map<const void*, WidgetCost> widget_costs;
+};
+
+// Records the lifetime of the scope into a metric (no-op without telemetry)
+class ScopedTimer {
+public:
+    ScopedTimer(Telemetry* telemetry, Metric metric)
+        : telemetry(telemetry), metric(metric), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        if (telemetry) {
+            telemetry->record(metric, std::chrono::steady_clock::now() - start);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Telemetry* telemetry;
+    Metric metric;
+    std::chrono::steady_clock::time_point start;
+};
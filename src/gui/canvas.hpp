@@ -0,0 +1,42 @@
+#pragma once
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xft/Xft.h>
+#include <cstdint>
+
+struct CachedImage;
+
+enum class RenderBackend { Xft, Software };
+
+// Drawing surface handed to VisibleComponent::draw. One implementation
+// renders through Xft into a server-side back buffer, the other rasterizes
+// into client memory and uploads the result.
+class Canvas {
+public:
+    virtual ~Canvas() = default;
+
+    virtual RenderBackend backend() const = 0;
+    // (Re)allocates the surface; its contents are undefined afterwards
+    virtual void resize(int width, int height) = 0;
+
+    // Region in window coordinates limiting every following draw; None for no limit.
+    // Backends without exact region clipping use its bounding box.
+    virtual void setClip(Region clip) = 0;
+    virtual bool exactClip() const = 0;
+
+    virtual void fillRect(int x, int y, int width, int height, const XftColor& color) = 0;
+    // Many rectangles in one color as a single request (XRenderFillRectangles on Xft)
+    virtual void fillRects(const XRectangle* rects, int count, const XftColor& color) = 0;
+    // Glyph origins are on the baseline, as for XftDrawGlyphFontSpec
+    virtual void drawGlyphs(const XftColor& color, const XftGlyphFontSpec* glyphs, int count) = 0;
+    // Composites the image with its top-left corner at x, y. Xft draws its
+    // Picture, software its client pixels; an image without either is skipped.
+    virtual void drawImage(const CachedImage& image, int x, int y) = 0;
+
+    // Copies the area of the finished frame to the window
+    virtual void present(Window window, GC gc, Region area) = 0;
+
+    // Hash of the back buffer's pixels (RGB only), to compare frames across runs.
+    // Reads the whole surface back; meant for tests and trace replay, not per frame.
+    virtual uint64_t checksum() = 0;
+};
@@ -0,0 +1,66 @@
+#include "damage_tracker.hpp"
+#include <stdexcept>
+
+DamageTracker::DamageTracker() : region_(XCreateRegion()) {
+    if (!region_) {
+        throw std::runtime_error("Failed to create damage Region");
+    }
+}
+
+DamageTracker::~DamageTracker() {
+    if (region_) {
+        XDestroyRegion(region_);
+    }
+}
+
+void DamageTracker::add(int x, int y, int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    XRectangle rect;
+    rect.x = static_cast<short>(x);
+    rect.y = static_cast<short>(y);
+    rect.width = static_cast<unsigned short>(width);
+    rect.height = static_cast<unsigned short>(height);
+    XUnionRectWithRegion(&rect, region_, region_);
+}
+
+void DamageTracker::add(const XRectangle& rect) {
+    add(rect.x, rect.y, rect.width, rect.height);
+}
+
+void DamageTracker::add(const DamageTracker& other) {
+    XUnionRegion(region_, other.region_, region_);
+}
+
+bool DamageTracker::empty() const {
+    return XEmptyRegion(region_);
+}
+
+bool DamageTracker::intersects(const XRectangle& rect) const {
+    return XRectInRegion(region_, rect.x, rect.y, rect.width, rect.height) != RectangleOut;
+}
+
+XRectangle DamageTracker::bounds() const {
+    XRectangle box;
+    XClipBox(region_, &box);
+    return box;
+}
+
+void DamageTracker::flatten() {
+    if (empty()) {
+        return;
+    }
+    XRectangle box = bounds();
+    clear();
+    XUnionRectWithRegion(&box, region_, region_);
+}
+
+void DamageTracker::clear() {
+    Region fresh = XCreateRegion();
+    if (!fresh) {
+        throw std::runtime_error("Failed to create damage Region");
+    }
+    XDestroyRegion(region_);
+    region_ = fresh;
+}
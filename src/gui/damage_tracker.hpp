@@ -0,0 +1,31 @@
+#pragma once
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+// Accumulates the union of rectangles that must be repainted (or re-copied)
+// before the next frame is presented.
+class DamageTracker {
+public:
+    DamageTracker();
+    ~DamageTracker();
+
+    void add(int x, int y, int width, int height);
+    void add(const XRectangle& rect);
+    void add(const DamageTracker& other);
+
+    bool empty() const;
+    bool intersects(const XRectangle& rect) const;
+    XRectangle bounds() const;
+    Region region() const { return region_; }
+
+    // Replaces the region with its bounding box, for backends that clip to boxes
+    void flatten();
+    void clear();
+
+    // Disable copy
+    DamageTracker(const DamageTracker&) = delete;
+    DamageTracker& operator=(const DamageTracker&) = delete;
+
+private:
+    Region region_;
+};
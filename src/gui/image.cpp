@@ -0,0 +1,80 @@
+#include "image.hpp"
+#include <algorithm>
+
+Image::Image(Display* display,
+             Window window,
+             GC gc,
+             IImageCache& images,
+             IResourceCache& resources,
+             int x,
+             int y,
+             int width,
+             int height,
+             const std::string& path)
+    : VisibleComponent(display, window, gc, std::max(width, 0), std::max(height, 0)),
+      images_(images),
+      x_(x),
+      y_(y),
+      path_(path),
+      placeholder_(resources.color("#d8d8d8"))
+{
+    // A cached image arrives before load returns
+    request_ = images_.load(path_, width_, height_, [this](ImageHandle image) {
+        request_ = 0;
+        imageReady(std::move(image));
+    });
+}
+
+Image::~Image() {
+    if (request_ != 0) {
+        images_.cancel(request_);
+    }
+}
+
+XRectangle Image::bounds() const {
+    XRectangle rect;
+    rect.x = static_cast<short>(x_);
+    rect.y = static_cast<short>(y_);
+    rect.width = static_cast<unsigned short>(width_);
+    rect.height = static_cast<unsigned short>(height_);
+    return rect;
+}
+
+void Image::setPosition(int x, int y) {
+    if (x == x_ && y == y_) {
+        return;
+    }
+    invalidate(); // old area
+    x_ = x;
+    y_ = y;
+    invalidate(); // new area
+    boundsChanged();
+}
+
+void Image::imageReady(ImageHandle image) {
+    if (!image) {
+        return; // Already logged by the cache; the placeholder stays
+    }
+    image_ = std::move(image);
+    invalidate();
+    // Sizes left to the file or its aspect ratio are known only now
+    if (image_->width != width_ || image_->height != height_) {
+        width_ = image_->width;
+        height_ = image_->height;
+        invalidate();
+        boundsChanged();
+    }
+}
+
+void Image::draw(Canvas& canvas, Region clip) {
+    canvas.setClip(clip);
+    if (image_) {
+        canvas.drawImage(*image_, x_, y_);
+    } else {
+        canvas.fillRect(x_, y_, width_, height_, *placeholder_);
+    }
+}
+
+void Image::handleEvent(XEvent& event) {
+    (void)event;
+}
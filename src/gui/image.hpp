@@ -0,0 +1,45 @@
+#pragma once
+
+#include "visible_component.hpp"
+#include "../interfaces/iimage_cache.hpp"
+#include "../interfaces/iresource_cache.hpp"
+#include <string>
+
+// PNG/PPM file shown at x, y, scaled to width x height (0 keeps the aspect
+// ratio, both 0 the file's own size). Decoding runs in the image cache; a
+// placeholder fills the bounds until the image arrives, and stays if it fails.
+class Image : public VisibleComponent {
+public:
+    Image(Display* display,
+          Window window,
+          GC gc,
+          IImageCache& images,
+          IResourceCache& resources,
+          int x,
+          int y,
+          int width,
+          int height,
+          const std::string& path);
+    ~Image() override;
+
+    void draw(Canvas& canvas, Region clip) override;
+    void handleEvent(XEvent& event) override;
+    XRectangle bounds() const override;
+    const char* typeName() const override { return "Image"; }
+
+    // x, y is the top-left corner
+    void setPosition(int x, int y);
+
+    const std::string& path() const { return path_; }
+    bool ready() const { return image_ != nullptr; }
+
+private:
+    IImageCache& images_;
+    int x_, y_;
+    std::string path_;
+    ImageHandle image_;
+    ImageRequestId request_ = 0;
+    ColorHandle placeholder_;
+
+    void imageReady(ImageHandle image);
+};
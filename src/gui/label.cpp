@@ -1,11 +1,13 @@
 #include "label.hpp"
 #include <X11/Xft/Xft.h>
 #include <stdexcept>
-#include <iostream>
+#include "../utils/log.hpp"
+#include <algorithm>
 
 Label::Label(Display* display,
              Window window,
              GC gc, // Добавлен параметр GC
+             IResourceCache& resources,
              int x,
              int y,
              int width,
@@ -17,63 +19,130 @@ Label::Label(Display* display,
       x_(x),
       y_(y),
       text_(text),
-      font_(nullptr, XftFontDeleter{ display })
+      font_(resources.font(fontName)),
+      color_(resources.color(colorStr))
 {
-    int screen = DefaultScreen(display);
+}
+
+XRectangle Label::bounds() const {
+    int ascent = font_ ? font_->ascent : 0;
+    int descent = font_ ? font_->descent : 0;
+    XRectangle rect;
+    rect.x = static_cast<short>(x_);
+    rect.y = static_cast<short>(y_ - ascent);
+    rect.width = static_cast<unsigned short>(width_);
+    rect.height = static_cast<unsigned short>(std::max(height_, ascent + descent));
+    return rect;
+}
 
-    // Load font using Xft with RAII
-    XftFont* raw_font = XftFontOpenName(display, screen, fontName.c_str());
-    if (!raw_font) {
-        throw std::runtime_error("Failed to load font: " + fontName);
+void Label::setText(const std::string& text) {
+    if (text == text_) {
+        return;
     }
-    font_.reset(raw_font);
-    std::cout << "Loaded font: " << fontName << std::endl;
-
-    // Allocate color using Xft
-    if (!XftColorAllocName(display,
-                           DefaultVisual(display, screen),
-                           DefaultColormap(display, screen),
-                           colorStr.c_str(),
-                           &color_))
-    {
-        std::cerr << "Failed to allocate color: " << colorStr << std::endl;
-        throw std::runtime_error("Failed to allocate color: " + colorStr);
+    text_ = text;
+    layout_valid_ = false;
+    invalidate();
+}
+
+void Label::setPosition(int x, int y) {
+    if (x == x_ && y == y_) {
+        return;
     }
-    std::cout << "Allocated color: " << colorStr << std::endl;
+    invalidate(); // old area
+    x_ = x;
+    y_ = y;
+    layout_valid_ = false;
+    invalidate(); // new area
+    boundsChanged();
 }
 
-Label::~Label() {
-    int screen = DefaultScreen(display_);
-    XftColorFree(display_,
-                DefaultVisual(display_, screen),
-                DefaultColormap(display_, screen),
-                &color_);
-    std::cout << "Freed color resources for Label." << std::endl;
-    // XftFont is automatically closed by unique_ptr
+void Label::setFont(FontHandle font) {
+    if (!font || font == font_) {
+        return;
+    }
+    invalidate(); // old extents
+    font_ = std::move(font);
+    layout_valid_ = false;
+    invalidate(); // new extents
+    boundsChanged();
+}
+
+void Label::setColor(ColorHandle color) {
+    if (!color || color == color_) {
+        return;
+    }
+    color_ = std::move(color);
+    invalidate();
 }
 
-void Label::draw(Drawable drawable) {
-    int screen = DefaultScreen(display_);
+void Label::setAlignment(TextAlign align) {
+    if (align == align_) {
+        return;
+    }
+    align_ = align;
+    layout_valid_ = false;
+    invalidate();
+}
 
-    XftDrawPtr xftDraw(XftDrawCreate(display_,
-                                     drawable, // Используем переданный drawable
-                                     DefaultVisual(display_, screen),
-                                     DefaultColormap(display_, screen)),
-                       XftDrawDeleter());
+int Label::textWidth() {
+    ensureLayout();
+    return extents_.xOff;
+}
 
-    if (!xftDraw) {
-        std::cerr << "Failed to create XftDraw in Label::draw." << std::endl;
+void Label::ensureLayout() {
+    if (layout_valid_) {
         return;
     }
+    glyphs_.clear();
+    const FcChar8* data = reinterpret_cast<const FcChar8*>(text_.data());
+    int remaining = static_cast<int>(text_.size());
+
+    XftTextExtentsUtf8(display_, font_.get(), data, remaining, &extents_);
+    int pen_x = x_;
+    if (align_ == TextAlign::Center) {
+        pen_x += (width_ - extents_.xOff) / 2;
+    } else if (align_ == TextAlign::Right) {
+        pen_x += width_ - extents_.xOff;
+    }
+
+    // Decode once and keep glyph indices with absolute pen positions
+    glyphs_.reserve(text_.size());
+    while (remaining > 0) {
+        FcChar32 ucs4;
+        int used = FcUtf8ToUcs4(data, &ucs4, remaining);
+        if (used <= 0) {
+            break; // Invalid UTF-8: draw what decoded so far
+        }
+        data += used;
+        remaining -= used;
+
+        XftGlyphFontSpec spec;
+        spec.font = font_.get();
+        spec.glyph = XftCharIndex(display_, font_.get(), ucs4);
+        spec.x = static_cast<short>(pen_x);
+        spec.y = static_cast<short>(y_);
+        glyphs_.push_back(spec);
+
+        XGlyphInfo info;
+        XftGlyphExtents(display_, font_.get(), &spec.glyph, 1, &info);
+        pen_x += info.xOff;
+    }
+    layout_valid_ = true;
+}
+
+void Label::draw(Canvas& canvas, Region clip) {
+    // Text never leaks outside the label, so partial repaints stay consistent
+    XRectangle box = bounds();
+    Region textClip = XCreateRegion();
+    XUnionRectWithRegion(&box, textClip, textClip);
+    if (clip) {
+        XIntersectRegion(textClip, clip, textClip);
+    }
+    canvas.setClip(textClip);
+    XDestroyRegion(textClip);
 
-    XftDrawStringUtf8(xftDraw.get(),
-                      &color_,
-                      font_.get(),
-                      x_,
-                      y_,
-                      reinterpret_cast<const FcChar8*>(text_.c_str()),
-                      static_cast<int>(text_.size()));
-    std::cout << "Drawing label text: " << text_ << std::endl;
+    ensureLayout();
+    canvas.drawGlyphs(*color_, glyphs_.data(), static_cast<int>(glyphs_.size()));
 }
 
 void Label::handleEvent(XEvent& event) {
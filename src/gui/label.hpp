@@ -4,13 +4,18 @@
 #include <string>
 #include <X11/Xft/Xft.h>
 #include <memory>
+#include <vector>
 #include "../utils/x11_raii.hpp"
+#include "../interfaces/iresource_cache.hpp"
+
+enum class TextAlign { Left, Center, Right };
 
 class Label : public VisibleComponent {
 public:
     Label(Display* display,
           Window window,
           GC gc, // Добавлен параметр GC
+          IResourceCache& resources,
           int x,
           int y,
           int width,
@@ -19,26 +24,41 @@ public:
           const std::string& fontName = "monospace-10",
           const std::string& colorStr = "#000000");
 
-    ~Label() override;
+    ~Label() override = default;
 
-    void draw(Drawable drawable) override;
+    void draw(Canvas& canvas, Region clip) override;
     void handleEvent(XEvent& event) override;
+    XRectangle bounds() const override;
+    const char* typeName() const override { return "Label"; }
 
-    void setText(const std::string& text) { text_ = text; }
+    void setText(const std::string& text);
     const std::string& getText() const { return text_; }
 
+    // x, y is the text origin (baseline), as in the constructor
+    void setPosition(int x, int y);
+
+    // Handles come from the shared IResourceCache
+    void setFont(FontHandle font);
+    void setColor(ColorHandle color);
+
+    // Horizontal placement of the text inside the label width
+    void setAlignment(TextAlign align);
+    // Measured advance of the current text, from the layout cache
+    int textWidth();
+
 private:
     int x_, y_;
     std::string text_;
 
-    // RAII for XftFont
-    struct XftFontDeleter {
-        Display* display;
-        void operator()(XftFont* f) const {
-            if (f) XftFontClose(display, f);
-        }
-    };
-    std::unique_ptr<XftFont, XftFontDeleter> font_;
+    // Shared with every other widget using the same font/color
+    FontHandle font_;
+    ColorHandle color_;
+    TextAlign align_ = TextAlign::Left;
+
+    // Layout cache: rebuilt only after text, font, position or alignment change
+    bool layout_valid_ = false;
+    XGlyphInfo extents_{};
+    std::vector<XftGlyphFontSpec> glyphs_;
 
-    XftColor color_;
+    void ensureLayout();
 };
\ No newline at end of file
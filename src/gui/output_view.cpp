@@ -0,0 +1,173 @@
+#include "output_view.hpp"
+#include "../utils/log.hpp"
+#include <algorithm>
+
+OutputView::OutputView(Display* display,
+                       Window window,
+                       GC gc,
+                       IResourceCache& resources,
+                       int x,
+                       int y,
+                       int width,
+                       int height,
+                       const std::string& fontName,
+                       const std::string& colorStr)
+    : VisibleComponent(display, window, gc, width, height),
+      x_(x),
+      y_(y),
+      font_(resources.font(fontName)),
+      color_(resources.color(colorStr))
+{
+    rows_.resize(visibleLines());
+}
+
+XRectangle OutputView::bounds() const {
+    XRectangle rect;
+    rect.x = static_cast<short>(x_);
+    rect.y = static_cast<short>(y_);
+    rect.width = static_cast<unsigned short>(width_);
+    rect.height = static_cast<unsigned short>(height_);
+    return rect;
+}
+
+size_t OutputView::visibleLines() const {
+    return static_cast<size_t>(std::max(1, (height_ - 2 * kPadding) / lineHeight()));
+}
+
+void OutputView::append(const std::string& text) {
+    if (text.empty()) {
+        return;
+    }
+    // The last line grows, and every new line after it may come into view
+    size_t first = lines_.size() - 1;
+    lines_.append(text);
+    invalidateRows(first, lines_.size() - 1);
+}
+
+void OutputView::setText(const std::string& text) {
+    clear();
+    append(text);
+}
+
+void OutputView::clear() {
+    if (lines_.size() == 1 && lines_.bytes() == 0) {
+        return;
+    }
+    lines_.clear();
+    top_line_ = 0;
+    for (RowLayout& row : rows_) {
+        row.line = static_cast<size_t>(-1);
+    }
+    invalidate();
+}
+
+void OutputView::scrollTo(size_t line) {
+    line = std::min(line, lines_.size() - 1);
+    if (line == top_line_) {
+        return;
+    }
+    top_line_ = line;
+    invalidate();
+}
+
+void OutputView::invalidateRows(size_t first_line, size_t last_line) {
+    if (!damage_) {
+        return;
+    }
+    size_t visible_end = top_line_ + rows_.size(); // Exclusive
+    first_line = std::max(first_line, top_line_);
+    last_line = std::min(last_line, visible_end - 1);
+    if (first_line > last_line) {
+        return; // Off screen: nothing to repaint
+    }
+    int line_height = lineHeight();
+    int top = y_ + kPadding + static_cast<int>(first_line - top_line_) * line_height;
+    int rows = static_cast<int>(last_line - first_line + 1);
+    damage_->add(x_, top, width_, rows * line_height);
+}
+
+const OutputView::RowLayout& OutputView::layoutRow(size_t row) {
+    RowLayout& cached = rows_[row];
+    size_t line = top_line_ + row;
+    std::string_view text = lines_.line(line);
+    if (cached.line == line && cached.length == text.size()) {
+        return cached;
+    }
+    cached.line = line;
+    cached.length = text.size();
+    cached.glyphs.clear();
+
+    // Decode only as far as the right edge; the rest of a long line is never touched
+    int limit = width_ - kPadding;
+    int pen_x = kPadding;
+    const FcChar8* data = reinterpret_cast<const FcChar8*>(text.data());
+    int remaining = static_cast<int>(text.size());
+    while (remaining > 0 && pen_x < limit) {
+        FcChar32 ucs4;
+        int used = FcUtf8ToUcs4(data, &ucs4, remaining);
+        if (used <= 0) {
+            break;
+        }
+        data += used;
+        remaining -= used;
+
+        XftGlyphFontSpec spec;
+        spec.font = font_.get();
+        spec.glyph = XftCharIndex(display_, font_.get(), ucs4);
+        spec.x = static_cast<short>(pen_x); // Relative to x_; the row's y is added when drawing
+        spec.y = 0;
+        cached.glyphs.push_back(spec);
+
+        XGlyphInfo info;
+        XftGlyphExtents(display_, font_.get(), &spec.glyph, 1, &info);
+        pen_x += info.xOff;
+    }
+    return cached;
+}
+
+void OutputView::handleEvent(XEvent& event) {
+    if (event.type != ButtonPress) {
+        return;
+    }
+    XRectangle box = bounds();
+    int px = event.xbutton.x;
+    int py = event.xbutton.y;
+    if (px < box.x || py < box.y || px >= box.x + box.width || py >= box.y + box.height) {
+        return;
+    }
+    if (event.xbutton.button == Button4) {
+        scrollTo(top_line_ > 3 ? top_line_ - 3 : 0);
+    } else if (event.xbutton.button == Button5) {
+        scrollTo(top_line_ + 3);
+    }
+}
+
+void OutputView::draw(Canvas& canvas, Region clip) {
+    XRectangle box = bounds();
+    Region viewClip = XCreateRegion();
+    XUnionRectWithRegion(&box, viewClip, viewClip);
+    if (clip) {
+        XIntersectRegion(viewClip, clip, viewClip);
+    }
+    canvas.setClip(viewClip);
+
+    int line_height = lineHeight();
+    size_t count = std::min(rows_.size(), lines_.size() - top_line_);
+    for (size_t row = 0; row < count; ++row) {
+        int top = y_ + kPadding + static_cast<int>(row) * line_height;
+        if (XRectInRegion(viewClip, x_, top, width_, line_height) == RectangleOut) {
+            continue;
+        }
+        const RowLayout& layout = layoutRow(row);
+        if (layout.glyphs.empty()) {
+            continue;
+        }
+        specs_.assign(layout.glyphs.begin(), layout.glyphs.end());
+        for (XftGlyphFontSpec& spec : specs_) {
+            spec.x = static_cast<short>(spec.x + x_);
+            spec.y = static_cast<short>(top + font_->ascent);
+        }
+        canvas.drawGlyphs(*color_, specs_.data(), static_cast<int>(specs_.size()));
+    }
+    XDestroyRegion(viewClip);
+}
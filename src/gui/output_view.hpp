@@ -0,0 +1,65 @@
+#pragma once
+
+#include "visible_component.hpp"
+#include "../interfaces/iresource_cache.hpp"
+#include "../utils/line_store.hpp"
+#include "../utils/x11_raii.hpp"
+#include <X11/Xft/Xft.h>
+#include <string>
+#include <vector>
+
+// Scrollable read-only text area for evaluation results. Output lives in a
+// chunked LineStore; only the lines inside the viewport are laid out and
+// drawn, and each of those only up to the right edge.
+class OutputView : public VisibleComponent {
+public:
+    OutputView(Display* display,
+               Window window,
+               GC gc,
+               IResourceCache& resources,
+               int x,
+               int y,
+               int width,
+               int height,
+               const std::string& fontName = "monospace-10",
+               const std::string& colorStr = "#000000");
+
+    void draw(Canvas& canvas, Region clip) override;
+    // Mouse wheel scrolls
+    void handleEvent(XEvent& event) override;
+    XRectangle bounds() const override;
+    long eventMask() const override { return ButtonPressMask; }
+    const char* typeName() const override { return "OutputView"; }
+
+    // Appending damages only the lines that became visible or changed
+    void append(const std::string& text);
+    void setText(const std::string& text);
+    void clear();
+
+    size_t lineCount() const { return lines_.size(); }
+    void scrollTo(size_t line);
+
+private:
+    static constexpr int kPadding = 3;
+
+    // Layout of one visible row, tagged with the line it was built for
+    struct RowLayout {
+        size_t line = static_cast<size_t>(-1);
+        size_t length = 0; // Line length in bytes when laid out (lines only grow at the end)
+        std::vector<XftGlyphFontSpec> glyphs;
+    };
+
+    int x_, y_;
+    LineStore lines_;
+    size_t top_line_ = 0;
+    std::vector<RowLayout> rows_;
+
+    FontHandle font_;
+    ColorHandle color_;
+    std::vector<XftGlyphFontSpec> specs_; // Scratch, reused every frame
+
+    int lineHeight() const { return font_->ascent + font_->descent; }
+    size_t visibleLines() const;
+    const RowLayout& layoutRow(size_t row);
+    void invalidateRows(size_t first_line, size_t last_line);
+};
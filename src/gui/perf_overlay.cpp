@@ -0,0 +1,127 @@
+#include "perf_overlay.hpp"
+#include "../utils/log.hpp"
+#include <cstdio>
+
+PerfOverlay::PerfOverlay(Display* display,
+                         Window window,
+                         GC gc,
+                         IResourceCache& resources,
+                         int x,
+                         int y,
+                         int width)
+    : VisibleComponent(display, window, gc, width, 0),
+      x_(x),
+      y_(y),
+      lines_(kLines),
+      font_(resources.font("monospace-8")),
+      text_color_(resources.color("#e0e0e0")),
+      background_(resources.color("#202020"))
+{
+    height_ = kLines * (font_->ascent + font_->descent) + 2 * kPadding;
+}
+
+XRectangle PerfOverlay::bounds() const {
+    XRectangle rect;
+    rect.x = static_cast<short>(x_);
+    rect.y = static_cast<short>(y_);
+    rect.width = static_cast<unsigned short>(width_);
+    rect.height = static_cast<unsigned short>(height_);
+    return rect;
+}
+
+void PerfOverlay::setVisible(bool visible) {
+    if (visible == visible_) {
+        return;
+    }
+    visible_ = visible;
+    invalidate();
+}
+
+void PerfOverlay::setPosition(int x, int y) {
+    if (x == x_ && y == y_) {
+        return;
+    }
+    invalidate();
+    x_ = x;
+    y_ = y;
+    invalidate();
+}
+
+void PerfOverlay::update(const TelemetrySnapshot& snapshot) {
+    if (!visible_) {
+        return;
+    }
+    auto summary = [](const TelemetrySnapshot::Summary& s, const char* name) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-6s p50 %7.0fus p99 %7.0fus n=%llu",
+                      name, s.p50_us, s.p99_us, static_cast<unsigned long long>(s.count));
+        return std::string(line);
+    };
+
+    std::vector<std::string> next(kLines);
+    next[0] = summary(snapshot.metrics[static_cast<int>(Metric::Frame)], "frame");
+    next[1] = summary(snapshot.metrics[static_cast<int>(Metric::Batch)], "batch");
+    next[2] = summary(snapshot.metrics[static_cast<int>(Metric::XFlush)], "flush");
+    next[3] = summary(snapshot.metrics[static_cast<int>(Metric::RubyEval)], "ruby");
+    next[4] = summary(snapshot.metrics[static_cast<int>(Metric::RubyGc)], "gc");
+    char line[128];
+    std::snprintf(line, sizeof(line), "allocs %llu (%llu KiB) heap %lld KiB",
+                  static_cast<unsigned long long>(snapshot.ruby_allocations),
+                  static_cast<unsigned long long>(snapshot.ruby_allocated_bytes / 1024),
+                  static_cast<long long>(snapshot.ruby_heap_bytes / 1024));
+    next[5] = line;
+    for (size_t i = 0; i < 2 && i < snapshot.widgets.size(); ++i) {
+        const WidgetCost& cost = snapshot.widgets[i];
+        std::snprintf(line, sizeof(line), "%-11s avg %6.1fus max %6.0fus",
+                      cost.kind.c_str(), cost.draws ? cost.total_us / cost.draws : 0.0, cost.max_us);
+        next[6 + i] = line;
+    }
+
+    if (next != lines_) {
+        lines_.swap(next);
+        invalidate();
+    }
+}
+
+void PerfOverlay::draw(Canvas& canvas, Region clip) {
+    if (!visible_) {
+        return;
+    }
+    canvas.setClip(clip);
+    canvas.fillRect(x_, y_, width_, height_, *background_);
+
+    int line_height = font_->ascent + font_->descent;
+    int baseline = y_ + kPadding + font_->ascent;
+    for (const std::string& text : lines_) {
+        specs_.clear();
+        const FcChar8* data = reinterpret_cast<const FcChar8*>(text.data());
+        int remaining = static_cast<int>(text.size());
+        int pen_x = x_ + kPadding;
+        while (remaining > 0) {
+            FcChar32 ucs4;
+            int used = FcUtf8ToUcs4(data, &ucs4, remaining);
+            if (used <= 0) {
+                break;
+            }
+            data += used;
+            remaining -= used;
+
+            XftGlyphFontSpec spec;
+            spec.font = font_.get();
+            spec.glyph = XftCharIndex(display_, font_.get(), ucs4);
+            spec.x = static_cast<short>(pen_x);
+            spec.y = static_cast<short>(baseline);
+            specs_.push_back(spec);
+
+            XGlyphInfo info;
+            XftGlyphExtents(display_, font_.get(), &spec.glyph, 1, &info);
+            pen_x += info.xOff;
+        }
+        canvas.drawGlyphs(*text_color_, specs_.data(), static_cast<int>(specs_.size()));
+        baseline += line_height;
+    }
+}
+
+void PerfOverlay::handleEvent(XEvent& event) {
+    (void)event;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "visible_component.hpp"
+#include "../core/telemetry.hpp"
+#include "../interfaces/iresource_cache.hpp"
+#include "../utils/x11_raii.hpp"
+#include <string>
+#include <vector>
+
+// Frame/evaluation statistics drawn over the top-right corner; toggled with F12
+class PerfOverlay : public VisibleComponent {
+public:
+    PerfOverlay(Display* display,
+                Window window,
+                GC gc,
+                IResourceCache& resources,
+                int x,
+                int y,
+                int width);
+
+    void draw(Canvas& canvas, Region clip) override;
+    void handleEvent(XEvent& event) override;
+    XRectangle bounds() const override;
+    const char* typeName() const override { return "PerfOverlay"; }
+
+    void setVisible(bool visible);
+    bool isVisible() const { return visible_; }
+    void setPosition(int x, int y);
+
+    // Reformats the text; damages the overlay only when something changed
+    void update(const TelemetrySnapshot& snapshot);
+
+private:
+    static constexpr int kLines = 8;
+    static constexpr int kPadding = 4;
+
+    int x_, y_;
+    bool visible_ = false;
+    std::vector<std::string> lines_;
+
+    FontHandle font_;
+    ColorHandle text_color_;
+    ColorHandle background_;
+    std::vector<XftGlyphFontSpec> specs_; // Scratch reused across lines and frames
+};
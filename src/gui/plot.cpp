@@ -0,0 +1,280 @@
+#include "plot.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float kNoLow = INFINITY;
+constexpr float kNoHigh = -INFINITY;
+
+} // namespace
+
+Plot::Plot(Display* display,
+           Window window,
+           GC gc,
+           IResourceCache& resources,
+           int x,
+           int y,
+           int width,
+           int height,
+           const std::string& background)
+    : VisibleComponent(display, window, gc, width, height),
+      x_(x),
+      y_(y),
+      background_(resources.color(background)),
+      default_color_(resources.color("#004400"))
+{
+}
+
+XRectangle Plot::bounds() const {
+    XRectangle rect;
+    rect.x = static_cast<short>(x_);
+    rect.y = static_cast<short>(y_);
+    rect.width = static_cast<unsigned short>(std::max(width_, 0));
+    rect.height = static_cast<unsigned short>(std::max(height_, 0));
+    return rect;
+}
+
+void Plot::setPosition(int x, int y) {
+    if (x == x_ && y == y_) {
+        return;
+    }
+    invalidate(); // old area
+    x_ = x;
+    y_ = y;
+    invalidate(); // new area
+    boundsChanged();
+}
+
+Plot::Series& Plot::seriesAt(size_t index) {
+    while (series_.size() <= index) {
+        series_.emplace_back();
+        series_.back().color = default_color_;
+    }
+    return series_[index];
+}
+
+void Plot::setSeries(size_t index, std::vector<float> samples, ColorHandle color) {
+    if (index >= kMaxSeries) {
+        return;
+    }
+    Series& series = seriesAt(index);
+    if (color) {
+        series.color = std::move(color);
+    }
+    series.samples = std::move(samples);
+    series.rebuild();
+    invalidate();
+}
+
+void Plot::appendSamples(size_t index, const float* samples, size_t count) {
+    if (index >= kMaxSeries) {
+        return;
+    }
+    Series& series = seriesAt(index);
+    series.samples.reserve(series.samples.size() + count);
+    for (size_t i = 0; i < count; ++i) {
+        series.push(samples[i]);
+    }
+    invalidate();
+}
+
+void Plot::clear() {
+    if (series_.empty()) {
+        return;
+    }
+    series_.clear();
+    invalidate();
+}
+
+size_t Plot::sampleCount(size_t index) const {
+    return index < series_.size() ? series_[index].samples.size() : 0;
+}
+
+void Plot::setRange(float low, float high) {
+    bool autoscale = !(low < high);
+    if (autoscale == autoscale_ && (autoscale || (low == low_ && high == high_))) {
+        return;
+    }
+    autoscale_ = autoscale;
+    if (!autoscale) {
+        low_ = low;
+        high_ = high;
+    }
+    invalidate();
+}
+
+void Plot::Series::rebuild() {
+    levels.clear();
+    if (samples.empty()) {
+        return;
+    }
+    std::vector<Bounds> leaves((samples.size() + kLeafSamples - 1) / kLeafSamples, Bounds{ kNoLow, kNoHigh });
+    for (size_t i = 0; i < samples.size(); ++i) {
+        Bounds& leaf = leaves[i / kLeafSamples];
+        leaf.low = std::fmin(leaf.low, samples[i]);
+        leaf.high = std::fmax(leaf.high, samples[i]);
+    }
+    levels.push_back(std::move(leaves));
+    while (levels.back().size() > 1) {
+        const std::vector<Bounds>& below = levels.back();
+        std::vector<Bounds> row((below.size() + 1) / 2);
+        for (size_t i = 0; i < row.size(); ++i) {
+            row[i] = below[2 * i];
+            if (2 * i + 1 < below.size()) {
+                row[i].low = std::fmin(row[i].low, below[2 * i + 1].low);
+                row[i].high = std::fmax(row[i].high, below[2 * i + 1].high);
+            }
+        }
+        levels.push_back(std::move(row));
+    }
+}
+
+void Plot::Series::push(float value) {
+    samples.push_back(value);
+    size_t index = (samples.size() - 1) / kLeafSamples;
+    if (levels.empty()) {
+        levels.emplace_back();
+    }
+    if (index == levels[0].size()) {
+        levels[0].push_back(Bounds{ std::fmin(kNoLow, value), std::fmax(kNoHigh, value) });
+    } else {
+        levels[0][index].low = std::fmin(levels[0][index].low, value);
+        levels[0][index].high = std::fmax(levels[0][index].high, value);
+    }
+    // Only the last entry of each level changes; a level appears once the one below has two
+    for (size_t level = 1; levels[level - 1].size() > 1; ++level) {
+        index /= 2;
+        if (levels.size() == level) {
+            levels.emplace_back();
+        }
+        const std::vector<Bounds>& below = levels[level - 1];
+        Bounds merged = below[2 * index];
+        if (2 * index + 1 < below.size()) {
+            merged.low = std::fmin(merged.low, below[2 * index + 1].low);
+            merged.high = std::fmax(merged.high, below[2 * index + 1].high);
+        }
+        std::vector<Bounds>& row = levels[level];
+        if (index == row.size()) {
+            row.push_back(merged);
+        } else {
+            row[index] = merged;
+        }
+    }
+}
+
+Plot::Bounds Plot::Series::range(size_t begin, size_t end) const {
+    Bounds out{ kNoLow, kNoHigh };
+    auto scan = [&](size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) {
+            out.low = std::fmin(out.low, samples[i]);
+            out.high = std::fmax(out.high, samples[i]);
+        }
+    };
+    // Whole leaves inside the range come from the pyramid, the ragged ends from the samples
+    size_t first = (begin + kLeafSamples - 1) / kLeafSamples;
+    size_t last = end / kLeafSamples;
+    if (first >= last) {
+        scan(begin, end);
+        return out;
+    }
+    scan(begin, first * kLeafSamples);
+    scan(last * kLeafSamples, end);
+    for (size_t level = 0; first < last && level < levels.size(); ++level) {
+        const std::vector<Bounds>& row = levels[level];
+        if (first & 1) {
+            out.low = std::fmin(out.low, row[first].low);
+            out.high = std::fmax(out.high, row[first].high);
+            ++first;
+        }
+        if (last & 1) {
+            --last;
+            out.low = std::fmin(out.low, row[last].low);
+            out.high = std::fmax(out.high, row[last].high);
+        }
+        first /= 2;
+        last /= 2;
+    }
+    return out;
+}
+
+Plot::Bounds Plot::visibleRange() const {
+    if (!autoscale_) {
+        return Bounds{ low_, high_ };
+    }
+    Bounds out{ kNoLow, kNoHigh };
+    for (const Series& series : series_) {
+        Bounds all = series.range(0, series.samples.size());
+        out.low = std::fmin(out.low, all.low);
+        out.high = std::fmax(out.high, all.high);
+    }
+    if (!(out.low <= out.high) || std::isinf(out.low) || std::isinf(out.high)) {
+        return Bounds{ 0.0f, 1.0f }; // Nothing finite to fit
+    }
+    if (out.low == out.high) {
+        out.low -= 0.5f;
+        out.high += 0.5f;
+    }
+    return out;
+}
+
+void Plot::draw(Canvas& canvas, Region clip) {
+    canvas.setClip(clip);
+    canvas.fillRect(x_, y_, width_, height_, *background_);
+    if (width_ <= 0 || height_ <= 0 || series_.empty()) {
+        return;
+    }
+
+    Bounds view = visibleRange();
+    float scale = static_cast<float>(height_ - 1) / (view.high - view.low);
+    int bottom = y_ + height_ - 1;
+    auto to_y = [&](float value) {
+        float offset = std::min(std::max((value - view.low) * scale, 0.0f), static_cast<float>(height_ - 1));
+        return bottom - static_cast<int>(std::lround(offset));
+    };
+
+    size_t columns = static_cast<size_t>(width_);
+    for (const Series& series : series_) {
+        size_t count = series.samples.size();
+        if (count == 0) {
+            continue;
+        }
+        // One vertical span per pixel column: the min/max of the samples that land in it
+        rects_.clear();
+        size_t previous = count;
+        for (size_t column = 0; column < columns; ++column) {
+            size_t begin = column * count / columns;
+            size_t end = std::max((column + 1) * count / columns, begin + 1);
+            size_t from = begin;
+            if (begin > 0 && begin != previous) {
+                --from; // Joins onto the last sample of the column before
+            }
+            previous = begin;
+            Bounds span = series.range(from, end);
+            if (!(span.low <= span.high) || span.high < view.low || span.low > view.high) {
+                continue; // Only NaNs, or entirely outside a fixed range
+            }
+            int top = to_y(span.high);
+            int height = to_y(span.low) - top + 1;
+            int x = x_ + static_cast<int>(column);
+            if (!rects_.empty()) {
+                XRectangle& last = rects_.back();
+                if (last.x + last.width == x && last.y == top && last.height == height) {
+                    ++last.width; // Flat runs become one rectangle
+                    continue;
+                }
+            }
+            XRectangle rect;
+            rect.x = static_cast<short>(x);
+            rect.y = static_cast<short>(top);
+            rect.width = 1;
+            rect.height = static_cast<unsigned short>(height);
+            rects_.push_back(rect);
+        }
+        canvas.fillRects(rects_.data(), static_cast<int>(rects_.size()), *series.color);
+    }
+}
+
+void Plot::handleEvent(XEvent& event) {
+    (void)event;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "visible_component.hpp"
+#include "../interfaces/iresource_cache.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Line chart of numeric series, samples evenly spaced along x. Each series is
+// one contiguous float buffer plus a min/max pyramid over it, so a frame reads
+// O(log n) entries per pixel column instead of every sample: a million points
+// cost about as much as the widget is wide.
+class Plot : public VisibleComponent {
+public:
+    // Series indices at or past this are ignored; the Ruby binding rejects them
+    static constexpr size_t kMaxSeries = 64;
+
+    Plot(Display* display,
+         Window window,
+         GC gc,
+         IResourceCache& resources,
+         int x,
+         int y,
+         int width,
+         int height,
+         const std::string& background = "#ffffff");
+
+    void draw(Canvas& canvas, Region clip) override;
+    void handleEvent(XEvent& event) override;
+    XRectangle bounds() const override;
+    const char* typeName() const override { return "Plot"; }
+
+    // x, y is the top-left corner
+    void setPosition(int x, int y);
+
+    // Replaces series index; indices past the end add empty series up to it
+    void setSeries(size_t index, std::vector<float> samples, ColorHandle color);
+    // Streams more samples onto the end of a series, O(log n) each
+    void appendSamples(size_t index, const float* samples, size_t count);
+    void clear();
+    size_t seriesCount() const { return series_.size(); }
+    size_t sampleCount(size_t index) const;
+
+    // Fixed vertical range; low >= high goes back to fitting every series
+    void setRange(float low, float high);
+
+private:
+    // Samples per leaf of the pyramid; edges of a column are scanned directly
+    static constexpr size_t kLeafSamples = 16;
+
+    struct Bounds {
+        float low;
+        float high;
+    };
+
+    struct Series {
+        ColorHandle color;
+        std::vector<float> samples;
+        // levels[0][i] covers samples [i*16, i*16+16), each level above halves the count
+        std::vector<std::vector<Bounds>> levels;
+
+        void rebuild();
+        void push(float value);
+        // Min/max over samples [begin, end); NaNs are skipped
+        Bounds range(size_t begin, size_t end) const;
+    };
+
+    int x_, y_;
+    ColorHandle background_;
+    ColorHandle default_color_; // For series created by appendSamples
+    std::vector<Series> series_;
+    bool autoscale_ = true;
+    float low_ = 0.0f, high_ = 1.0f;
+    std::vector<XRectangle> rects_; // Per-series column spans, reused across frames
+
+    Series& seriesAt(size_t index);
+    Bounds visibleRange() const;
+};
@@ -0,0 +1,252 @@
+#include "raster_kernels.hpp"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MODERNX_RASTER_X86 1
+#endif
+
+namespace raster {
+namespace {
+
+// (s * a + d * (255 - a)) / 255 per channel, rounded; the same formula in every variant
+inline uint32_t blend_pixel(uint32_t d, uint32_t s, uint32_t a) {
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t t = ((s >> shift) & 0xff) * a + ((d >> shift) & 0xff) * (255 - a) + 128;
+        out |= (((t + (t >> 8)) >> 8) & 0xff) << shift;
+    }
+    return out;
+}
+
+void fill_scalar(uint32_t* dst, size_t count, uint32_t pixel) {
+    std::fill(dst, dst + count, pixel);
+}
+
+void blend_solid_scalar(uint32_t* dst, size_t count, uint32_t pixel, uint8_t alpha) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = blend_pixel(dst[i], pixel, alpha);
+    }
+}
+
+void blend_mask_scalar(uint32_t* dst, const uint8_t* mask, size_t count, uint32_t pixel) {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t a = mask[i];
+        if (a == 255) {
+            dst[i] = pixel;
+        } else if (a != 0) {
+            dst[i] = blend_pixel(dst[i], pixel, a);
+        }
+    }
+}
+
+#ifdef MODERNX_RASTER_X86
+
+// 16-bit lanes: (s * a + d * (255 - a) + 128) / 255
+inline __m128i blend_epi16(__m128i d, __m128i s, __m128i a) {
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i c128 = _mm_set1_epi16(128);
+    __m128i t = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s, a),
+                                            _mm_mullo_epi16(d, _mm_sub_epi16(c255, a))), c128);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Four pixels against four coverage values already spread to every channel byte
+inline __m128i blend4(__m128i dst, __m128i src, __m128i alpha) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = blend_epi16(_mm_unpacklo_epi8(dst, zero), _mm_unpacklo_epi8(src, zero),
+                             _mm_unpacklo_epi8(alpha, zero));
+    __m128i hi = blend_epi16(_mm_unpackhi_epi8(dst, zero), _mm_unpackhi_epi8(src, zero),
+                             _mm_unpackhi_epi8(alpha, zero));
+    return _mm_packus_epi16(lo, hi);
+}
+
+__attribute__((target("sse2")))
+void fill_sse2(uint32_t* dst, size_t count, uint32_t pixel) {
+    __m128i value = _mm_set1_epi32(static_cast<int>(pixel));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), value);
+    }
+    fill_scalar(dst + i, count - i, pixel);
+}
+
+__attribute__((target("sse2")))
+void blend_solid_sse2(uint32_t* dst, size_t count, uint32_t pixel, uint8_t alpha) {
+    __m128i src = _mm_set1_epi32(static_cast<int>(pixel));
+    __m128i a = _mm_set1_epi8(static_cast<char>(alpha));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+        _mm_storeu_si128(p, blend4(_mm_loadu_si128(p), src, a));
+    }
+    blend_solid_scalar(dst + i, count - i, pixel, alpha);
+}
+
+__attribute__((target("sse2")))
+void blend_mask_sse2(uint32_t* dst, const uint8_t* mask, size_t count, uint32_t pixel) {
+    __m128i src = _mm_set1_epi32(static_cast<int>(pixel));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint32_t m;
+        __builtin_memcpy(&m, mask + i, sizeof(m));
+        if (m == 0) {
+            continue; // Fully outside the glyph
+        }
+        __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+        if (m == 0xffffffffu) {
+            _mm_storeu_si128(p, src);
+            continue;
+        }
+        // a0 a1 a2 a3 -> a0 a0 a0 a0 a1 a1 a1 a1 ...
+        __m128i a = _mm_cvtsi32_si128(static_cast<int>(m));
+        a = _mm_unpacklo_epi8(a, a);
+        a = _mm_unpacklo_epi16(a, a);
+        _mm_storeu_si128(p, blend4(_mm_loadu_si128(p), src, a));
+    }
+    blend_mask_scalar(dst + i, mask + i, count - i, pixel);
+}
+
+__attribute__((target("avx2")))
+inline __m256i blend_epi16_avx2(__m256i d, __m256i s, __m256i a) {
+    const __m256i c255 = _mm256_set1_epi16(255);
+    const __m256i c128 = _mm256_set1_epi16(128);
+    __m256i t = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(s, a),
+                                                  _mm256_mullo_epi16(d, _mm256_sub_epi16(c255, a))), c128);
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+// Unpack and pack work per 128-bit lane, identically for all operands, so the order survives
+__attribute__((target("avx2")))
+inline __m256i blend8(__m256i dst, __m256i src, __m256i alpha) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = blend_epi16_avx2(_mm256_unpacklo_epi8(dst, zero), _mm256_unpacklo_epi8(src, zero),
+                                  _mm256_unpacklo_epi8(alpha, zero));
+    __m256i hi = blend_epi16_avx2(_mm256_unpackhi_epi8(dst, zero), _mm256_unpackhi_epi8(src, zero),
+                                  _mm256_unpackhi_epi8(alpha, zero));
+    return _mm256_packus_epi16(lo, hi);
+}
+
+__attribute__((target("avx2")))
+void fill_avx2(uint32_t* dst, size_t count, uint32_t pixel) {
+    __m256i value = _mm256_set1_epi32(static_cast<int>(pixel));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), value);
+    }
+    fill_scalar(dst + i, count - i, pixel);
+}
+
+__attribute__((target("avx2")))
+void blend_solid_avx2(uint32_t* dst, size_t count, uint32_t pixel, uint8_t alpha) {
+    __m256i src = _mm256_set1_epi32(static_cast<int>(pixel));
+    __m256i a = _mm256_set1_epi8(static_cast<char>(alpha));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i* p = reinterpret_cast<__m256i*>(dst + i);
+        _mm256_storeu_si256(p, blend8(_mm256_loadu_si256(p), src, a));
+    }
+    blend_solid_scalar(dst + i, count - i, pixel, alpha);
+}
+
+__attribute__((target("avx2")))
+void blend_mask_avx2(uint32_t* dst, const uint8_t* mask, size_t count, uint32_t pixel) {
+    __m256i src = _mm256_set1_epi32(static_cast<int>(pixel));
+    const __m256i spread = _mm256_set1_epi32(0x01010101);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint64_t m;
+        __builtin_memcpy(&m, mask + i, sizeof(m));
+        if (m == 0) {
+            continue;
+        }
+        __m256i* p = reinterpret_cast<__m256i*>(dst + i);
+        if (m == ~0ULL) {
+            _mm256_storeu_si256(p, src);
+            continue;
+        }
+        // Each coverage byte widened to 32 bits, then copied into all four channel bytes
+        // _mm_loadl_epi64 rather than _mm_cvtsi64_si128, which i386 lacks
+        __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(mask + i)));
+        a = _mm256_mullo_epi32(a, spread);
+        _mm256_storeu_si256(p, blend8(_mm256_loadu_si256(p), src, a));
+    }
+    blend_mask_scalar(dst + i, mask + i, count - i, pixel);
+}
+
+#endif // MODERNX_RASTER_X86
+
+struct Kernels {
+    void (*fill)(uint32_t*, size_t, uint32_t);
+    void (*blend_solid)(uint32_t*, size_t, uint32_t, uint8_t);
+    void (*blend_mask)(uint32_t*, const uint8_t*, size_t, uint32_t);
+    const char* isa;
+};
+
+Kernels select_kernels() {
+#ifdef MODERNX_RASTER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return { fill_avx2, blend_solid_avx2, blend_mask_avx2, "avx2" };
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return { fill_sse2, blend_solid_sse2, blend_mask_sse2, "sse2" };
+    }
+#endif
+    return { fill_scalar, blend_solid_scalar, blend_mask_scalar, "scalar" };
+}
+
+const Kernels& kernels() {
+    static const Kernels selected = select_kernels();
+    return selected;
+}
+
+} // namespace
+
+void fill(uint32_t* dst, size_t count, uint32_t pixel) {
+    kernels().fill(dst, count, pixel);
+}
+
+void blend_solid(uint32_t* dst, size_t count, uint32_t pixel, uint8_t alpha) {
+    kernels().blend_solid(dst, count, pixel, alpha);
+}
+
+void blend_mask(uint32_t* dst, const uint8_t* mask, size_t count, uint32_t pixel) {
+    kernels().blend_mask(dst, mask, count, pixel);
+}
+
+void blend_over(uint32_t* dst, const uint32_t* src, size_t count) {
+    // Scalar only: images cover little of a frame next to fills and glyphs
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t s = src[i];
+        uint32_t a = s >> 24;
+        if (a == 255) {
+            dst[i] = s & 0xffffff;
+        } else if (a != 0) {
+            uint32_t out = 0;
+            for (int shift = 0; shift < 24; shift += 8) {
+                uint32_t t = ((dst[i] >> shift) & 0xff) * (255 - a) + 128;
+                uint32_t c = ((s >> shift) & 0xff) + ((t + (t >> 8)) >> 8);
+                out |= std::min<uint32_t>(c, 255) << shift;
+            }
+            dst[i] = out;
+        }
+    }
+}
+
+uint64_t hash_pixels(const uint32_t* src, size_t count, uint64_t hash) {
+    // Not a hot path: scalar is enough
+    for (size_t i = 0; i < count; ++i) {
+        for (int shift = 0; shift < 24; shift += 8) {
+            hash ^= (src[i] >> shift) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+const char* isa() {
+    return kernels().isa;
+}
+
+} // namespace raster
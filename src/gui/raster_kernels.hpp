@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Span kernels for the software renderer, on 32-bit x8r8g8b8 pixels. The
+// widest implementation the CPU supports (AVX2, SSE2, scalar) is picked once
+// at startup.
+namespace raster {
+
+// dst[i] = pixel
+void fill(uint32_t* dst, size_t count, uint32_t pixel);
+// dst[i] = pixel over dst[i] with a constant alpha
+void blend_solid(uint32_t* dst, size_t count, uint32_t pixel, uint8_t alpha);
+// dst[i] = pixel over dst[i] with per-pixel coverage (glyph masks)
+void blend_mask(uint32_t* dst, const uint8_t* mask, size_t count, uint32_t pixel);
+// dst[i] = src[i] over dst[i], src in premultiplied a8r8g8b8 (decoded images)
+void blend_over(uint32_t* dst, const uint32_t* src, size_t count);
+
+// FNV-1a over the RGB bytes of count pixels, continuing from hash
+uint64_t hash_pixels(const uint32_t* src, size_t count, uint64_t hash = 1469598103934665603ULL);
+
+// Name of the selected implementation, for logs and benchmarks
+const char* isa();
+
+} // namespace raster
@@ -0,0 +1,109 @@
+#include "shm_surface.hpp"
+#include "../utils/log.hpp"
+#include <cstdlib>
+#include <stdexcept>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+namespace {
+
+// XShmAttach fails asynchronously (e.g. on a remote display); trap the error
+bool attach_failed = false;
+
+int trap_attach_error(Display*, XErrorEvent*) {
+    attach_failed = true;
+    return 0;
+}
+
+} // namespace
+
+ShmSurface::ShmSurface(Display* display, Visual* visual, int depth, int width, int height, bool use_shm)
+    : display_(display), width_(width), height_(height) {
+    if (use_shm && XShmQueryExtension(display_) && create_shared(visual, depth)) {
+        shared_ = true;
+    } else {
+        create_plain(visual, depth);
+    }
+    LOG_DEBUG(Gui, "Software surface %dx%d (%s).", width_, height_, shared_ ? "MIT-SHM" : "XPutImage");
+}
+
+ShmSurface::~ShmSurface() {
+    if (shared_) {
+        XShmDetach(display_, &shm_info_);
+        XSync(display_, False);
+        image_->data = nullptr; // Not malloc'ed: XDestroyImage must not free it
+        XDestroyImage(image_);
+        shmdt(shm_info_.shmaddr);
+    } else if (image_) {
+        XDestroyImage(image_); // Frees the malloc'ed pixels too
+    }
+}
+
+bool ShmSurface::create_shared(Visual* visual, int depth) {
+    image_ = XShmCreateImage(display_, visual, static_cast<unsigned>(depth), ZPixmap, nullptr,
+                             &shm_info_, static_cast<unsigned>(width_), static_cast<unsigned>(height_));
+    if (!image_) {
+        return false;
+    }
+    shm_info_.shmid = shmget(IPC_PRIVATE, static_cast<size_t>(image_->bytes_per_line) * height_, IPC_CREAT | 0600);
+    if (shm_info_.shmid < 0) {
+        XDestroyImage(image_);
+        image_ = nullptr;
+        return false;
+    }
+    shm_info_.shmaddr = static_cast<char*>(shmat(shm_info_.shmid, nullptr, 0));
+    if (shm_info_.shmaddr == reinterpret_cast<char*>(-1)) {
+        // The server must never be handed a segment we could not map ourselves
+        shmctl(shm_info_.shmid, IPC_RMID, nullptr);
+        XDestroyImage(image_);
+        image_ = nullptr;
+        LOG_INFO(Gui, "MIT-SHM segment could not be mapped, falling back to XPutImage.");
+        return false;
+    }
+    image_->data = shm_info_.shmaddr;
+    shm_info_.readOnly = False;
+
+    attach_failed = false;
+    XErrorHandler previous = XSetErrorHandler(trap_attach_error);
+    bool attached = XShmAttach(display_, &shm_info_);
+    XSync(display_, False);
+    XSetErrorHandler(previous);
+    // Marked for removal now; the segment lives until both sides detach
+    shmctl(shm_info_.shmid, IPC_RMID, nullptr);
+
+    if (!attached || attach_failed) {
+        shmdt(shm_info_.shmaddr);
+        image_->data = nullptr;
+        XDestroyImage(image_);
+        image_ = nullptr;
+        LOG_INFO(Gui, "MIT-SHM unavailable, falling back to XPutImage.");
+        return false;
+    }
+    return true;
+}
+
+void ShmSurface::create_plain(Visual* visual, int depth) {
+    int stride = width_ * 4;
+    char* data = static_cast<char*>(std::malloc(static_cast<size_t>(stride) * height_));
+    if (!data) {
+        throw std::runtime_error("Failed to allocate software frame buffer");
+    }
+    image_ = XCreateImage(display_, visual, static_cast<unsigned>(depth), ZPixmap, 0, data,
+                          static_cast<unsigned>(width_), static_cast<unsigned>(height_), 32, stride);
+    if (!image_) {
+        std::free(data);
+        throw std::runtime_error("Failed to create XImage for the software frame buffer");
+    }
+}
+
+void ShmSurface::present(Drawable drawable, GC gc, int x, int y, int width, int height) {
+    if (shared_) {
+        XShmPutImage(display_, drawable, gc, image_, x, y, x, y,
+                     static_cast<unsigned>(width), static_cast<unsigned>(height), False);
+        // The next frame writes into the same memory the server is reading
+        XSync(display_, False);
+    } else {
+        XPutImage(display_, drawable, gc, image_, x, y, x, y,
+                  static_cast<unsigned>(width), static_cast<unsigned>(height));
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <cstdint>
+
+// Client-side 32-bit pixel buffer presented with XShmPutImage when the
+// server shares memory with us, and with plain XPutImage otherwise.
+class ShmSurface {
+public:
+    ShmSurface(Display* display, Visual* visual, int depth, int width, int height, bool use_shm);
+    ~ShmSurface();
+
+    uint32_t* pixels() const { return reinterpret_cast<uint32_t*>(image_->data); }
+    int stride() const { return image_->bytes_per_line / 4; } // In pixels
+    int width() const { return width_; }
+    int height() const { return height_; }
+    bool shared() const { return shared_; }
+
+    // Uploads one rectangle; returns once the server is done reading the buffer
+    void present(Drawable drawable, GC gc, int x, int y, int width, int height);
+
+    // Disable copy
+    ShmSurface(const ShmSurface&) = delete;
+    ShmSurface& operator=(const ShmSurface&) = delete;
+
+private:
+    Display* display_;
+    int width_;
+    int height_;
+    XImage* image_ = nullptr;
+    XShmSegmentInfo shm_info_{};
+    bool shared_ = false;
+
+    bool create_shared(Visual* visual, int depth);
+    void create_plain(Visual* visual, int depth);
+};
@@ -0,0 +1,216 @@
+#include "software_canvas.hpp"
+#include "../interfaces/iimage_cache.hpp"
+#include "raster_kernels.hpp"
+#include "../utils/log.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+uint32_t to_pixel(const XftColor& color) {
+    return (static_cast<uint32_t>(color.color.red >> 8) << 16) |
+           (static_cast<uint32_t>(color.color.green >> 8) << 8) |
+           static_cast<uint32_t>(color.color.blue >> 8);
+}
+
+uint8_t to_alpha(const XftColor& color) {
+    return static_cast<uint8_t>(color.color.alpha >> 8);
+}
+
+} // namespace
+
+SoftwareCanvas::SoftwareCanvas(Display* display, int screen, const IResourceCache& resources, bool use_shm)
+    : display_(display),
+      resources_(resources),
+      visual_(DefaultVisual(display, screen)),
+      depth_(DefaultDepth(display, screen)),
+      use_shm_(use_shm) {
+    // The kernels write x8r8g8b8 directly; anything else goes through Xft
+    if ((depth_ != 24 && depth_ != 32) || visual_->red_mask != 0xff0000 ||
+        visual_->green_mask != 0x00ff00 || visual_->blue_mask != 0x0000ff) {
+        throw std::runtime_error("Software renderer needs a 24-bit x8r8g8b8 TrueColor visual");
+    }
+    LOG_INFO(Gui, "Software renderer using %s span kernels.", raster::isa());
+}
+
+void SoftwareCanvas::resize(int width, int height) {
+    surface_ = std::make_unique<ShmSurface>(display_, visual_, depth_, std::max(width, 1),
+                                            std::max(height, 1), use_shm_);
+    setClip(None);
+}
+
+void SoftwareCanvas::setClip(Region clip) {
+    clip_x0_ = 0;
+    clip_y0_ = 0;
+    clip_x1_ = surface_->width();
+    clip_y1_ = surface_->height();
+    if (clip) {
+        XRectangle box;
+        XClipBox(clip, &box);
+        clip_x0_ = std::max(clip_x0_, static_cast<int>(box.x));
+        clip_y0_ = std::max(clip_y0_, static_cast<int>(box.y));
+        clip_x1_ = std::min(clip_x1_, box.x + static_cast<int>(box.width));
+        clip_y1_ = std::min(clip_y1_, box.y + static_cast<int>(box.height));
+    }
+}
+
+void SoftwareCanvas::fillRect(int x, int y, int width, int height, const XftColor& color) {
+    int x0 = std::max(x, clip_x0_);
+    int y0 = std::max(y, clip_y0_);
+    int x1 = std::min(x + width, clip_x1_);
+    int y1 = std::min(y + height, clip_y1_);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    uint32_t pixel = to_pixel(color);
+    uint8_t alpha = to_alpha(color);
+    size_t span = static_cast<size_t>(x1 - x0);
+    for (int row = y0; row < y1; ++row) {
+        uint32_t* dst = surface_->pixels() + static_cast<size_t>(row) * surface_->stride() + x0;
+        if (alpha == 255) {
+            raster::fill(dst, span, pixel);
+        } else if (alpha != 0) {
+            raster::blend_solid(dst, span, pixel, alpha);
+        }
+    }
+}
+
+void SoftwareCanvas::fillRects(const XRectangle* rects, int count, const XftColor& color) {
+    for (int i = 0; i < count; ++i) {
+        fillRect(rects[i].x, rects[i].y, rects[i].width, rects[i].height, color);
+    }
+}
+
+void SoftwareCanvas::drawGlyphs(const XftColor& color, const XftGlyphFontSpec* glyphs, int count) {
+    uint32_t pixel = to_pixel(color);
+    uint8_t alpha = to_alpha(color);
+    if (alpha == 0) {
+        return;
+    }
+    // Runs of glyphs share a font; its handle is held for this whole call
+    const XftFont* last_font = nullptr;
+    uint64_t font_id = 0;
+    for (int i = 0; i < count; ++i) {
+        if (glyphs[i].font != last_font) {
+            last_font = glyphs[i].font;
+            font_id = resources_.font_id(last_font);
+        }
+        const GlyphBitmap& bitmap = glyph(glyphs[i].font, font_id, glyphs[i].glyph);
+        int gx = glyphs[i].x + bitmap.left;
+        int gy = glyphs[i].y - bitmap.top;
+        int x0 = std::max(gx, clip_x0_);
+        int y0 = std::max(gy, clip_y0_);
+        int x1 = std::min(gx + bitmap.width, clip_x1_);
+        int y1 = std::min(gy + bitmap.height, clip_y1_);
+        if (x0 >= x1 || y0 >= y1) {
+            continue;
+        }
+        size_t span = static_cast<size_t>(x1 - x0);
+        for (int row = y0; row < y1; ++row) {
+            const uint8_t* mask = bitmap.coverage.data() +
+                                  static_cast<size_t>(row - gy) * bitmap.width + (x0 - gx);
+            if (alpha != 255) {
+                scaled_mask_.resize(span);
+                for (size_t k = 0; k < span; ++k) {
+                    scaled_mask_[k] = static_cast<uint8_t>((mask[k] * alpha + 127) / 255);
+                }
+                mask = scaled_mask_.data();
+            }
+            uint32_t* dst = surface_->pixels() + static_cast<size_t>(row) * surface_->stride() + x0;
+            raster::blend_mask(dst, mask, span, pixel);
+        }
+    }
+}
+
+void SoftwareCanvas::drawImage(const CachedImage& image, int x, int y) {
+    if (image.pixels.empty()) {
+        return;
+    }
+    int x0 = std::max(x, clip_x0_);
+    int y0 = std::max(y, clip_y0_);
+    int x1 = std::min(x + image.width, clip_x1_);
+    int y1 = std::min(y + image.height, clip_y1_);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    size_t span = static_cast<size_t>(x1 - x0);
+    for (int row = y0; row < y1; ++row) {
+        uint32_t* dst = surface_->pixels() + static_cast<size_t>(row) * surface_->stride() + x0;
+        const uint32_t* src = image.pixels.data() + static_cast<size_t>(row - y) * image.width + (x0 - x);
+        raster::blend_over(dst, src, span);
+    }
+}
+
+void SoftwareCanvas::present(Window window, GC gc, Region area) {
+    XRectangle box;
+    XClipBox(area, &box);
+    int x0 = std::max(0, static_cast<int>(box.x));
+    int y0 = std::max(0, static_cast<int>(box.y));
+    int x1 = std::min(surface_->width(), box.x + static_cast<int>(box.width));
+    int y1 = std::min(surface_->height(), box.y + static_cast<int>(box.height));
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    surface_->present(window, gc, x0, y0, x1 - x0, y1 - y0);
+}
+
+uint64_t SoftwareCanvas::checksum() {
+    uint64_t hash = 1469598103934665603ULL;
+    for (int row = 0; row < surface_->height(); ++row) {
+        hash = raster::hash_pixels(surface_->pixels() + static_cast<size_t>(row) * surface_->stride(),
+                                   static_cast<size_t>(surface_->width()), hash);
+    }
+    return hash;
+}
+
+const SoftwareCanvas::GlyphBitmap& SoftwareCanvas::glyph(XftFont* font, uint64_t font_id, FT_UInt index) {
+    if (font_id == 0) {
+        renderGlyph(font, index, uncached_);
+        return uncached_;
+    }
+    GlyphKey key{font_id, index};
+    auto it = glyph_cache_.find(key);
+    if (it != glyph_cache_.end()) {
+        return it->second;
+    }
+    if (glyph_cache_.size() >= kMaxCachedGlyphs) {
+        glyph_cache_.clear(); // Rare: the working set of a UI is a few hundred glyphs
+    }
+    GlyphBitmap& bitmap = glyph_cache_[key];
+    renderGlyph(font, index, bitmap);
+    return bitmap;
+}
+
+void SoftwareCanvas::renderGlyph(XftFont* font, FT_UInt index, GlyphBitmap& out) {
+    out = GlyphBitmap();
+
+    FT_Face face = XftLockFace(font);
+    if (!face) {
+        return;
+    }
+    if (FT_Load_Glyph(face, index, FT_LOAD_DEFAULT) != 0 ||
+        FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL) != 0) {
+        XftUnlockFace(font);
+        LOG_DEBUG(Gui, "Failed to rasterize glyph %u.", index);
+        return;
+    }
+    const FT_GlyphSlot slot = face->glyph;
+    const FT_Bitmap& src = slot->bitmap;
+    out.left = slot->bitmap_left;
+    out.top = slot->bitmap_top;
+    out.width = static_cast<int>(src.width);
+    out.height = static_cast<int>(src.rows);
+    out.coverage.resize(static_cast<size_t>(out.width) * out.height);
+    for (int row = 0; row < out.height; ++row) {
+        const unsigned char* line = src.buffer + static_cast<long>(row) * src.pitch;
+        uint8_t* dst = out.coverage.data() + static_cast<size_t>(row) * out.width;
+        for (int col = 0; col < out.width; ++col) {
+            if (src.pixel_mode == FT_PIXEL_MODE_MONO) {
+                dst[col] = (line[col >> 3] & (0x80 >> (col & 7))) ? 255 : 0;
+            } else {
+                dst[col] = line[col];
+            }
+        }
+    }
+    XftUnlockFace(font);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "canvas.hpp"
+#include "shm_surface.hpp"
+#include "../interfaces/iresource_cache.hpp"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Rasterizes into a client-side x8r8g8b8 buffer with the SIMD span kernels
+// and uploads finished areas over MIT-SHM. Needs a 24/32-bit TrueColor
+// visual; the constructor throws otherwise so the caller can fall back to Xft.
+class SoftwareCanvas : public Canvas {
+public:
+    // Glyphs are cached per font id from resources; fonts it did not open are
+    // rendered uncached
+    SoftwareCanvas(Display* display, int screen, const IResourceCache& resources, bool use_shm = true);
+
+    RenderBackend backend() const override { return RenderBackend::Software; }
+    void resize(int width, int height) override;
+    // Clips to the bounding box of the region
+    void setClip(Region clip) override;
+    bool exactClip() const override { return false; }
+    void fillRect(int x, int y, int width, int height, const XftColor& color) override;
+    void fillRects(const XRectangle* rects, int count, const XftColor& color) override;
+    void drawGlyphs(const XftColor& color, const XftGlyphFontSpec* glyphs, int count) override;
+    void drawImage(const CachedImage& image, int x, int y) override;
+    void present(Window window, GC gc, Region area) override;
+    uint64_t checksum() override;
+
+    bool sharedMemory() const { return surface_ && surface_->shared(); }
+
+private:
+    static constexpr size_t kMaxCachedGlyphs = 4096;
+
+    // 8-bit coverage of one rendered glyph, positioned relative to the pen
+    struct GlyphBitmap {
+        int left = 0;
+        int top = 0;
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> coverage;
+    };
+
+    // Keyed by font id, not address: a closed font's address is reused
+    struct GlyphKey {
+        uint64_t font;
+        FT_UInt glyph;
+        bool operator==(const GlyphKey& other) const { return font == other.font && glyph == other.glyph; }
+    };
+    struct GlyphKeyHash {
+        size_t operator()(const GlyphKey& key) const {
+            return std::hash<uint64_t>()(key.font) ^ (static_cast<size_t>(key.glyph) * 0x9e3779b97f4a7c15ull);
+        }
+    };
+
+    Display* display_;
+    const IResourceCache& resources_;
+    Visual* visual_;
+    int depth_;
+    bool use_shm_;
+    std::unique_ptr<ShmSurface> surface_;
+    // Active clip as a half-open box, already limited to the surface
+    int clip_x0_ = 0, clip_y0_ = 0, clip_x1_ = 0, clip_y1_ = 0;
+
+    std::unordered_map<GlyphKey, GlyphBitmap, GlyphKeyHash> glyph_cache_;
+    std::vector<uint8_t> scaled_mask_; // Coverage scratch for translucent text
+    GlyphBitmap uncached_;              // Glyphs of fonts without an id
+
+    const GlyphBitmap& glyph(XftFont* font, uint64_t font_id, FT_UInt index);
+    void renderGlyph(XftFont* font, FT_UInt index, GlyphBitmap& out);
+};
@@ -0,0 +1,447 @@
+#include "text_editor.hpp"
+#include "../utils/log.hpp"
+#include <X11/keysym.h>
+#include <algorithm>
+
+TextEditor::TextEditor(Display* display,
+                       Window window,
+                       GC gc,
+                       IResourceCache& resources,
+                       int x,
+                       int y,
+                       int width,
+                       int height,
+                       const std::string& fontName,
+                       const std::string& colorStr)
+    : VisibleComponent(display, window, gc, width, height),
+      x_(x),
+      y_(y),
+      font_(resources.font(fontName)),
+      color_(resources.color(colorStr)),
+      selection_(resources.color("#b4d5fe")),
+      border_(resources.color("#808080"))
+{
+}
+
+XRectangle TextEditor::bounds() const {
+    XRectangle rect;
+    rect.x = static_cast<short>(x_);
+    rect.y = static_cast<short>(y_);
+    rect.width = static_cast<unsigned short>(width_);
+    rect.height = static_cast<unsigned short>(height_);
+    return rect;
+}
+
+size_t TextEditor::visibleLines() const {
+    return static_cast<size_t>(std::max(1, (height_ - 2 * kPadding) / lineHeight()));
+}
+
+size_t TextEditor::lineOf(size_t pos) const {
+    auto it = std::upper_bound(line_starts_.begin(), line_starts_.end(), pos);
+    return static_cast<size_t>(it - line_starts_.begin()) - 1;
+}
+
+size_t TextEditor::lineEnd(size_t line) const {
+    // Position of the line's '\n', or the end of the text for the last line
+    return line + 1 < line_starts_.size() ? line_starts_[line + 1] - 1 : buffer_.size();
+}
+
+size_t TextEditor::prevChar(size_t pos) const {
+    if (pos == 0) {
+        return 0;
+    }
+    // Step back over UTF-8 continuation bytes
+    do {
+        --pos;
+    } while (pos > 0 && (static_cast<unsigned char>(buffer_.at(pos)) & 0xC0) == 0x80);
+    return pos;
+}
+
+size_t TextEditor::nextChar(size_t pos) const {
+    size_t size = buffer_.size();
+    if (pos >= size) {
+        return size;
+    }
+    do {
+        ++pos;
+    } while (pos < size && (static_cast<unsigned char>(buffer_.at(pos)) & 0xC0) == 0x80);
+    return pos;
+}
+
+const TextEditor::LineLayout& TextEditor::layout(size_t line) {
+    LineLayout& cached = layouts_[line];
+    if (cached.valid) {
+        return cached;
+    }
+    size_t start = line_starts_[line];
+    buffer_.copy(start, lineEnd(line) - start, line_text_);
+
+    cached.glyphs.clear();
+    cached.pen.clear();
+    cached.offsets.clear();
+    const FcChar8* data = reinterpret_cast<const FcChar8*>(line_text_.data());
+    int remaining = static_cast<int>(line_text_.size());
+    int pen = 0;
+    uint32_t offset = 0;
+    while (remaining > 0) {
+        FcChar32 ucs4;
+        int used = FcUtf8ToUcs4(data, &ucs4, remaining);
+        if (used <= 0) {
+            break; // Invalid UTF-8: lay out what decoded so far
+        }
+        FT_UInt glyph = XftCharIndex(display_, font_.get(), ucs4);
+        XGlyphInfo info;
+        XftGlyphExtents(display_, font_.get(), &glyph, 1, &info);
+        cached.glyphs.push_back(glyph);
+        cached.pen.push_back(pen);
+        cached.offsets.push_back(offset);
+        pen += info.xOff;
+        data += used;
+        remaining -= used;
+        offset += static_cast<uint32_t>(used);
+    }
+    cached.width = pen;
+    cached.valid = true;
+    return cached;
+}
+
+int TextEditor::xAt(size_t line, size_t pos) {
+    const LineLayout& lay = layout(line);
+    uint32_t column = static_cast<uint32_t>(pos - line_starts_[line]);
+    auto it = std::lower_bound(lay.offsets.begin(), lay.offsets.end(), column);
+    if (it == lay.offsets.end()) {
+        return lay.width;
+    }
+    return lay.pen[static_cast<size_t>(it - lay.offsets.begin())];
+}
+
+size_t TextEditor::posAtX(size_t line, int x) {
+    const LineLayout& lay = layout(line);
+    size_t start = line_starts_[line];
+    // Nearest glyph boundary: past a glyph's midpoint the cursor goes after it
+    for (size_t i = 0; i < lay.glyphs.size(); ++i) {
+        int right = i + 1 < lay.pen.size() ? lay.pen[i + 1] : lay.width;
+        if (x < (lay.pen[i] + right) / 2) {
+            return start + lay.offsets[i];
+        }
+    }
+    return lineEnd(line);
+}
+
+size_t TextEditor::posAtPoint(int x, int y) {
+    int row = std::max(0, (y - y_ - kPadding) / lineHeight());
+    size_t line = std::min(top_line_ + static_cast<size_t>(row), line_starts_.size() - 1);
+    return posAtX(line, x - x_ - kPadding);
+}
+
+void TextEditor::insert(const std::string& text) {
+    if (hasSelection()) {
+        eraseRange(std::min(cursor_, anchor_), std::max(cursor_, anchor_));
+    }
+    insertAt(cursor_, text.data(), text.size());
+    ensureCursorVisible();
+}
+
+void TextEditor::setText(const std::string& text) {
+    buffer_.clear();
+    line_starts_.assign(1, 0);
+    layouts_.assign(1, LineLayout());
+    cursor_ = anchor_ = 0;
+    top_line_ = 0;
+    invalidate();
+    insertAt(0, text.data(), text.size());
+    ensureCursorVisible();
+}
+
+void TextEditor::selectAll() {
+    anchor_ = 0;
+    cursor_ = buffer_.size();
+    invalidateLines(top_line_, std::string::npos);
+}
+
+void TextEditor::insertAt(size_t pos, const char* text, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    size_t line = lineOf(pos);
+    buffer_.insert(pos, text, length);
+
+    for (size_t i = line + 1; i < line_starts_.size(); ++i) {
+        line_starts_[i] += length;
+    }
+    std::vector<size_t> added;
+    for (size_t i = 0; i < length; ++i) {
+        if (text[i] == '\n') {
+            added.push_back(pos + i + 1);
+        }
+    }
+    line_starts_.insert(line_starts_.begin() + line + 1, added.begin(), added.end());
+    layouts_.insert(layouts_.begin() + line + 1, added.size(), LineLayout());
+    layouts_[line].valid = false;
+
+    cursor_ = anchor_ = pos + length;
+    goal_x_ = -1;
+    // New lines push everything below them down
+    invalidateLines(line, added.empty() ? line : std::string::npos);
+}
+
+void TextEditor::eraseRange(size_t from, size_t to) {
+    if (from >= to) {
+        return;
+    }
+    size_t first = lineOf(from);
+    size_t last = lineOf(to);
+    buffer_.erase(from, to - from);
+
+    line_starts_.erase(line_starts_.begin() + first + 1, line_starts_.begin() + last + 1);
+    layouts_.erase(layouts_.begin() + first + 1, layouts_.begin() + last + 1);
+    for (size_t i = first + 1; i < line_starts_.size(); ++i) {
+        line_starts_[i] -= to - from;
+    }
+    layouts_[first].valid = false;
+
+    cursor_ = anchor_ = from;
+    goal_x_ = -1;
+    if (top_line_ >= line_starts_.size()) {
+        scrollTo(line_starts_.size() - 1);
+    }
+    invalidateLines(first, first == last ? first : std::string::npos);
+}
+
+void TextEditor::moveCursor(size_t pos, bool extend) {
+    size_t old_first = lineOf(std::min(cursor_, anchor_));
+    size_t old_last = lineOf(std::max(cursor_, anchor_));
+    bool had_selection = hasSelection();
+
+    cursor_ = pos;
+    if (!extend) {
+        anchor_ = pos;
+    }
+    size_t new_first = lineOf(std::min(cursor_, anchor_));
+    size_t new_last = lineOf(std::max(cursor_, anchor_));
+    if (!had_selection && !hasSelection()) {
+        // Only the caret moved: the line it left and the line it entered
+        invalidateLines(old_first, old_first);
+        invalidateLines(new_first, new_first);
+    } else {
+        invalidateLines(std::min(old_first, new_first), std::max(old_last, new_last));
+    }
+    ensureCursorVisible();
+}
+
+void TextEditor::moveVertical(long lines, bool extend) {
+    size_t line = lineOf(cursor_);
+    if (goal_x_ < 0) {
+        goal_x_ = xAt(line, cursor_);
+    }
+    long target = static_cast<long>(line) + lines;
+    size_t pos;
+    if (target < 0) {
+        pos = 0;
+    } else if (target >= static_cast<long>(line_starts_.size())) {
+        pos = buffer_.size();
+    } else {
+        pos = posAtX(static_cast<size_t>(target), goal_x_);
+    }
+    int goal = goal_x_;
+    moveCursor(pos, extend);
+    goal_x_ = goal;
+}
+
+void TextEditor::scrollTo(size_t line) {
+    line = std::min(line, line_starts_.size() - 1);
+    if (line != top_line_) {
+        top_line_ = line;
+        invalidate();
+    }
+}
+
+void TextEditor::ensureCursorVisible() {
+    size_t line = lineOf(cursor_);
+    size_t visible = visibleLines();
+    if (line < top_line_) {
+        scrollTo(line);
+    } else if (line >= top_line_ + visible) {
+        scrollTo(line - visible + 1);
+    }
+}
+
+void TextEditor::invalidateLines(size_t first, size_t last) {
+    if (!damage_) {
+        return;
+    }
+    size_t visible_end = top_line_ + visibleLines(); // Exclusive
+    first = std::max(first, top_line_);
+    last = last == std::string::npos ? visible_end - 1 : std::min(last, visible_end - 1);
+    if (first > last) {
+        return;
+    }
+    int line_height = lineHeight();
+    int top = y_ + kPadding + static_cast<int>(first - top_line_) * line_height;
+    int bottom = last == visible_end - 1 ? y_ + height_ - kPadding
+                                         : y_ + kPadding + static_cast<int>(last + 1 - top_line_) * line_height;
+    damage_->add(x_ + 1, top, width_ - 2, bottom - top);
+}
+
+bool TextEditor::handleKey(KeySym key, unsigned int state, const char* text, int len) {
+    bool shift = (state & ShiftMask) != 0;
+    bool ctrl = (state & ControlMask) != 0;
+    size_t sel_begin = std::min(cursor_, anchor_);
+    size_t sel_end = std::max(cursor_, anchor_);
+
+    switch (key) {
+        case XK_Left:
+            moveCursor(!shift && hasSelection() ? sel_begin : prevChar(cursor_), shift);
+            goal_x_ = -1;
+            return true;
+        case XK_Right:
+            moveCursor(!shift && hasSelection() ? sel_end : nextChar(cursor_), shift);
+            goal_x_ = -1;
+            return true;
+        case XK_Up:
+            moveVertical(-1, shift);
+            return true;
+        case XK_Down:
+            moveVertical(1, shift);
+            return true;
+        case XK_Page_Up:
+            moveVertical(-static_cast<long>(visibleLines()), shift);
+            return true;
+        case XK_Page_Down:
+            moveVertical(static_cast<long>(visibleLines()), shift);
+            return true;
+        case XK_Home:
+            moveCursor(ctrl ? 0 : line_starts_[lineOf(cursor_)], shift);
+            goal_x_ = -1;
+            return true;
+        case XK_End:
+            moveCursor(ctrl ? buffer_.size() : lineEnd(lineOf(cursor_)), shift);
+            goal_x_ = -1;
+            return true;
+        case XK_BackSpace:
+            if (hasSelection()) {
+                eraseRange(sel_begin, sel_end);
+            } else {
+                eraseRange(prevChar(cursor_), cursor_);
+            }
+            ensureCursorVisible();
+            return true;
+        case XK_Delete:
+            if (hasSelection()) {
+                eraseRange(sel_begin, sel_end);
+            } else {
+                eraseRange(cursor_, nextChar(cursor_));
+            }
+            ensureCursorVisible();
+            return true;
+        case XK_Return:
+        case XK_KP_Enter:
+            insert("\n");
+            return true;
+        case XK_Tab:
+            insert("  ");
+            return true;
+        default:
+            break;
+    }
+
+    if (ctrl) {
+        if (key == XK_a || key == XK_A) {
+            selectAll();
+            return true;
+        }
+        return false;
+    }
+    // Printable input only; control characters come through as their own keys
+    if (len > 0 && static_cast<unsigned char>(text[0]) >= 0x20 && text[0] != 0x7f) {
+        insert(std::string(text, static_cast<size_t>(len)));
+        return true;
+    }
+    return false;
+}
+
+void TextEditor::handleEvent(XEvent& event) {
+    switch (event.type) {
+        case ButtonPress: {
+            XRectangle box = bounds();
+            int px = event.xbutton.x;
+            int py = event.xbutton.y;
+            if (px < box.x || py < box.y || px >= box.x + box.width || py >= box.y + box.height) {
+                return;
+            }
+            if (event.xbutton.button == Button1) {
+                moveCursor(posAtPoint(px, py), (event.xbutton.state & ShiftMask) != 0);
+                goal_x_ = -1;
+            } else if (event.xbutton.button == Button4) {
+                scrollTo(top_line_ > 3 ? top_line_ - 3 : 0);
+            } else if (event.xbutton.button == Button5) {
+                scrollTo(top_line_ + 3);
+            }
+            break;
+        }
+        case MotionNotify:
+            // Dragging with the left button extends the selection
+            if (event.xmotion.state & Button1Mask) {
+                moveCursor(posAtPoint(event.xmotion.x, event.xmotion.y), true);
+                goal_x_ = -1;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void TextEditor::draw(Canvas& canvas, Region clip) {
+    XRectangle box = bounds();
+    Region editorClip = XCreateRegion();
+    XUnionRectWithRegion(&box, editorClip, editorClip);
+    if (clip) {
+        XIntersectRegion(editorClip, clip, editorClip);
+    }
+    canvas.setClip(editorClip);
+
+    canvas.fillRect(x_, y_, width_, 1, *border_);
+    canvas.fillRect(x_, y_ + height_ - 1, width_, 1, *border_);
+    canvas.fillRect(x_, y_, 1, height_, *border_);
+    canvas.fillRect(x_ + width_ - 1, y_, 1, height_, *border_);
+
+    int line_height = lineHeight();
+    int origin_x = x_ + kPadding;
+    size_t sel_begin = std::min(cursor_, anchor_);
+    size_t sel_end = std::max(cursor_, anchor_);
+    size_t cursor_line = lineOf(cursor_);
+    size_t end = std::min(line_starts_.size(), top_line_ + visibleLines());
+
+    for (size_t line = top_line_; line < end; ++line) {
+        int top = y_ + kPadding + static_cast<int>(line - top_line_) * line_height;
+        if (XRectInRegion(editorClip, x_, top, width_, line_height) == RectangleOut) {
+            continue; // Untouched by this repaint
+        }
+        const LineLayout& lay = layout(line);
+
+        size_t start = line_starts_[line];
+        size_t stop = lineEnd(line);
+        if (sel_begin < sel_end && sel_begin <= stop && sel_end > start) {
+            int from = xAt(line, std::max(sel_begin, start));
+            // A selected line break shows as a little extra width
+            int to = sel_end > stop ? lay.width + 4 : xAt(line, sel_end);
+            canvas.fillRect(origin_x + from, top, to - from, line_height, *selection_);
+        }
+
+        if (!lay.glyphs.empty()) {
+            specs_.resize(lay.glyphs.size());
+            for (size_t i = 0; i < lay.glyphs.size(); ++i) {
+                specs_[i].font = font_.get();
+                specs_[i].glyph = lay.glyphs[i];
+                specs_[i].x = static_cast<short>(origin_x + lay.pen[i]);
+                specs_[i].y = static_cast<short>(top + font_->ascent);
+            }
+            canvas.drawGlyphs(*color_, specs_.data(), static_cast<int>(specs_.size()));
+        }
+
+        if (line == cursor_line) {
+            canvas.fillRect(origin_x + xAt(line, cursor_), top, 1, line_height, *color_);
+        }
+    }
+    XDestroyRegion(editorClip);
+}
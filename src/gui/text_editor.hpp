@@ -0,0 +1,100 @@
+#pragma once
+
+#include "visible_component.hpp"
+#include "../interfaces/iresource_cache.hpp"
+#include "../utils/gap_buffer.hpp"
+#include "../utils/x11_raii.hpp"
+#include <X11/Xft/Xft.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Multi-line text input backed by a gap buffer. The line index and the
+// per-line glyph layout are updated incrementally, so an edit re-lays out
+// and repaints only the lines it touches (plus the ones below it when the
+// number of lines changes).
+class TextEditor : public VisibleComponent {
+public:
+    TextEditor(Display* display,
+               Window window,
+               GC gc,
+               IResourceCache& resources,
+               int x,
+               int y,
+               int width,
+               int height,
+               const std::string& fontName = "monospace-10",
+               const std::string& colorStr = "#000000");
+
+    void draw(Canvas& canvas, Region clip) override;
+    // Mouse: click/drag to place the cursor or select, wheel to scroll
+    void handleEvent(XEvent& event) override;
+    XRectangle bounds() const override;
+    long eventMask() const override { return ButtonPressMask | Button1MotionMask | KeyPressMask; }
+    const char* typeName() const override { return "TextEditor"; }
+
+    // Editing and navigation keys; returns false for keys it does not use
+    bool handleKey(KeySym key, unsigned int state, const char* text, int len);
+
+    // Replaces the selection (if any) at the cursor
+    void insert(const std::string& text);
+    void setText(const std::string& text);
+    std::string text() const { return buffer_.text(); }
+
+    size_t lineCount() const { return line_starts_.size(); }
+    size_t cursor() const { return cursor_; }
+    bool hasSelection() const { return cursor_ != anchor_; }
+    void selectAll();
+
+private:
+    static constexpr int kPadding = 3;
+
+    // Glyphs of one line with pen positions relative to the line origin
+    struct LineLayout {
+        bool valid = false;
+        std::vector<FT_UInt> glyphs;
+        std::vector<int> pen;          // x before each glyph
+        std::vector<uint32_t> offsets; // byte offset of each glyph within the line
+        int width = 0;
+    };
+
+    int x_, y_;
+    GapBuffer buffer_;
+    std::vector<size_t> line_starts_{0};
+    std::vector<LineLayout> layouts_{1};
+
+    size_t cursor_ = 0;
+    size_t anchor_ = 0;   // Other end of the selection; equals cursor_ when none
+    int goal_x_ = -1;     // Column kept while moving up/down
+    size_t top_line_ = 0; // First visible line
+
+    FontHandle font_;
+    ColorHandle color_;
+    ColorHandle selection_;
+    ColorHandle border_;
+
+    // Scratch space reused across layouts and frames
+    std::string line_text_;
+    std::vector<XftGlyphFontSpec> specs_;
+
+    int lineHeight() const { return font_->ascent + font_->descent; }
+    size_t visibleLines() const;
+    size_t lineOf(size_t pos) const;
+    size_t lineEnd(size_t line) const;
+    size_t prevChar(size_t pos) const;
+    size_t nextChar(size_t pos) const;
+
+    const LineLayout& layout(size_t line);
+    int xAt(size_t line, size_t pos);
+    size_t posAtX(size_t line, int x);
+    size_t posAtPoint(int x, int y);
+
+    void insertAt(size_t pos, const char* text, size_t length);
+    void eraseRange(size_t from, size_t to);
+    void moveCursor(size_t pos, bool extend);
+    void moveVertical(long lines, bool extend);
+    void scrollTo(size_t line);
+    void ensureCursorVisible();
+    // Damages [first, last] clipped to the visible lines; npos runs to the bottom
+    void invalidateLines(size_t first, size_t last);
+};
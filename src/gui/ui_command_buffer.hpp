@@ -0,0 +1,58 @@
+#pragma once
+#include "label.hpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One widget mutation recorded by script code
+struct UiCommand {
+    enum class Op {
+        CreateLabel, Move, SetText, SetFont, SetColor, SetAlign, Remove,
+        CreatePlot, SetSeries, AppendSamples, SetRange, ClearPlot,
+        CreateImage
+    };
+    Op op;
+    uint32_t id;
+    int x = 0, y = 0;          // CreateLabel, CreatePlot, CreateImage, Move
+    int width = 0, height = 0; // CreateLabel, CreatePlot, CreateImage
+    std::string text;          // CreateLabel, SetText; CreateImage: path
+    std::string font;          // CreateLabel, SetFont
+    std::string color;         // CreateLabel, SetColor, SetSeries; CreatePlot: background
+    TextAlign align = TextAlign::Left;
+    size_t series = 0;          // SetSeries, AppendSamples
+    std::vector<float> samples; // SetSeries, AppendSamples
+    float low = 0, high = 0;    // SetRange; low >= high means autoscale
+};
+
+// Mutations queued by the Ruby thread and applied by WindowService in one
+// pass per frame, so a script touching thousands of widgets costs a single
+// apply and a single repaint.
+class UiCommandBuffer {
+public:
+    // Ids are handed out at record time; the widget appears on apply
+    uint32_t next_id() { return next_widget_id.fetch_add(1, std::memory_order_relaxed); }
+
+    void record(UiCommand command) {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.push_back(std::move(command));
+    }
+
+    // Swaps the queue into out (cleared first) so both sides keep their capacity
+    void take(std::vector<UiCommand>& out) {
+        out.clear();
+        std::lock_guard<std::mutex> lock(mutex);
+        out.swap(commands);
+    }
+
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return commands.empty();
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::vector<UiCommand> commands;
+    std::atomic<uint32_t> next_widget_id{1};
+};
@@ -1,5 +1,9 @@
 #pragma once
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include "canvas.hpp"
+#include "damage_tracker.hpp"
+#include "widget_grid.hpp"
 
 class VisibleComponent {
 public:
@@ -7,13 +11,44 @@ public:
         : display_(display), window_(window), gc_(gc), width_(width), height_(height) {}
     virtual ~VisibleComponent() = default;
 
-    // Draw on the given Drawable (e.g., Pixmap or Window)
-    virtual void draw(Drawable drawable) = 0;
+    // Draw on the frame canvas, restricted to clip (window coordinates)
+    virtual void draw(Canvas& canvas, Region clip) = 0;
     virtual void handleEvent(XEvent& event) = 0;
 
+    // Area covered by the widget in window coordinates
+    virtual XRectangle bounds() const = 0;
+
+    // X event masks (ButtonPressMask, KeyPressMask, ...) this widget handles.
+    // Widgets returning NoEventMask never see handleEvent; pointer events go
+    // only to the widget under the pointer, key events only to the focus.
+    virtual long eventMask() const { return NoEventMask; }
+
+    // Short kind name used by telemetry
+    virtual const char* typeName() const { return "Widget"; }
+
+    // Mutators report the area they touch to the tracker set by the owner
+    void setDamageTracker(DamageTracker* damage) { damage_ = damage; }
+    void invalidate() {
+        if (damage_) {
+            damage_->add(bounds());
+        }
+    }
+
+    // Event routing index set by the owner; kept in sync by boundsChanged()
+    void setEventIndex(WidgetGrid* index) { index_ = index; }
+
 protected:
     Display* display_;
     Window window_;
     GC gc_;
     int width_, height_;
-};
\ No newline at end of file
+    DamageTracker* damage_ = nullptr;
+    WidgetGrid* index_ = nullptr;
+
+    // Call after a move or resize so pointer events follow the widget
+    void boundsChanged() {
+        if (index_) {
+            index_->update(this, bounds());
+        }
+    }
+};
@@ -0,0 +1,109 @@
+#include "widget_grid.hpp"
+#include <algorithm>
+
+WidgetGrid::WidgetGrid(int cellSize) : cellSize_(std::max(cellSize, 1)) {
+}
+
+int WidgetGrid::cellOf(int coordinate) const {
+    // Floor division: widgets may sit partly at negative coordinates
+    return coordinate >= 0 ? coordinate / cellSize_ : -((-coordinate + cellSize_ - 1) / cellSize_);
+}
+
+void WidgetGrid::insert(VisibleComponent* widget, const XRectangle& rect, long mask) {
+    if (contains(widget)) {
+        remove(widget);
+    }
+    entries_[widget] = Entry{rect, mask, nextOrder_++};
+    link(widget, rect);
+}
+
+void WidgetGrid::update(VisibleComponent* widget, const XRectangle& rect) {
+    auto it = entries_.find(widget);
+    if (it == entries_.end()) {
+        return;
+    }
+    Entry& entry = it->second;
+    if (entry.rect.x == rect.x && entry.rect.y == rect.y &&
+        entry.rect.width == rect.width && entry.rect.height == rect.height) {
+        return;
+    }
+    unlink(widget, entry.rect);
+    entry.rect = rect;
+    link(widget, rect);
+}
+
+void WidgetGrid::remove(VisibleComponent* widget) {
+    auto it = entries_.find(widget);
+    if (it == entries_.end()) {
+        return;
+    }
+    unlink(widget, it->second.rect);
+    entries_.erase(it);
+}
+
+VisibleComponent* WidgetGrid::at(int x, int y, long mask) const {
+    auto cell = cells_.find(cellKey(cellOf(x), cellOf(y)));
+    if (cell == cells_.end()) {
+        return nullptr;
+    }
+    VisibleComponent* best = nullptr;
+    uint64_t bestOrder = 0;
+    for (VisibleComponent* widget : cell->second) {
+        const Entry& entry = entries_.at(widget);
+        if (!(entry.mask & mask) || (best && entry.order < bestOrder)) {
+            continue;
+        }
+        const XRectangle& r = entry.rect;
+        if (x >= r.x && y >= r.y && x < r.x + r.width && y < r.y + r.height) {
+            best = widget;
+            bestOrder = entry.order;
+        }
+    }
+    return best;
+}
+
+void WidgetGrid::interested(long mask, std::vector<VisibleComponent*>& out) const {
+    out.clear();
+    for (const auto& item : entries_) {
+        if (item.second.mask & mask) {
+            out.push_back(item.first);
+        }
+    }
+    std::sort(out.begin(), out.end(), [this](VisibleComponent* a, VisibleComponent* b) {
+        return entries_.at(a).order < entries_.at(b).order;
+    });
+}
+
+void WidgetGrid::link(VisibleComponent* widget, const XRectangle& rect) {
+    if (rect.width == 0 || rect.height == 0) {
+        return;
+    }
+    int x0 = cellOf(rect.x), x1 = cellOf(rect.x + rect.width - 1);
+    int y0 = cellOf(rect.y), y1 = cellOf(rect.y + rect.height - 1);
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            cells_[cellKey(cx, cy)].push_back(widget);
+        }
+    }
+}
+
+void WidgetGrid::unlink(VisibleComponent* widget, const XRectangle& rect) {
+    if (rect.width == 0 || rect.height == 0) {
+        return;
+    }
+    int x0 = cellOf(rect.x), x1 = cellOf(rect.x + rect.width - 1);
+    int y0 = cellOf(rect.y), y1 = cellOf(rect.y + rect.height - 1);
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            auto cell = cells_.find(cellKey(cx, cy));
+            if (cell == cells_.end()) {
+                continue;
+            }
+            auto& list = cell->second;
+            list.erase(std::remove(list.begin(), list.end(), widget), list.end());
+            if (list.empty()) {
+                cells_.erase(cell);
+            }
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <X11/Xlib.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class VisibleComponent;
+
+// Uniform grid over window coordinates holding the widgets that asked for
+// events. A point query looks at one cell, so pointer routing costs the
+// number of interested widgets overlapping that cell, not the widget count.
+class WidgetGrid {
+public:
+    explicit WidgetGrid(int cellSize = 64);
+
+    // mask uses the X event masks (ButtonPressMask, PointerMotionMask, ...)
+    void insert(VisibleComponent* widget, const XRectangle& rect, long mask);
+    void update(VisibleComponent* widget, const XRectangle& rect);
+    void remove(VisibleComponent* widget);
+    bool contains(VisibleComponent* widget) const { return entries_.count(widget) != 0; }
+
+    // Topmost (last inserted) widget at x, y whose mask intersects mask; nullptr if none
+    VisibleComponent* at(int x, int y, long mask) const;
+    // Every registered widget whose mask intersects mask, bottom to top
+    void interested(long mask, std::vector<VisibleComponent*>& out) const;
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    struct Entry {
+        XRectangle rect;
+        long mask;
+        uint64_t order; // Insertion order doubles as stacking order
+    };
+
+    int cellSize_;
+    uint64_t nextOrder_ = 0;
+    std::unordered_map<VisibleComponent*, Entry> entries_;
+    std::unordered_map<uint64_t, std::vector<VisibleComponent*>> cells_;
+
+    uint64_t cellKey(int cx, int cy) const {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+    }
+    int cellOf(int coordinate) const;
+    void link(VisibleComponent* widget, const XRectangle& rect);
+    void unlink(VisibleComponent* widget, const XRectangle& rect);
+};
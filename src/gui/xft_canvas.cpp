@@ -0,0 +1,98 @@
+#include "xft_canvas.hpp"
+#include "../interfaces/iimage_cache.hpp"
+#include "raster_kernels.hpp"
+#include <stdexcept>
+#include <vector>
+
+XftCanvas::XftCanvas(Display* display, Window window, int screen)
+    : display_(display), window_(window), screen_(screen) {
+}
+
+void XftCanvas::resize(int width, int height) {
+    auto buffer = std::make_unique<PixmapHolder>(display_, window_, width, height,
+                                                 DefaultDepth(display_, screen_));
+    width_ = width;
+    height_ = height;
+    // Rebind before the old pixmap goes away
+    if (draw_) {
+        XftDrawChange(draw_.get(), buffer->get());
+        back_buffer_ = std::move(buffer);
+        return;
+    }
+    back_buffer_ = std::move(buffer);
+    draw_.reset(XftDrawCreate(display_, back_buffer_->get(),
+                              DefaultVisual(display_, screen_), DefaultColormap(display_, screen_)));
+    if (!draw_) {
+        throw std::runtime_error("Failed to create XftDraw for the back buffer");
+    }
+}
+
+void XftCanvas::setClip(Region clip) {
+    XftDrawSetClip(draw_.get(), clip);
+}
+
+void XftCanvas::fillRect(int x, int y, int width, int height, const XftColor& color) {
+    if (width > 0 && height > 0) {
+        XftDrawRect(draw_.get(), &color, x, y, static_cast<unsigned>(width), static_cast<unsigned>(height));
+    }
+}
+
+void XftCanvas::fillRects(const XRectangle* rects, int count, const XftColor& color) {
+    if (count <= 0) {
+        return;
+    }
+    // The draw's picture carries the clip set through XftDrawSetClip
+    Picture picture = XftDrawPicture(draw_.get());
+    if (picture) {
+        XRenderFillRectangles(display_, PictOpOver, picture, &color.color, rects, count);
+        return;
+    }
+    for (int i = 0; i < count; ++i) { // Core-protocol Xft: no picture to batch on
+        XftDrawRect(draw_.get(), &color, rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+    }
+}
+
+void XftCanvas::drawGlyphs(const XftColor& color, const XftGlyphFontSpec* glyphs, int count) {
+    if (count > 0) {
+        XftDrawGlyphFontSpec(draw_.get(), &color, glyphs, count);
+    }
+}
+
+void XftCanvas::drawImage(const CachedImage& image, int x, int y) {
+    Picture target = XftDrawPicture(draw_.get());
+    if (!image.picture || !target) {
+        return;
+    }
+    XRenderComposite(display_, PictOpOver, image.picture, None, target, 0, 0, 0, 0, x, y,
+                     static_cast<unsigned>(image.width), static_cast<unsigned>(image.height));
+}
+
+void XftCanvas::present(Window window, GC gc, Region area) {
+    XRectangle box;
+    XClipBox(area, &box);
+    if (box.width == 0 || box.height == 0) {
+        return;
+    }
+    XSetRegion(display_, gc, area);
+    XCopyArea(display_, back_buffer_->get(), window, gc, box.x, box.y, box.width, box.height, box.x, box.y);
+    XSetClipMask(display_, gc, None);
+}
+
+uint64_t XftCanvas::checksum() {
+    XImage* image = XGetImage(display_, back_buffer_->get(), 0, 0, static_cast<unsigned>(width_),
+                              static_cast<unsigned>(height_), AllPlanes, ZPixmap);
+    if (!image) {
+        throw std::runtime_error("Failed to read back the back buffer");
+    }
+    uint64_t hash = 1469598103934665603ULL;
+    std::vector<uint32_t> row(static_cast<size_t>(width_));
+    for (int y = 0; y < height_; ++y) {
+        // XGetPixel copes with any depth and byte order
+        for (int x = 0; x < width_; ++x) {
+            row[x] = static_cast<uint32_t>(XGetPixel(image, x, y));
+        }
+        hash = raster::hash_pixels(row.data(), row.size(), hash);
+    }
+    XDestroyImage(image);
+    return hash;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "canvas.hpp"
+#include "../utils/x11_raii.hpp"
+#include <memory>
+
+// Xft/XRender drawing into a persistent server-side Pixmap
+class XftCanvas : public Canvas {
+public:
+    XftCanvas(Display* display, Window window, int screen);
+
+    RenderBackend backend() const override { return RenderBackend::Xft; }
+    void resize(int width, int height) override;
+    void setClip(Region clip) override;
+    bool exactClip() const override { return true; }
+    void fillRect(int x, int y, int width, int height, const XftColor& color) override;
+    void fillRects(const XRectangle* rects, int count, const XftColor& color) override;
+    void drawGlyphs(const XftColor& color, const XftGlyphFontSpec* glyphs, int count) override;
+    void drawImage(const CachedImage& image, int x, int y) override;
+    void present(Window window, GC gc, Region area) override;
+    uint64_t checksum() override;
+
+private:
+    Display* display_;
+    Window window_;
+    int screen_;
+    std::unique_ptr<PixmapHolder> back_buffer_;
+    int width_ = 0;
+    int height_ = 0;
+    XftDrawPtr draw_;
+};
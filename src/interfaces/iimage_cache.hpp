@@ -0,0 +1,81 @@
+#pragma once
+#include <X11/Xlib.h>
+#include <X11/extensions/Xrender.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// An image decoded once at its display size, alpha premultiplied. With a
+// server-side cache it is an ARGB32 Pixmap wrapped in a Picture and pixels is
+// empty; otherwise pixels holds a8r8g8b8 rows for the software canvas.
+struct CachedImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> pixels;
+    Display* display = nullptr; // Set when pixmap/picture are owned
+    Pixmap pixmap = None;
+    Picture picture = None;
+
+    CachedImage() = default;
+    CachedImage(const CachedImage&) = delete;
+    CachedImage& operator=(const CachedImage&) = delete;
+    ~CachedImage() {
+        if (picture) {
+            XRenderFreePicture(display, picture);
+        }
+        if (pixmap) {
+            XFreePixmap(display, pixmap);
+        }
+    }
+
+    size_t bytes() const { return static_cast<size_t>(width) * static_cast<size_t>(height) * 4; }
+};
+
+// Shared handle: a widget keeps its image alive after the cache evicts it
+using ImageHandle = std::shared_ptr<const CachedImage>;
+using ImageRequestId = uint64_t;
+// Runs on the thread calling dispatch_completions; null when decoding failed
+using ImageCallback = std::function<void(ImageHandle image)>;
+
+struct ImageCacheStats {
+    uint64_t hits = 0;     // Served from memory
+    uint64_t misses = 0;   // Had to wait for a decode, new or already running
+    uint64_t decodes = 0;
+    uint64_t decode_failures = 0;
+    uint64_t evictions = 0;
+    double decode_ms = 0.0; // Worker time spent decoding and scaling
+    size_t entries = 0;
+    size_t bytes = 0;       // Pixels held by the cache, in use or not
+    size_t capacity = 0;
+    size_t pending = 0;     // Decodes not yet delivered
+};
+
+class IImageCache {
+public:
+    virtual ~IImageCache() = default;
+
+    // Uploads go to this display as Pictures when server_side, otherwise
+    // images stay in client memory. A null display drops every cached image;
+    // do that before the display closes.
+    virtual void attach(Display* display, int screen, bool server_side) = 0;
+
+    // PNG or PPM file scaled to width x height; 0 for either keeps the aspect
+    // ratio, 0 for both the natural size. A cached image is passed to on_ready
+    // before returning 0; otherwise decoding starts off the calling thread and
+    // on_ready runs from dispatch_completions.
+    virtual ImageRequestId load(const std::string& path, int width, int height, ImageCallback on_ready) = 0;
+    // Drops the callback; the decode still finishes and is cached
+    virtual void cancel(ImageRequestId id) = 0;
+
+    // Readable when decodes have finished; dispatch_completions uploads them
+    // and runs the callbacks. Call from the thread that owns the display.
+    virtual int completion_fd() const = 0;
+    virtual void dispatch_completions() = 0;
+
+    // Least recently used images not shown by any widget are evicted beyond this
+    virtual void set_capacity(size_t bytes) = 0;
+    virtual ImageCacheStats stats() const = 0;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <X11/Xlib.h>
+#include <X11/Xft/Xft.h>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Shared handles: the resource is released when the last widget drops it
+using FontHandle = std::shared_ptr<XftFont>;
+using ColorHandle = std::shared_ptr<XftColor>;
+
+struct ResourceCacheStats {
+    uint64_t font_hits = 0;
+    uint64_t font_misses = 0;
+    size_t fonts_live = 0;
+    double font_open_ms = 0.0; // Total time spent in XftFontOpenName
+
+    uint64_t color_hits = 0;
+    uint64_t color_misses = 0;
+    size_t colors_live = 0;
+};
+
+class IResourceCache {
+public:
+    virtual ~IResourceCache() = default;
+
+    // Resources are opened on this display; must be called before any lookup
+    virtual void attach(Display* display, int screen) = 0;
+
+    // name is an Xft pattern such as "monospace-10"
+    virtual FontHandle font(const std::string& name) = 0;
+    virtual FontHandle font(const std::string& family, double size) = 0;
+    // spec is anything XftColorAllocName accepts, e.g. "#004400" or "black"
+    virtual ColorHandle color(const std::string& spec) = 0;
+
+    // Serial of a font this cache opened, never reused, unlike the XftFont
+    // address once the font closes; 0 for fonts it did not open. Valid only
+    // while a handle to the font is held.
+    virtual uint64_t font_id(const XftFont* font) const = 0;
+
+    virtual ResourceCacheStats stats() const = 0;
+};
@@ -1,9 +1,94 @@
 #pragma once
 #include <string>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <functional>
+
+struct mrb_state;
+
+// Hit/miss counters of the compiled-bytecode cache
+struct RubyCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+};
+
+// Bounds for streamed results: inspect stops at whichever cap is hit first
+struct InspectLimits {
+    size_t max_bytes = 256 * 1024;
+    size_t max_elements = 10000; // Array/Hash entries, counted at every depth
+    size_t chunk_bytes = 16 * 1024;
+};
+
+// Interpreter heap, refreshed after every evaluation and GC slice
+struct RubyHeapStats {
+    size_t live_objects = 0;
+    size_t heap_bytes = 0;   // Currently held from the allocator
+    size_t heap_reserved = 0; // Taken from the system, including pooled free blocks
+    size_t heap_limit = 0;   // Cap on heap_bytes, 0 when unlimited
+    uint64_t allocations = 0;
+    uint64_t pool_reuses = 0; // Allocations served from a size-class free list
+    uint64_t refused = 0;    // Allocations denied by the limit (NoMemoryError)
+    uint64_t gc_slices = 0;  // Idle-time incremental GC steps taken
+    uint64_t gc_cycles = 0;  // Full mark/sweep cycles finished by those steps
+    double last_pause_us = 0.0;
+    double max_pause_us = 0.0;
+};
 
 class IRubyService {
 public:
+    using EvalId = uint64_t;
+    using EvalCallback = std::function<void(const std::string& result)>;
+    // Receives a streamed result piece by piece; last is set on the final piece
+    using ChunkCallback = std::function<void(const std::string& chunk, bool last)>;
+    // Defines classes/modules in an interpreter (e.g. host bindings)
+    using Extension = std::function<void(mrb_state* mrb)>;
+
     virtual ~IRubyService() = default;
     virtual std::string execute_code(const std::string& code) = 0;
+    // .rb files are parsed, .mrb bytecode files are mapped and loaded directly
     virtual std::string load_file(const std::string& filename) = 0;
-};
\ No newline at end of file
+    // A script from scripts/ by file name: the bytecode embedded at build time,
+    // or the file under $MODERNX_SCRIPT_DIR when that is set (development)
+    virtual std::string load_script(const std::string& name) = 0;
+    virtual RubyCacheStats cache_stats() const = 0;
+
+    // Runs the extension under the interpreter lock before returning
+    virtual void add_extension(Extension extension) = 0;
+
+    // Queue code for evaluation off the calling thread. on_done runs inside
+    // dispatch_completions(), on whichever thread calls it.
+    virtual EvalId execute_async(const std::string& code, EvalCallback on_done) = 0;
+    // Like execute_async, but the result's inspect is produced incrementally
+    // within limits; chunks arrive through dispatch_completions() in order.
+    // Top-level arrays and hashes are laid out one entry per line.
+    virtual EvalId execute_streaming(const std::string& code, const InspectLimits& limits,
+                                     ChunkCallback on_chunk) = 0;
+    // Drop a queued evaluation or interrupt a running one
+    virtual bool cancel(EvalId id) = 0;
+    // Wall-clock limit for every evaluation; zero disables it
+    virtual void set_eval_timeout(std::chrono::milliseconds timeout) = 0;
+    // Cap on interpreter heap bytes; past it scripts get NoMemoryError
+    // instead of growing the host. Zero disables it.
+    virtual void set_memory_limit(size_t bytes) = 0;
+
+    // Runs incremental GC steps for at most budget, from the UI thread while
+    // it is idle. Skips (instead of waiting) when an evaluation holds the
+    // interpreter. Returns true while the current GC cycle has work left.
+    virtual bool collect_garbage(std::chrono::microseconds budget) = 0;
+    virtual RubyHeapStats heap_stats() const = 0;
+
+    // Sampling profiler over every evaluation, switchable at run time; while
+    // off it costs nothing. Needs mruby built with MRB_USE_DEBUG_HOOK.
+    virtual void start_profiling(std::chrono::microseconds interval) = 0;
+    virtual void stop_profiling() = 0;
+    // Samples as folded stacks ("outer;inner;leaf count" per line) for
+    // flame graph tools; reset starts a fresh profile
+    virtual std::string profile_folded(bool reset) = 0;
+
+    // Readable file descriptor signalled when finished evaluations are waiting
+    virtual int completion_fd() const = 0;
+    virtual void dispatch_completions() = 0;
+};
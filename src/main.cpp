@@ -1,22 +1,105 @@
 #include "core/container.hpp"
 #include "modules/app_module.hpp"
 #include "interfaces/iwindow_service.hpp"
-#include <iostream>
+#include "cli/headless_runner.hpp"
+#include "cli/replay_runner.hpp"
+#include "utils/log.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char** argv) {
+    AppOptions app_options; // Stamps the launch time for time-to-first-frame
+    if (const char* spec = std::getenv("MODERNX_LOG")) {
+        logging::configure(spec);
+    }
+
+    // modernx [--render xft|software] [--memory-limit MIB] [--record TRACE] [--serial-startup]
+    // modernx --replay TRACE [--original-timing] [--checksum | --expect-checksum HEX]
+    // modernx --headless [--jobs N] [--timeout MS] [--memory-limit MIB]
+    //         [--profile FILE [--profile-interval US]] [script.rb|dir ...]
+    bool headless = false;
+    HeadlessOptions headless_options;
+    ReplayRunOptions replay_options;
+    const char* render_env = std::getenv("MODERNX_RENDER");
+    std::string render = render_env ? render_env : "";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            headless_options.jobs = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--timeout" && i + 1 < argc) {
+            headless_options.timeout = std::chrono::milliseconds(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--memory-limit" && i + 1 < argc) {
+            size_t limit = static_cast<size_t>(std::max(0, std::atoi(argv[++i]))) * 1024 * 1024;
+            headless_options.memory_limit = limit;
+            app_options.ruby_memory_limit = limit;
+        } else if (arg == "--profile" && i + 1 < argc) {
+            headless_options.profile_path = argv[++i];
+        } else if (arg == "--profile-interval" && i + 1 < argc) {
+            headless_options.profile_interval = std::chrono::microseconds(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--serial-startup") {
+            app_options.parallel_startup = false;
+        } else if (arg == "--record" && i + 1 < argc) {
+            app_options.record_path = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replay_options.trace_path = argv[++i];
+        } else if (arg == "--original-timing") {
+            replay_options.original_timing = true;
+        } else if (arg == "--checksum") {
+            replay_options.checksum = true;
+        } else if (arg == "--expect-checksum" && i + 1 < argc) {
+            replay_options.expected_checksum = std::strtoull(argv[++i], nullptr, 16);
+        } else if (arg == "--render" && i + 1 < argc) {
+            render = argv[++i];
+        } else {
+            headless_options.paths.push_back(arg);
+        }
+    }
+
+    if (render == "software") {
+        app_options.render = RenderBackend::Software;
+    } else if (!render.empty() && render != "xft") {
+        LOG_WARN(App, "Unknown renderer '%s', using xft.", render.c_str());
+    }
+
+    int status = 0;
+    if (!replay_options.trace_path.empty()) {
+        try {
+            status = run_replay(replay_options, app_options);
+        } catch (const std::exception& e) {
+            LOG_ERROR(App, "Error in replay: %s", e.what());
+            status = 1;
+        }
+        logging::shutdown();
+        return status;
+    }
+    if (headless) {
+        try {
+            status = run_headless(headless_options);
+        } catch (const std::exception& e) {
+            LOG_ERROR(App, "Error in headless run: %s", e.what());
+            status = 1;
+        }
+        logging::shutdown();
+        return status;
+    }
 
-int main() {
     try {
         Container container;
-        AppModule::configure(container);
-        std::cout << "Application configured." << std::endl;
+        AppModule::configure(container, app_options);
+        container.initialize();
+        LOG_INFO(App, "Application configured.");
         
         auto window_service = container.resolve<IWindowService>();
-        std::cout << "Resolved IWindowService." << std::endl;
+        LOG_INFO(App, "Resolved IWindowService.");
         window_service->run();
-        std::cout << "Application run completed." << std::endl;
-        
-        return 0;
+        LOG_INFO(App, "Application run completed.");
     } catch (const std::exception& e) {
-        std::cerr << "Error in main: " << e.what() << std::endl;
-        return 1;
+        LOG_ERROR(App, "Error in main: %s", e.what());
+        status = 1;
     }
-}
\ No newline at end of file
+    logging::shutdown();
+    return status;
+}
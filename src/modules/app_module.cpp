@@ -1,39 +1,123 @@
 #include "app_module.hpp"
 #include "../services/ruby_service.hpp"
 #include "../services/window_service.hpp"
+#include "../services/resource_cache.hpp"
+#include "../services/image_cache.hpp"
+#include "../services/font_warmup.hpp"
 #include "../gui/label.hpp"
+#include "../gui/text_editor.hpp"
+#include "../gui/output_view.hpp"
+#include "../gui/perf_overlay.hpp"
+#include "../core/telemetry.hpp"
+#include "../core/reactor.hpp"
+#include "../bindings/perf_module.hpp"
+#include "../bindings/widget_module.hpp"
+#include "../bindings/timer_module.hpp"
 #include <memory>
-#include <iostream>
+#include "../utils/log.hpp"
 
-void AppModule::configure(Container& container) {
-    container.register_singleton<IRubyService>([]() {
-        std::cout << "Registering IRubyService." << std::endl;
-        return std::make_shared<RubyService>();
+void AppModule::configure(Container& container, const AppOptions& options) {
+    container.register_singleton<Telemetry>([]() {
+        return std::make_shared<Telemetry>();
     });
 
-    container.register_singleton<IWindowService>([&container]() {
-        std::cout << "Registering IWindowService." << std::endl;
-        auto ws = std::make_shared<WindowService>(container.resolve<IRubyService>());
+    container.register_singleton<UiCommandBuffer>([]() {
+        return std::make_shared<UiCommandBuffer>();
+    });
+
+    // Event loop run by the window; script timers are scheduled on it too
+    container.register_singleton<Reactor>([]() {
+        return std::make_shared<Reactor>();
+    });
+
+    std::function<std::shared_ptr<IRubyService>()> ruby_factory = [&container, options]() {
+        LOG_DEBUG(Container, "Registering IRubyService.");
+        auto telemetry = container.resolve<Telemetry>();
+        auto commands = container.resolve<UiCommandBuffer>();
+        auto reactor = container.resolve<Reactor>();
+        auto ruby = std::make_shared<RubyService>(telemetry);
+        if (options.ruby_memory_limit > 0) {
+            ruby->set_memory_limit(options.ruby_memory_limit);
+        }
+        // Ruby code only runs while the container still holds all three
+        ruby->add_extension([&telemetry, &commands, &reactor, &ruby](mrb_state* mrb) {
+            install_perf_module(mrb, telemetry.get());
+            install_widget_module(mrb, commands.get());
+            install_timer_module(mrb, reactor.get(), async_timer_fire(ruby.get()));
+        });
+        return ruby;
+    };
+    // Fonts the widgets below open; matching them is most of fontconfig's startup cost
+    std::function<std::shared_ptr<FontWarmup>()> font_factory = []() {
+        return std::make_shared<FontWarmup>(std::vector<std::string>{
+            "monospace-10", "monospace-8", "Times New Roman-16" });
+    };
+    if (options.parallel_startup) {
+        // mruby and fontconfig start on workers while the window connects to X
+        container.register_async<IRubyService, Telemetry, UiCommandBuffer, Reactor>(ruby_factory);
+        container.register_async<FontWarmup>(font_factory);
+    } else {
+        container.register_singleton<IRubyService>(ruby_factory, Init::Eager);
+        container.register_singleton<FontWarmup>(font_factory);
+    }
+
+    container.register_singleton<IResourceCache>([]() {
+        LOG_DEBUG(Container, "Registering IResourceCache.");
+        return std::make_shared<ResourceCache>();
+    });
 
-        auto input = std::make_unique<Label>(ws->getDisplay(), ws->getWindow(),
-                                            ws->getGC(), // Передача GC
-                                            10, 30, 300, 20,
-                                            "Введите код Ruby...", "monospace-10", "#004400");
-        ws->setInputLabel(std::move(input));
+    container.register_singleton<IImageCache>([options]() {
+        LOG_DEBUG(Container, "Registering IImageCache.");
+        return std::make_shared<ImageCache>(options.image_cache_limit);
+    });
+
+    container.register_singleton<IWindowService>([&container, options]() {
+        LOG_DEBUG(Container, "Registering IWindowService.");
+        auto resources = container.resolve<IResourceCache>();
+        // The interpreter is attached last: it may still be starting on a worker
+        auto ws = std::make_shared<WindowService>(nullptr, resources,
+                                                 container.resolve<Telemetry>(), options.render,
+                                                 container.resolve<Reactor>());
+        ws->set_launch_time(options.launch_time);
+        ws->setCommandBuffer(container.resolve<UiCommandBuffer>());
+        ws->setImageCache(container.resolve<IImageCache>());
+        if (!options.record_path.empty()) {
+            ws->record_events(options.record_path);
+        }
+
+        container.resolve<FontWarmup>();
+        auto input = std::make_unique<TextEditor>(ws->getDisplay(), ws->getWindow(),
+                                                 ws->getGC(), // Передача GC
+                                                 *resources,
+                                                 10, 10, 330, 66,
+                                                 "monospace-10", "#004400");
+        ws->setInputEditor(std::move(input));
 
-        auto result = std::make_unique<Label>(ws->getDisplay(), ws->getWindow(),
-                                             ws->getGC(), // Передача GC
-                                             10, 60, 300, 20,
-                                             "Результат", "monospace-10", "#004400");
-        ws->setResultLabel(std::move(result));
+        auto result = std::make_unique<OutputView>(ws->getDisplay(), ws->getWindow(),
+                                                  ws->getGC(), // Передача GC
+                                                  *resources,
+                                                  10, 82, 330, 36,
+                                                  "monospace-10", "#004400");
+        ws->setResultView(std::move(result));
 
         auto test_lbl = std::make_unique<Label>(ws->getDisplay(), ws->getWindow(),
                                                ws->getGC(), // Передача GC
-                                               100, 90, 300, 20,
+                                               *resources,
+                                               100, 140, 300, 20,
                                                "test", "Times New Roman-16", "#994400");
         ws->addWidget(std::move(test_lbl));
 
-        std::cout << "WindowService configured with labels." << std::endl;
+        ws->setPerfOverlay(std::make_unique<PerfOverlay>(ws->getDisplay(), ws->getWindow(),
+                                                         ws->getGC(), *resources,
+                                                         0, 0, 330)); // Placed by the window
+
+        ws->setRubyService(container.resolve<IRubyService>());
+
+        [[maybe_unused]] ResourceCacheStats stats = resources->stats();
+        LOG_INFO(Gui, "WindowService configured with labels. Fonts: %zu opened (%llu hits, %.2f ms), "
+                 "colors: %zu allocated (%llu hits).",
+                 stats.fonts_live, static_cast<unsigned long long>(stats.font_hits), stats.font_open_ms,
+                 stats.colors_live, static_cast<unsigned long long>(stats.color_hits));
         return ws;
-    });
+    }, Init::Eager);
 }
\ No newline at end of file
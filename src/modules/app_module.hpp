@@ -1,7 +1,23 @@
 #pragma once
 #include "../core/container.hpp"
+#include "../gui/canvas.hpp"
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Startup choices made on the command line
+struct AppOptions {
+    RenderBackend render = RenderBackend::Xft;
+    size_t ruby_memory_limit = 0; // Bytes per interpreter, 0 = unlimited
+    size_t image_cache_limit = 64 * 1024 * 1024; // Decoded images kept for reuse
+    std::string record_path;      // Input event trace written while running
+    // Build the interpreter and warm fontconfig on workers during initialize()
+    bool parallel_startup = true;
+    // Time-to-first-frame is measured from here
+    std::chrono::steady_clock::time_point launch_time = std::chrono::steady_clock::now();
+};
 
 class AppModule {
 public:
-    static void configure(Container& container);
-};
\ No newline at end of file
+    static void configure(Container& container, const AppOptions& options = AppOptions());
+};
@@ -0,0 +1,204 @@
+#include "event_trace.hpp"
+#include <X11/Xutil.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const char kMagic[7] = { 'M', 'X', 'T', 'R', 'A', 'C', 'E' };
+const char kVersion = 1;
+
+// Number of fields stored for an event type; -1 when it is not recorded
+int field_count(int type) {
+    switch (type) {
+        case KeyPress:
+        case KeyRelease:
+        case Expose:
+            return 5;
+        case ButtonPress:
+        case ButtonRelease:
+        case ConfigureNotify:
+            return 4;
+        case MotionNotify:
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+} // namespace
+
+EventTraceWriter::EventTraceWriter(const std::string& path, int width, int height)
+    : out(path, std::ios::binary | std::ios::trunc),
+      start(std::chrono::steady_clock::now()) {
+    if (!out) {
+        throw std::runtime_error("Failed to create trace file " + path);
+    }
+    out.write(kMagic, sizeof(kMagic));
+    out.put(kVersion);
+    put(width);
+    put(height);
+}
+
+EventTraceWriter::~EventTraceWriter() {
+    out.flush();
+}
+
+void EventTraceWriter::put(int64_t value) {
+    uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    while (zigzag >= 0x80) {
+        out.put(static_cast<char>((zigzag & 0x7f) | 0x80));
+        zigzag >>= 7;
+    }
+    out.put(static_cast<char>(zigzag));
+}
+
+void EventTraceWriter::append(const XEvent& event) {
+    int count = field_count(event.type);
+    if (count < 0) {
+        return;
+    }
+    TraceRecord record;
+    record.type = event.type;
+    switch (event.type) {
+        case KeyPress:
+        case KeyRelease: {
+            XKeyEvent key = event.xkey;
+            record.fields = { key.state, key.keycode,
+                              static_cast<int64_t>(XLookupKeysym(&key, 0)), key.x, key.y };
+            break;
+        }
+        case ButtonPress:
+        case ButtonRelease:
+            record.fields = { event.xbutton.state, event.xbutton.button, event.xbutton.x, event.xbutton.y, 0 };
+            break;
+        case MotionNotify:
+            record.fields = { event.xmotion.state, event.xmotion.x, event.xmotion.y, 0, 0 };
+            break;
+        case Expose:
+            record.fields = { event.xexpose.x, event.xexpose.y, event.xexpose.width, event.xexpose.height,
+                              event.xexpose.count };
+            break;
+        case ConfigureNotify:
+            record.fields = { event.xconfigure.x, event.xconfigure.y, event.xconfigure.width,
+                              event.xconfigure.height, 0 };
+            break;
+    }
+
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    put((now - last).count());
+    last = now;
+    put(record.type);
+    for (int i = 0; i < count; ++i) {
+        put(record.fields[i]);
+    }
+    records++;
+}
+
+EventTraceReader::EventTraceReader(const std::string& path) : in(path, std::ios::binary) {
+    if (!in) {
+        throw std::runtime_error("Failed to open trace file " + path);
+    }
+    char header[sizeof(kMagic) + 1];
+    int64_t width;
+    int64_t height;
+    if (!in.read(header, sizeof(header)) || std::memcmp(header, kMagic, sizeof(kMagic)) != 0 ||
+        header[sizeof(kMagic)] != kVersion || !get(width) || !get(height)) {
+        throw std::runtime_error(path + " is not a version 1 event trace");
+    }
+    initial_width = static_cast<int>(width);
+    initial_height = static_cast<int>(height);
+}
+
+bool EventTraceReader::get(int64_t& value) {
+    uint64_t zigzag = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = in.get();
+        if (byte == std::char_traits<char>::eof()) {
+            return false;
+        }
+        zigzag |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool EventTraceReader::next(TraceRecord& out) {
+    int64_t delta;
+    if (!get(delta)) {
+        return false;
+    }
+    int64_t type;
+    if (!get(type)) {
+        throw std::runtime_error("Truncated event trace");
+    }
+    int count = field_count(static_cast<int>(type));
+    if (count < 0) {
+        throw std::runtime_error("Unknown event type " + std::to_string(type) + " in trace");
+    }
+    out = TraceRecord();
+    clock += std::chrono::microseconds(delta);
+    out.time = clock;
+    out.type = static_cast<int>(type);
+    for (int i = 0; i < count; ++i) {
+        if (!get(out.fields[i])) {
+            throw std::runtime_error("Truncated event trace");
+        }
+    }
+    return true;
+}
+
+void EventTraceReader::to_event(const TraceRecord& record, Display* display, Window window, XEvent& event) {
+    event = XEvent();
+    event.type = record.type;
+    event.xany.display = display;
+    event.xany.window = window;
+    event.xany.send_event = False;
+    const auto& f = record.fields;
+    switch (record.type) {
+        case KeyPress:
+        case KeyRelease: {
+            KeyCode code = XKeysymToKeycode(display, static_cast<KeySym>(f[2]));
+            event.xkey.state = static_cast<unsigned int>(f[0]);
+            event.xkey.keycode = code ? code : static_cast<unsigned int>(f[1]);
+            event.xkey.x = static_cast<int>(f[3]);
+            event.xkey.y = static_cast<int>(f[4]);
+            event.xkey.root = DefaultRootWindow(display);
+            event.xkey.same_screen = True;
+            break;
+        }
+        case ButtonPress:
+        case ButtonRelease:
+            event.xbutton.state = static_cast<unsigned int>(f[0]);
+            event.xbutton.button = static_cast<unsigned int>(f[1]);
+            event.xbutton.x = static_cast<int>(f[2]);
+            event.xbutton.y = static_cast<int>(f[3]);
+            event.xbutton.root = DefaultRootWindow(display);
+            event.xbutton.same_screen = True;
+            break;
+        case MotionNotify:
+            event.xmotion.state = static_cast<unsigned int>(f[0]);
+            event.xmotion.x = static_cast<int>(f[1]);
+            event.xmotion.y = static_cast<int>(f[2]);
+            event.xmotion.root = DefaultRootWindow(display);
+            event.xmotion.same_screen = True;
+            break;
+        case Expose:
+            event.xexpose.x = static_cast<int>(f[0]);
+            event.xexpose.y = static_cast<int>(f[1]);
+            event.xexpose.width = static_cast<int>(f[2]);
+            event.xexpose.height = static_cast<int>(f[3]);
+            event.xexpose.count = static_cast<int>(f[4]);
+            break;
+        case ConfigureNotify:
+            event.xconfigure.event = window;
+            event.xconfigure.x = static_cast<int>(f[0]);
+            event.xconfigure.y = static_cast<int>(f[1]);
+            event.xconfigure.width = static_cast<int>(f[2]);
+            event.xconfigure.height = static_cast<int>(f[3]);
+            break;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <X11/Xlib.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Compact binary log of the input a window received, for replaying real
+// interaction against Xvfb. Layout: "MXTRACE" plus a version byte, the
+// window size at the start, then one record per event: time since the
+// previous record in microseconds, the X event type, and that type's
+// fields, every number as a zigzag varint. Events the window does not act
+// on are not recorded.
+struct TraceRecord {
+    std::chrono::microseconds time{0}; // Since recording started
+    int type = 0;
+    // Key: state, keycode, keysym, x, y. Button: state, button, x, y.
+    // Motion: state, x, y. Expose: x, y, width, height, count.
+    // ConfigureNotify: x, y, width, height.
+    std::array<int64_t, 5> fields{};
+};
+
+class EventTraceWriter {
+public:
+    // Throws when the file cannot be created
+    EventTraceWriter(const std::string& path, int width, int height);
+    ~EventTraceWriter();
+
+    void append(const XEvent& event);
+    size_t count() const { return records; }
+
+    // Disable copy
+    EventTraceWriter(const EventTraceWriter&) = delete;
+    EventTraceWriter& operator=(const EventTraceWriter&) = delete;
+
+private:
+    std::ofstream out;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::microseconds last{0};
+    size_t records = 0;
+
+    void put(int64_t value);
+};
+
+class EventTraceReader {
+public:
+    // Throws when the file is missing or not a trace
+    explicit EventTraceReader(const std::string& path);
+
+    int width() const { return initial_width; }
+    int height() const { return initial_height; }
+    // False at the end of the trace; throws on a truncated record
+    bool next(TraceRecord& out);
+
+    // Rebuilds the event for a window. Key codes are looked up again from the
+    // recorded keysym, as the replaying server's keymap may differ.
+    static void to_event(const TraceRecord& record, Display* display, Window window, XEvent& event);
+
+private:
+    std::ifstream in;
+    int initial_width = 0;
+    int initial_height = 0;
+    std::chrono::microseconds clock{0};
+
+    bool get(int64_t& value);
+};
@@ -0,0 +1,29 @@
+#include "font_warmup.hpp"
+#include "../utils/log.hpp"
+#include <fontconfig/fontconfig.h>
+#include <chrono>
+
+FontWarmup::FontWarmup(const std::vector<std::string>& names) {
+    auto start = std::chrono::steady_clock::now();
+    if (!FcInit()) {
+        LOG_WARN(Gui, "fontconfig failed to initialize; fonts will load on first use.");
+        return;
+    }
+    for (const std::string& name : names) {
+        // Same parse and substitution steps as XftFontMatch, minus the display defaults
+        FcPattern* pattern = FcNameParse(reinterpret_cast<const FcChar8*>(name.c_str()));
+        if (!pattern) {
+            continue;
+        }
+        FcConfigSubstitute(nullptr, pattern, FcMatchPattern);
+        FcDefaultSubstitute(pattern);
+        FcResult result;
+        if (FcPattern* match = FcFontMatch(nullptr, pattern, &result)) {
+            matched_count++;
+            FcPatternDestroy(match);
+        }
+        FcPatternDestroy(pattern);
+    }
+    elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOG_DEBUG(Gui, "Font warmup: %zu of %zu names matched in %.2f ms.", matched_count, names.size(), elapsed);
+}
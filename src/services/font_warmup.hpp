@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Loads the fontconfig configuration and cache files and matches the given
+// Xft font names ahead of time, so the first XftFontOpenName calls only
+// open the chosen file. Needs no display: it runs while the X connection
+// and the interpreter are still starting.
+class FontWarmup {
+public:
+    explicit FontWarmup(const std::vector<std::string>& names);
+
+    size_t matched() const { return matched_count; }
+    double elapsed_ms() const { return elapsed; }
+
+private:
+    size_t matched_count = 0;
+    double elapsed = 0.0;
+};
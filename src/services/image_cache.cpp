@@ -0,0 +1,298 @@
+#include "image_cache.hpp"
+#include "../utils/log.hpp"
+#include <X11/Xutil.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace {
+
+// Drawable sizes are 16-bit signed on the wire
+constexpr int kMaxPixmapSide = 32767;
+
+// BadAlloc for a pixmap the server cannot hold would reach the default
+// handler, which exits; uploads trap it instead
+bool upload_failed = false;
+
+int trap_upload_error(Display*, XErrorEvent*) {
+    upload_failed = true;
+    return 0;
+}
+
+} // namespace
+
+ImageCache::ImageCache(size_t capacity)
+    : capacity(capacity)
+{
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        throw std::runtime_error("Failed to create eventfd for image decodes");
+    }
+}
+
+ImageCache::~ImageCache() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (wake_fd >= 0) {
+        close(wake_fd);
+    }
+}
+
+void ImageCache::attach(Display* display, int screen, bool server_side) {
+    if (display && server_side) {
+        int event_base, error_base;
+        if (!XRenderQueryExtension(display, &event_base, &error_base) ||
+            !XRenderFindStandardFormat(display, PictStandardARGB32)) {
+            LOG_WARN(Gui, "No XRender ARGB32 format; images stay in client memory.");
+            server_side = false;
+        }
+    }
+    // Images already uploaded belong to the previous display; release them here, not later
+    std::unordered_map<std::string, Entry> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (display != this->display || server_side != this->server_side) {
+            dropped.swap(entries);
+            lru.clear();
+            counters.bytes = 0;
+        }
+        this->display = display;
+        this->screen = screen;
+        this->server_side = server_side;
+    }
+}
+
+ImageRequestId ImageCache::load(const std::string& path, int width, int height, ImageCallback on_ready) {
+    std::string key = std::to_string(std::max(width, 0)) + "x" + std::to_string(std::max(height, 0)) + ":" + path;
+    ImageHandle hit;
+    ImageRequestId id = 0;
+    bool start = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            counters.hits++;
+            touch(it->second);
+            hit = it->second.image;
+        } else {
+            counters.misses++;
+            id = next_id++;
+            // Requests for an image already being decoded wait for that decode
+            auto waiting = pending.find(key);
+            if (waiting == pending.end()) {
+                waiting = pending.emplace(key, std::vector<Waiter>()).first;
+                counters.decodes++;
+                start = true;
+            }
+            waiting->second.push_back(Waiter{ id, std::move(on_ready) });
+        }
+    }
+    if (hit) {
+        if (on_ready) {
+            on_ready(hit);
+        }
+        return 0;
+    }
+    if (start) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (!worker.joinable()) {
+                worker = std::thread(&ImageCache::worker_loop, this);
+            }
+            jobs.push_back(Job{ key, path, width, height });
+        }
+        queue_cv.notify_one();
+    }
+    return id;
+}
+
+void ImageCache::cancel(ImageRequestId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& waiting : pending) {
+        std::vector<Waiter>& waiters = waiting.second;
+        for (auto it = waiters.begin(); it != waiters.end(); ++it) {
+            if (it->id == id) {
+                waiters.erase(it);
+                return;
+            }
+        }
+    }
+}
+
+void ImageCache::dispatch_completions() {
+    uint64_t counter;
+    while (read(wake_fd, &counter, sizeof(counter)) > 0) {
+        // Drain the eventfd so poll() blocks again
+    }
+
+    std::vector<Decoded> ready;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        ready.swap(finished);
+    }
+    for (Decoded& decoded : ready) {
+        // Uploading talks to the display, so it happens here rather than on the worker
+        ImageHandle image;
+        if (decoded.error.empty()) {
+            image = upload(decoded.image);
+        } else {
+            LOG_WARN(Gui, "%s", decoded.error.c_str());
+        }
+
+        std::vector<Waiter> waiters;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            counters.decode_ms += decoded.elapsed_ms;
+            if (!image) {
+                counters.decode_failures++;
+            } else if (entries.find(decoded.key) == entries.end()) {
+                lru.push_front(decoded.key);
+                entries.emplace(decoded.key, Entry{ image, lru.begin() });
+                counters.bytes += image->bytes();
+                evict();
+            }
+            auto waiting = pending.find(decoded.key);
+            if (waiting != pending.end()) {
+                waiters.swap(waiting->second);
+                pending.erase(waiting);
+            }
+        }
+        for (Waiter& waiter : waiters) {
+            if (waiter.on_ready) {
+                waiter.on_ready(image);
+            }
+        }
+    }
+}
+
+void ImageCache::set_capacity(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = bytes;
+    evict();
+}
+
+ImageCacheStats ImageCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    ImageCacheStats result = counters;
+    result.entries = entries.size();
+    result.capacity = capacity;
+    result.pending = pending.size();
+    return result;
+}
+
+void ImageCache::touch(Entry& entry) {
+    lru.splice(lru.begin(), lru, entry.lru_position);
+}
+
+void ImageCache::evict() {
+    // Images a widget still shows would stay in memory anyway; keep them shared
+    auto position = lru.end();
+    while (counters.bytes > capacity && position != lru.begin()) {
+        --position;
+        auto it = entries.find(*position);
+        if (it->second.image.use_count() > 1) {
+            continue;
+        }
+        counters.bytes -= it->second.image->bytes();
+        counters.evictions++;
+        entries.erase(it);
+        position = lru.erase(position);
+    }
+}
+
+ImageHandle ImageCache::upload(DecodedImage& decoded) {
+    if (display && server_side && (decoded.width > kMaxPixmapSide || decoded.height > kMaxPixmapSide)) {
+        bool wide = decoded.width >= decoded.height;
+        decoded = scale_image(std::move(decoded), wide ? kMaxPixmapSide : 0, wide ? 0 : kMaxPixmapSide);
+    }
+    auto image = std::make_shared<CachedImage>();
+    image->width = decoded.width;
+    image->height = decoded.height;
+    if (!display || !server_side) {
+        image->pixels = std::move(decoded.pixels);
+        return image;
+    }
+
+    unsigned width = static_cast<unsigned>(decoded.width);
+    unsigned height = static_cast<unsigned>(decoded.height);
+    XImage* ximage = XCreateImage(display, DefaultVisual(display, screen), 32, ZPixmap, 0,
+                                  reinterpret_cast<char*>(decoded.pixels.data()), width, height, 32, 0);
+    if (!ximage) {
+        LOG_WARN(Gui, "Failed to create a %ux%u XImage.", width, height);
+        return nullptr;
+    }
+    // The words are in host order; Xlib swaps them if the server differs
+    const uint32_t probe = 1;
+    ximage->byte_order = *reinterpret_cast<const uint8_t*>(&probe) ? LSBFirst : MSBFirst;
+
+    XSync(display, False); // Earlier requests' errors go to the usual handler
+    upload_failed = false;
+    XErrorHandler previous = XSetErrorHandler(trap_upload_error);
+    Pixmap pixmap = XCreatePixmap(display, RootWindow(display, screen), width, height, 32);
+    GC gc = XCreateGC(display, pixmap, 0, nullptr);
+    XPutImage(display, pixmap, gc, ximage, 0, 0, 0, 0, width, height);
+    XFreeGC(display, gc);
+    XSync(display, False);
+    bool failed = upload_failed;
+    if (failed) {
+        // The id may name no pixmap; that error is trapped too
+        XFreePixmap(display, pixmap);
+        XSync(display, False);
+    }
+    XSetErrorHandler(previous);
+    ximage->data = nullptr; // Still owned by decoded
+    XDestroyImage(ximage);
+    if (failed) {
+        LOG_WARN(Gui, "The X server could not hold a %ux%u image.", width, height);
+        return nullptr;
+    }
+
+    image->display = display;
+    image->pixmap = pixmap;
+    image->picture = XRenderCreatePicture(display, pixmap, XRenderFindStandardFormat(display, PictStandardARGB32),
+                                          0, nullptr);
+    return image;
+}
+
+void ImageCache::worker_loop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        Decoded decoded;
+        decoded.key = std::move(job.key);
+        try {
+            decoded.image = scale_image(decode_image(job.path), job.width, job.height);
+        } catch (const std::exception& e) {
+            decoded.error = e.what();
+        }
+        decoded.elapsed_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            finished.push_back(std::move(decoded));
+        }
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0) {
+            LOG_ERROR(Gui, "Failed to signal image decode completion.");
+        }
+    }
+}
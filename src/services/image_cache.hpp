@@ -0,0 +1,77 @@
+#pragma once
+#include "../interfaces/iimage_cache.hpp"
+#include "image_decoder.hpp"
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class ImageCache : public IImageCache {
+public:
+    static constexpr size_t kDefaultCapacity = 64 * 1024 * 1024;
+
+    explicit ImageCache(size_t capacity = kDefaultCapacity);
+    ~ImageCache() override;
+
+    void attach(Display* display, int screen, bool server_side) override;
+    ImageRequestId load(const std::string& path, int width, int height, ImageCallback on_ready) override;
+    void cancel(ImageRequestId id) override;
+    int completion_fd() const override { return wake_fd; }
+    void dispatch_completions() override;
+    void set_capacity(size_t bytes) override;
+    ImageCacheStats stats() const override;
+
+private:
+    Display* display = nullptr;
+    int screen = 0;
+    bool server_side = false;
+
+    // Keyed by "WxH:path"; front of lru is the most recently used
+    struct Entry {
+        ImageHandle image;
+        std::list<std::string>::iterator lru_position;
+    };
+    struct Waiter {
+        ImageRequestId id;
+        ImageCallback on_ready;
+    };
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;
+    // Decodes in flight, with everyone waiting for each
+    std::unordered_map<std::string, std::vector<Waiter>> pending;
+    ImageRequestId next_id = 1;
+    size_t capacity;
+    ImageCacheStats counters;
+
+    // Decoder thread, started on the first miss
+    struct Job {
+        std::string key;
+        std::string path;
+        int width;
+        int height;
+    };
+    struct Decoded {
+        std::string key;
+        DecodedImage image;
+        std::string error; // Empty on success
+        double elapsed_ms;
+    };
+    std::thread worker;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<Job> jobs;
+    std::vector<Decoded> finished;
+    bool stopping = false;
+    int wake_fd = -1;
+
+    void worker_loop();
+    ImageHandle upload(DecodedImage& decoded);
+    // Called with mutex held
+    void touch(Entry& entry);
+    void evict();
+};
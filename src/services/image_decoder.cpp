@@ -0,0 +1,202 @@
+#include "image_decoder.hpp"
+#include <png.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+// Larger files are refused rather than allocated
+constexpr int kMaxDimension = 16384;
+
+void check_size(const std::string& path, int width, int height) {
+    if (width <= 0 || height <= 0 || width > kMaxDimension || height > kMaxDimension) {
+        throw std::runtime_error("Image " + path + " has unsupported size " +
+                                 std::to_string(width) + "x" + std::to_string(height));
+    }
+}
+
+void premultiply(std::vector<uint32_t>& pixels) {
+    for (uint32_t& pixel : pixels) {
+        uint32_t a = pixel >> 24;
+        if (a == 255) {
+            continue;
+        }
+        uint32_t out = a << 24;
+        for (int shift = 0; shift < 24; shift += 8) {
+            uint32_t t = ((pixel >> shift) & 0xff) * a + 128;
+            out |= ((t + (t >> 8)) >> 8) << shift;
+        }
+        pixel = out;
+    }
+}
+
+DecodedImage decode_png(const std::string& path) {
+    png_image png = {};
+    png.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&png, path.c_str())) {
+        throw std::runtime_error("Failed to read PNG " + path + ": " + png.message);
+    }
+    int width = static_cast<int>(png.width);
+    int height = static_cast<int>(png.height);
+    if (width <= 0 || height <= 0 || width > kMaxDimension || height > kMaxDimension) {
+        png_image_free(&png);
+        check_size(path, width, height);
+    }
+    // BGRA bytes are a8r8g8b8 words on a little-endian host
+    png.format = PNG_FORMAT_BGRA;
+    DecodedImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height);
+    if (!png_image_finish_read(&png, nullptr, image.pixels.data(), 0, nullptr)) {
+        throw std::runtime_error("Failed to decode PNG " + path + ": " + png.message);
+    }
+    premultiply(image.pixels);
+    return image;
+}
+
+// Netpbm header field: whitespace and # comments before a decimal number
+int ppm_field(const std::string& data, size_t& pos, const std::string& path) {
+    while (pos < data.size()) {
+        if (data[pos] == '#') {
+            while (pos < data.size() && data[pos] != '\n') {
+                ++pos;
+            }
+        } else if (std::isspace(static_cast<unsigned char>(data[pos]))) {
+            ++pos;
+        } else {
+            break;
+        }
+    }
+    long value = 0;
+    size_t start = pos;
+    while (pos < data.size() && std::isdigit(static_cast<unsigned char>(data[pos])) && value <= 1 << 24) {
+        value = value * 10 + (data[pos++] - '0');
+    }
+    if (pos == start) {
+        throw std::runtime_error("Malformed PPM header in " + path);
+    }
+    return static_cast<int>(value);
+}
+
+DecodedImage decode_ppm(const std::string& path, const std::string& data) {
+    bool binary = data[1] == '6';
+    size_t pos = 2;
+    int width = ppm_field(data, pos, path);
+    int height = ppm_field(data, pos, path);
+    int maxval = ppm_field(data, pos, path);
+    check_size(path, width, height);
+    if (maxval <= 0 || maxval > 65535) {
+        throw std::runtime_error("Unsupported PPM maxval in " + path);
+    }
+
+    size_t count = static_cast<size_t>(width) * height;
+    int bytes = maxval > 255 ? 2 : 1;
+    // Checked before allocating: a header alone must not cost width*height*4 bytes
+    if (binary) {
+        ++pos; // The single whitespace byte ending the header
+        if (data.size() < pos + count * 3 * bytes) {
+            throw std::runtime_error("Truncated PPM " + path);
+        }
+    } else if (data.size() - pos < count * 3 * 2 - 1) {
+        // Each ASCII sample is at least a digit and a separator
+        throw std::runtime_error("Truncated PPM " + path);
+    }
+
+    DecodedImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t pixel = 0xff000000u;
+        for (int shift = 16; shift >= 0; shift -= 8) {
+            uint32_t sample;
+            if (!binary) {
+                sample = static_cast<uint32_t>(ppm_field(data, pos, path));
+            } else if (bytes == 2) {
+                sample = (static_cast<uint8_t>(data[pos]) << 8) | static_cast<uint8_t>(data[pos + 1]);
+                pos += 2;
+            } else {
+                sample = static_cast<uint8_t>(data[pos++]);
+            }
+            sample = std::min<uint32_t>(sample, maxval);
+            pixel |= ((sample * 255 + maxval / 2) / maxval) << shift;
+        }
+        image.pixels[i] = pixel;
+    }
+    return image;
+}
+
+} // namespace
+
+DecodedImage decode_image(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open image " + path);
+    }
+    char magic[8] = {};
+    file.read(magic, sizeof(magic));
+    if (file.gcount() == sizeof(magic) && png_sig_cmp(reinterpret_cast<png_const_bytep>(magic), 0, 8) == 0) {
+        file.close();
+        return decode_png(path);
+    }
+    if (file.gcount() >= 2 && magic[0] == 'P' && (magic[1] == '6' || magic[1] == '3')) {
+        file.clear();
+        file.seekg(0);
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return decode_ppm(path, data);
+    }
+    throw std::runtime_error("Unsupported image format: " + path);
+}
+
+DecodedImage scale_image(DecodedImage image, int width, int height) {
+    if ((width <= 0 && height <= 0) || image.width <= 0 || image.height <= 0) {
+        return image;
+    }
+    if (width <= 0) {
+        width = std::max(1, static_cast<int>(std::lround(static_cast<double>(height) * image.width / image.height)));
+    } else if (height <= 0) {
+        height = std::max(1, static_cast<int>(std::lround(static_cast<double>(width) * image.height / image.width)));
+    }
+    width = std::min(width, kMaxDimension);
+    height = std::min(height, kMaxDimension);
+    if (width == image.width && height == image.height) {
+        return image;
+    }
+
+    DecodedImage out;
+    out.width = width;
+    out.height = height;
+    out.pixels.resize(static_cast<size_t>(width) * height);
+    size_t src_w = static_cast<size_t>(image.width);
+    size_t src_h = static_cast<size_t>(image.height);
+    for (size_t y = 0; y < static_cast<size_t>(height); ++y) {
+        size_t y0 = y * src_h / height;
+        size_t y1 = std::max(y0 + 1, (y + 1) * src_h / height);
+        for (size_t x = 0; x < static_cast<size_t>(width); ++x) {
+            size_t x0 = x * src_w / width;
+            size_t x1 = std::max(x0 + 1, (x + 1) * src_w / width);
+            // Premultiplied channels average without fringes
+            uint64_t sum[4] = {};
+            for (size_t sy = y0; sy < y1; ++sy) {
+                const uint32_t* row = image.pixels.data() + sy * src_w;
+                for (size_t sx = x0; sx < x1; ++sx) {
+                    for (int c = 0; c < 4; ++c) {
+                        sum[c] += (row[sx] >> (c * 8)) & 0xff;
+                    }
+                }
+            }
+            uint64_t area = (y1 - y0) * (x1 - x0);
+            uint32_t pixel = 0;
+            for (int c = 0; c < 4; ++c) {
+                pixel |= static_cast<uint32_t>((sum[c] + area / 2) / area) << (c * 8);
+            }
+            out.pixels[y * width + x] = pixel;
+        }
+    }
+    return out;
+}
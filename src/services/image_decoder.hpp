@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Decoded pixels as premultiplied a8r8g8b8, rows packed without padding
+struct DecodedImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> pixels;
+};
+
+// PNG (through libpng) or binary/plain PPM, told apart by the file's magic
+// bytes. Throws std::runtime_error for unreadable or unsupported files.
+DecodedImage decode_image(const std::string& path);
+
+// Box-filtered to width x height (nearest sample when enlarging). A zero
+// dimension follows the aspect ratio; both zero return the image unchanged.
+DecodedImage scale_image(DecodedImage image, int width, int height);
@@ -0,0 +1,117 @@
+#include "resource_cache.hpp"
+#include "../utils/x11_raii.hpp"
+#include <chrono>
+#include "../utils/log.hpp"
+#include <sstream>
+#include <stdexcept>
+
+void ResourceCache::attach(Display* d, int s) {
+    std::lock_guard<std::mutex> lock(mutex);
+    display = d;
+    screen = s;
+}
+
+FontHandle ResourceCache::font(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!display) {
+        throw std::runtime_error("ResourceCache used before attach()");
+    }
+
+    auto it = fonts.find(name);
+    if (it != fonts.end()) {
+        if (FontHandle cached = it->second.lock()) {
+            counters.font_hits++;
+            return cached;
+        }
+    }
+
+    counters.font_misses++;
+    auto started = std::chrono::steady_clock::now();
+    XftFont* raw_font = XftFontOpenName(display, screen, name.c_str());
+    counters.font_open_ms += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count();
+    if (!raw_font) {
+        throw std::runtime_error("Failed to load font: " + name);
+    }
+    LOG_INFO(Gui, "Loaded font: %s", name.c_str());
+
+    Display* owner = display;
+    FontHandle handle(raw_font, [owner](XftFont* f) {
+        XftFontClose(owner, f);
+    });
+    prune(fonts);
+    fonts[name] = handle;
+    font_ids[raw_font] = next_font_id++;
+    return handle;
+}
+
+FontHandle ResourceCache::font(const std::string& family, double size) {
+    std::ostringstream pattern;
+    pattern << family << "-" << size;
+    return font(pattern.str());
+}
+
+ColorHandle ResourceCache::color(const std::string& spec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!display) {
+        throw std::runtime_error("ResourceCache used before attach()");
+    }
+
+    auto it = colors.find(spec);
+    if (it != colors.end()) {
+        if (ColorHandle cached = it->second.lock()) {
+            counters.color_hits++;
+            return cached;
+        }
+    }
+
+    counters.color_misses++;
+    Visual* visual = DefaultVisual(display, screen);
+    Colormap colormap = DefaultColormap(display, screen);
+    auto raw_color = std::make_unique<XftColor>();
+    if (!XftColorAllocName(display, visual, colormap, spec.c_str(), raw_color.get())) {
+        LOG_ERROR(Gui, "Failed to allocate color: %s", spec.c_str());
+        throw std::runtime_error("Failed to allocate color: " + spec);
+    }
+    LOG_DEBUG(Gui, "Allocated color: %s", spec.c_str());
+
+    ColorHandle handle(raw_color.release(),
+                       XftColorDeleter{ display, visual, colormap });
+    prune(colors);
+    colors[spec] = handle;
+    return handle;
+}
+
+uint64_t ResourceCache::font_id(const XftFont* font) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = font_ids.find(font);
+    return it != font_ids.end() ? it->second : 0;
+}
+
+ResourceCacheStats ResourceCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    ResourceCacheStats result = counters;
+    result.fonts_live = 0;
+    for (const auto& entry : fonts) {
+        result.fonts_live += entry.second.expired() ? 0 : 1;
+    }
+    result.colors_live = 0;
+    for (const auto& entry : colors) {
+        result.colors_live += entry.second.expired() ? 0 : 1;
+    }
+    return result;
+}
+
+template<typename T>
+size_t ResourceCache::prune(std::unordered_map<std::string, std::weak_ptr<T>>& entries) {
+    size_t removed = 0;
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->second.expired()) {
+            it = entries.erase(it);
+            ++removed;
+        } else {
+            ++it;
+        }
+    }
+    return removed;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "../interfaces/iresource_cache.hpp"
+#include <mutex>
+#include <unordered_map>
+
+class ResourceCache : public IResourceCache {
+public:
+    ResourceCache() = default;
+    ~ResourceCache() override = default;
+
+    void attach(Display* display, int screen) override;
+
+    FontHandle font(const std::string& name) override;
+    FontHandle font(const std::string& family, double size) override;
+    ColorHandle color(const std::string& spec) override;
+    uint64_t font_id(const XftFont* font) const override;
+
+    ResourceCacheStats stats() const override;
+
+private:
+    Display* display = nullptr;
+    int screen = 0;
+
+    // Entries expire with their last handle and are pruned on the next miss
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::weak_ptr<XftFont>> fonts;
+    std::unordered_map<std::string, std::weak_ptr<XftColor>> colors;
+    // Overwritten when a new font lands on an address; entries of closed fonts are never read
+    std::unordered_map<const XftFont*, uint64_t> font_ids;
+    uint64_t next_font_id = 1;
+    ResourceCacheStats counters;
+
+    template<typename T>
+    static size_t prune(std::unordered_map<std::string, std::weak_ptr<T>>& entries);
+};
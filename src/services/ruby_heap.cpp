@@ -0,0 +1,134 @@
+#include "ruby_heap.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+
+RubyHeap::~RubyHeap() {
+    for (void* chunk : chunks) {
+        std::free(chunk);
+    }
+}
+
+size_t RubyHeap::capacity(void* ptr, bool& pooled) const {
+    auto base = reinterpret_cast<uintptr_t>(ptr) & ~static_cast<uintptr_t>(kChunkSize - 1);
+    auto it = chunk_class.find(base);
+    pooled = it != chunk_class.end();
+    return pooled ? class_size(it->second) : malloc_usable_size(ptr);
+}
+
+bool RubyHeap::admit(size_t grow) {
+    if (limit != 0 && stats.held_bytes + grow > limit) {
+        stats.refused++;
+        return false;
+    }
+    return true;
+}
+
+void* RubyHeap::allocate_pooled(size_t index) {
+    SizeClass& sc = classes[index];
+    if (sc.free) {
+        FreeBlock* block = sc.free;
+        sc.free = block->next;
+        stats.pool_reuses++;
+        return block;
+    }
+    size_t size = class_size(index);
+    if (sc.cursor == sc.end) {
+        void* chunk = std::aligned_alloc(kChunkSize, kChunkSize);
+        if (!chunk) {
+            return nullptr;
+        }
+        chunks.push_back(chunk);
+        chunk_class[reinterpret_cast<uintptr_t>(chunk)] = static_cast<uint8_t>(index);
+        stats.reserved_bytes += kChunkSize;
+        sc.cursor = static_cast<char*>(chunk);
+        // Whole blocks only; the remainder of an odd-sized class is left unused
+        sc.end = sc.cursor + kChunkSize / size * size;
+    }
+    void* block = sc.cursor;
+    sc.cursor += size;
+    return block;
+}
+
+void* RubyHeap::allocate(size_t size) {
+    if (size <= kMaxPooled) {
+        size_t index = class_of(size);
+        if (!admit(class_size(index))) {
+            return nullptr;
+        }
+        void* block = allocate_pooled(index);
+        if (block) {
+            stats.held_bytes += class_size(index);
+        }
+        return block;
+    }
+    if (!admit(size)) {
+        return nullptr;
+    }
+    void* block = std::malloc(size);
+    if (block) {
+        size_t usable = malloc_usable_size(block);
+        stats.held_bytes += usable;
+        stats.reserved_bytes += usable;
+    }
+    return block;
+}
+
+void RubyHeap::release(void* ptr) {
+    bool pooled;
+    size_t size = capacity(ptr, pooled);
+    stats.held_bytes -= size;
+    if (!pooled) {
+        stats.reserved_bytes -= size;
+        std::free(ptr);
+        return;
+    }
+    SizeClass& sc = classes[class_of(size)];
+    auto* block = static_cast<FreeBlock*>(ptr);
+    block->next = sc.free;
+    sc.free = block;
+}
+
+void* RubyHeap::reallocate(void* ptr, size_t size) {
+    if (size == 0) {
+        if (ptr) {
+            release(ptr);
+        }
+        return nullptr;
+    }
+    stats.allocations++;
+    stats.allocated_bytes += size;
+    if (!ptr) {
+        return allocate(size);
+    }
+
+    bool pooled;
+    size_t old_size = capacity(ptr, pooled);
+    if (pooled && size <= old_size && (size > old_size / 2 || old_size == kGranule)) {
+        return ptr; // Still fits and wastes less than half: keep the block
+    }
+    if (!pooled && size > kMaxPooled) {
+        // Large to large: let malloc grow or shrink in place
+        if (size > old_size && !admit(size - old_size)) {
+            return nullptr;
+        }
+        void* block = std::realloc(ptr, size);
+        if (block) {
+            size_t usable = malloc_usable_size(block);
+            stats.held_bytes = stats.held_bytes - old_size + usable;
+            stats.reserved_bytes = stats.reserved_bytes - old_size + usable;
+        }
+        return block;
+    }
+
+    // Crossing between classes or between pool and malloc: move the contents
+    void* block = allocate(size);
+    if (!block) {
+        // A shrink can always stay where it is; otherwise ptr stays valid, as with realloc
+        return size <= old_size ? ptr : nullptr;
+    }
+    std::memcpy(block, ptr, std::min(old_size, size));
+    release(ptr);
+    return block;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Allocator behind one interpreter's mrb_allocf. Requests up to kMaxPooled
+// bytes (objects, short strings, small arrays and hashes) are rounded to a
+// 16-byte size class and carved from 64 KiB chunks; freed blocks go back to
+// their class's free list, chunks are only returned when the heap is
+// destroyed. Larger requests go to malloc. Not thread-safe: the interpreter
+// lock already serializes every call.
+class RubyHeap {
+public:
+    static constexpr size_t kGranule = 16;
+    static constexpr size_t kMaxPooled = 512;
+    static constexpr size_t kChunkSize = 64 * 1024;
+
+    struct Counters {
+        uint64_t allocations = 0;     // Calls that allocated or grew a block
+        uint64_t allocated_bytes = 0; // Bytes requested by those calls
+        uint64_t pool_reuses = 0;     // Served from a free list, no fresh memory
+        uint64_t refused = 0;         // Failed because of the limit
+        size_t held_bytes = 0;        // Capacity of every block mruby holds
+        size_t reserved_bytes = 0;    // Chunks plus large blocks, including free lists
+    };
+
+    RubyHeap() = default;
+    ~RubyHeap();
+
+    // mrb_allocf contract: size 0 frees ptr, otherwise realloc semantics.
+    // Returns nullptr when memory is exhausted or the block would take
+    // held_bytes over the limit; mruby then collects and raises NoMemoryError.
+    void* reallocate(void* ptr, size_t size);
+
+    // Cap on held_bytes; zero means unlimited. Blocks already held above a
+    // lowered limit stay valid, only growth is refused.
+    void set_limit(size_t bytes) { limit = bytes; }
+    size_t get_limit() const { return limit; }
+
+    // Raises the limit by extra bytes while alive, so the host can still
+    // format a result or an error after a script stopped at the cap
+    class Headroom {
+    public:
+        Headroom(RubyHeap& heap, size_t extra) : heap(heap), saved(heap.limit) {
+            if (saved > 0) {
+                heap.limit = saved + extra;
+            }
+        }
+        ~Headroom() { heap.limit = saved; }
+        Headroom(const Headroom&) = delete;
+        Headroom& operator=(const Headroom&) = delete;
+
+    private:
+        RubyHeap& heap;
+        size_t saved;
+    };
+
+    // Lowers the limit to held_bytes + extra while alive (never raises it),
+    // bounding what one host-side call into Ruby may allocate
+    class Ceiling {
+    public:
+        Ceiling(RubyHeap& heap, size_t extra) : heap(heap), saved(heap.limit) {
+            size_t cap = heap.stats.held_bytes + extra;
+            if (saved == 0 || cap < saved) {
+                heap.limit = cap;
+            }
+        }
+        ~Ceiling() { heap.limit = saved; }
+        Ceiling(const Ceiling&) = delete;
+        Ceiling& operator=(const Ceiling&) = delete;
+
+    private:
+        RubyHeap& heap;
+        size_t saved;
+    };
+    const Counters& counters() const { return stats; }
+
+    // Disable copy
+    RubyHeap(const RubyHeap&) = delete;
+    RubyHeap& operator=(const RubyHeap&) = delete;
+
+private:
+    static constexpr size_t kClasses = kMaxPooled / kGranule;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+    struct SizeClass {
+        FreeBlock* free = nullptr;
+        char* cursor = nullptr; // Uncarved tail of the newest chunk
+        char* end = nullptr;
+    };
+
+    SizeClass classes[kClasses];
+    // Chunk base address -> size class; chunks are kChunkSize-aligned, so any
+    // pooled block finds its chunk by masking its address
+    std::unordered_map<uintptr_t, uint8_t> chunk_class;
+    std::vector<void*> chunks;
+    size_t limit = 0;
+    Counters stats;
+
+    static size_t class_of(size_t size) { return (size - 1) / kGranule; }
+    static size_t class_size(size_t index) { return (index + 1) * kGranule; }
+    // Usable size of a live block; also tells whether it is pooled
+    size_t capacity(void* ptr, bool& pooled) const;
+    bool admit(size_t grow);
+    void* allocate(size_t size);
+    void* allocate_pooled(size_t index);
+    void release(void* ptr);
+};
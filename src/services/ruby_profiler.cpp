@@ -0,0 +1,149 @@
+#include "ruby_profiler.hpp"
+#include <mruby/debug.h>
+#include <mruby/irep.h>
+#include <mruby/proc.h>
+#include <algorithm>
+
+void RubyProfiler::start(std::chrono::microseconds interval) {
+    interval_us = std::max<int64_t>(interval.count(), 1);
+    active = true;
+}
+
+void RubyProfiler::stop() {
+    active = false;
+}
+
+void RubyProfiler::rearm() {
+    ticks = 0;
+    next_sample = std::chrono::steady_clock::now() + std::chrono::microseconds(interval_us.load());
+}
+
+uint32_t RubyProfiler::frame_id(const std::string& name) {
+    auto it = frame_ids.find(name);
+    if (it != frame_ids.end()) {
+        return it->second;
+    }
+    std::lock_guard<std::mutex> lock(names_mutex);
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.push_back(name);
+    frame_ids.emplace(name, id);
+    return id;
+}
+
+void RubyProfiler::sample(mrb_state* mrb, const mrb_irep* irep, const mrb_code* pc) {
+    next_sample = std::chrono::steady_clock::now() + std::chrono::microseconds(interval_us.load());
+
+    size_t at = head.load(std::memory_order_relaxed);
+    if (at - tail.load(std::memory_order_acquire) >= kCollectAt) {
+        collect();
+    }
+    if (at - tail.load(std::memory_order_acquire) == kRingCapacity) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Sample& out = ring[at % kRingCapacity];
+
+    mrb_callinfo* base = mrb->c->cibase;
+    mrb_callinfo* top = mrb->c->ci;
+    size_t depth = static_cast<size_t>(top - base) + 1;
+    if (depth > kMaxDepth) {
+        truncated.fetch_add(1, std::memory_order_relaxed);
+        depth = kMaxDepth;
+    }
+    out.depth = 0;
+    for (mrb_callinfo* ci = base; ci <= top && out.depth < depth; ++ci) {
+        // "name (file:line)", or "name [c]" for methods implemented in C.
+        // mrb_sym_name_len only looks the name up; mrb_sym_name may allocate
+        // a quoted copy, which this hook must not do.
+        const char* name = nullptr;
+        mrb_int name_len = 0;
+        if (ci->mid) {
+            name = mrb_sym_name_len(mrb, ci->mid, &name_len);
+        }
+        if (name) {
+            scratch.assign(name, static_cast<size_t>(name_len));
+        } else {
+            scratch.assign("<main>");
+        }
+        const struct RProc* proc = ci->proc;
+        if (proc && MRB_PROC_CFUNC_P(proc)) {
+            scratch += " [c]";
+        } else if (proc) {
+            // The running frame is at pc; callers saved the instruction after their call
+            const mrb_irep* frame_irep = ci == top ? irep : proc->body.irep;
+            const mrb_code* frame_pc = ci == top ? pc : ci->pc;
+            if (frame_irep && frame_pc) {
+                uint32_t offset = static_cast<uint32_t>(frame_pc - frame_irep->iseq);
+                if (ci != top && offset > 0) {
+                    offset--;
+                }
+                const char* file = mrb_debug_get_filename(mrb, frame_irep, offset);
+                int32_t line = mrb_debug_get_line(mrb, frame_irep, offset);
+                if (file) {
+                    scratch += " (";
+                    scratch += file;
+                    if (line > 0) {
+                        scratch += ":" + std::to_string(line);
+                    }
+                    scratch += ")";
+                }
+            }
+        }
+        // ';' separates frames in the folded format
+        std::replace(scratch.begin(), scratch.end(), ';', ':');
+        out.frames[out.depth++] = frame_id(scratch);
+    }
+    head.store(at + 1, std::memory_order_release);
+}
+
+void RubyProfiler::drain() {
+    size_t end = head.load(std::memory_order_acquire);
+    size_t at = tail.load(std::memory_order_relaxed);
+    for (; at != end; ++at) {
+        const Sample& in = ring[at % kRingCapacity];
+        stacks[std::vector<uint32_t>(in.frames.begin(), in.frames.begin() + in.depth)]++;
+        aggregated++;
+    }
+    tail.store(at, std::memory_order_release);
+}
+
+void RubyProfiler::collect() {
+    std::unique_lock<std::mutex> lock(consumer_mutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+        drain();
+    }
+}
+
+std::string RubyProfiler::folded(bool reset) {
+    std::lock_guard<std::mutex> lock(consumer_mutex);
+    drain();
+    std::string out;
+    {
+        std::lock_guard<std::mutex> names_lock(names_mutex);
+        for (const auto& entry : stacks) {
+            for (size_t i = 0; i < entry.first.size(); ++i) {
+                if (i > 0) {
+                    out += ';';
+                }
+                out += names[entry.first[i]];
+            }
+            out += ' ';
+            out += std::to_string(entry.second);
+            out += '\n';
+        }
+    }
+    if (reset) {
+        stacks.clear();
+    }
+    return out;
+}
+
+RubyProfiler::Stats RubyProfiler::stats() {
+    std::lock_guard<std::mutex> lock(consumer_mutex);
+    drain();
+    Stats result;
+    result.samples = aggregated;
+    result.dropped = dropped.load(std::memory_order_relaxed);
+    result.truncated = truncated.load(std::memory_order_relaxed);
+    return result;
+}
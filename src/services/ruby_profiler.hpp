@@ -0,0 +1,91 @@
+#pragma once
+#include <mruby.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct mrb_irep;
+
+// Sampling profiler driven by the interpreter's code-fetch hook: while
+// enabled, the hook checks the clock every few instructions and, once an
+// interval has passed, records the Ruby call stack. Samples go through a
+// single-producer ring, so the interpreter thread never blocks on a reader.
+// Reading aggregates them into folded stacks ("outer;inner;leaf count"),
+// the input format of flamegraph.pl and speedscope.
+class RubyProfiler {
+public:
+    static constexpr size_t kMaxDepth = 48;
+    static constexpr size_t kRingCapacity = 4096;
+
+    struct Stats {
+        uint64_t samples = 0;  // Aggregated so far
+        uint64_t dropped = 0;  // Lost because the ring was full
+        uint64_t truncated = 0; // Deeper than kMaxDepth; the outermost frames were kept
+    };
+
+    // Safe from any thread; takes effect from the next evaluation
+    void start(std::chrono::microseconds interval);
+    void stop();
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+    // Interpreter thread (code-fetch hook). Cheap unless a sample is due.
+    void tick(mrb_state* mrb, const mrb_irep* irep, const mrb_code* pc) {
+        if ((++ticks & kClockMask) == 0 && std::chrono::steady_clock::now() >= next_sample) {
+            sample(mrb, irep, pc);
+        }
+    }
+    // Interpreter thread, when an evaluation starts: no sample is owed for time spent idle
+    void rearm();
+
+    // Moves waiting samples out of the ring, unless a reader is already at it.
+    // Any thread; never blocks.
+    void collect();
+    // Folded stacks of every sample taken since the last reset, one per line
+    std::string folded(bool reset);
+    Stats stats();
+
+private:
+    static constexpr uint32_t kClockMask = 63; // Read the clock every 64 instructions
+    // Fill level at which the producer collects by itself, for runs nobody reads until the end
+    static constexpr size_t kCollectAt = kRingCapacity / 2;
+
+    struct Sample {
+        uint32_t depth;
+        std::array<uint32_t, kMaxDepth> frames; // Frame ids, outermost first
+    };
+
+    std::atomic<bool> active{false};
+    std::atomic<int64_t> interval_us{1000};
+
+    // Producer side (interpreter thread)
+    uint32_t ticks = 0;
+    std::chrono::steady_clock::time_point next_sample = std::chrono::steady_clock::time_point::max();
+    std::unordered_map<std::string, uint32_t> frame_ids;
+    std::string scratch;
+
+    // Single-producer single-consumer ring; head is written by the producer only
+    std::vector<Sample> ring = std::vector<Sample>(kRingCapacity);
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> truncated{0};
+
+    // Frame names by id; appended by the producer when it meets a new frame
+    std::mutex names_mutex;
+    std::vector<std::string> names;
+
+    // Consumer side
+    std::mutex consumer_mutex;
+    std::map<std::vector<uint32_t>, uint64_t> stacks;
+    uint64_t aggregated = 0;
+
+    void sample(mrb_state* mrb, const mrb_irep* irep, const mrb_code* pc);
+    uint32_t frame_id(const std::string& name);
+    void drain(); // consumer_mutex held
+};
@@ -1,55 +1,729 @@
 #include "ruby_service.hpp"
+#include "streaming_inspector.hpp"
 #include <mruby/compile.h>
 #include <mruby/string.h>
+#include <mruby/proc.h>
+#include <mruby/irep.h>
+#include <mruby/gc.h>
+#include <mruby/error.h>
+#include <algorithm>
 #include <stdexcept>
-#include <iostream>
+#include "../utils/log.hpp"
+#include "../core/embedded_scripts.hpp"
 #include <fstream>
 #include <sstream>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
-RubyService::RubyService() : mrb(mrb_open()) {
+// The code-fetch hook only exists when mruby is built with the debug hook.
+// CMake defines it (MODERNX_MRUBY_DEBUG_HOOK) after checking libmruby has it.
+#if defined(MRB_USE_DEBUG_HOOK) || defined(MRB_ENABLE_DEBUG_HOOK)
+#define MODERNX_HAS_FETCH_HOOK 1
+#endif
+
+namespace {
+
+// FNV-1a over the source, mixed with the compile scope and the number of
+// locals known to the context (a cached irep bakes in their register slots)
+uint64_t hash_source(const std::string& code, const std::string& scope, int locals) {
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const char* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ULL;
+        }
+    };
+    mix(scope.data(), scope.size());
+    mix(reinterpret_cast<const char*>(&locals), sizeof(locals));
+    mix(code.data(), code.size());
+    return hash;
+}
+
+// Extra heap granted while the host formats results and errors
+constexpr size_t kFormatHeadroom = 1024 * 1024;
+
+// Bodies for mrb_protect_error. Host-side calls have no Ruby frame to catch a
+// raise, and mruby aborts the process on an uncaught one: NoMemoryError at
+// the heap cap, or an #inspect that raises, would otherwise kill us.
+mrb_value inspect_body(mrb_state* mrb, void* value) {
+    return mrb_inspect(mrb, *static_cast<mrb_value*>(value));
+}
+
+mrb_value proc_body(mrb_state* mrb, void* irep) {
+    return mrb_obj_value(mrb_proc_new(mrb, static_cast<mrb_irep*>(irep)));
+}
+
+struct ErrorText {
+    struct RClass* error_class;
+    const std::string& text;
+};
+
+mrb_value error_body(mrb_state* mrb, void* error) {
+    auto* e = static_cast<ErrorText*>(error);
+    return mrb_exc_new(mrb, e->error_class, e->text.data(), static_cast<mrb_int>(e->text.size()));
+}
+
+} // namespace
+
+RubyService::RubyService(std::shared_ptr<Telemetry> telemetry)
+    : telemetry(std::move(telemetry)),
+      mrb(mrb_open_allocf(&RubyService::heap_allocf, this)) {
     if (!mrb) {
-        std::cerr << "Failed to initialize mruby." << std::endl;
+        LOG_ERROR(Ruby, "Failed to initialize mruby.");
         throw std::runtime_error("Failed to initialize mruby");
     }
-    std::cout << "mruby initialized." << std::endl;
+    repl_cxt = mrbc_context_new(mrb);
+    if (!repl_cxt) {
+        mrb_close(mrb);
+        throw std::runtime_error("Failed to create mruby compile context");
+    }
+    repl_cxt->capture_errors = TRUE;
+    mrbc_filename(mrb, repl_cxt, "(repl)");
+
+    // Derived from Exception, not StandardError, so a bare `rescue` cannot swallow it
+    mrb->ud = this;
+    interrupt_class = mrb_define_class(mrb, "EvalInterrupt", mrb->eException_class);
+
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        mrbc_context_free(mrb, repl_cxt);
+        mrb_close(mrb);
+        throw std::runtime_error("Failed to create eventfd for Ruby completions");
+    }
+#ifndef MODERNX_HAS_FETCH_HOOK
+    LOG_WARN(Ruby, "mruby built without MRB_USE_DEBUG_HOOK: running code cannot be cancelled, "
+             "timed out or profiled.");
+#endif
+    LOG_INFO(Ruby, "mruby initialized.");
 }
 
 RubyService::~RubyService() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+        // Interrupt whatever is running so the worker can be joined
+        cancel_id = running_id.load();
+    }
+    queue_cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (wake_fd >= 0) {
+        close(wake_fd);
+    }
+    if (telemetry) {
+        // Leave the gauges as if this interpreter had never existed
+        telemetry->adjust_ruby_heap(-reported_heap_bytes, -reported_live_objects);
+    }
     if (mrb) {
+        clear_cache();
+        mrbc_context_free(mrb, repl_cxt);
         mrb_close(mrb);
-        std::cout << "mruby closed." << std::endl;
+        LOG_INFO(Ruby, "mruby closed.");
     }
 }
 
 std::string RubyService::execute_code(const std::string& code) {
-    std::cout << "Executing Ruby code: " << code << std::endl;
-    mrb_value result = mrb_load_string(mrb, code.c_str());
-    if (mrb->exc) {
-        auto error = handle_error();
-        mrb->exc = NULL;
-        std::cerr << "Ruby Execution Error: " << error << std::endl;
-        return "Error: " + error;
-    }
-    std::cout << "Ruby code executed successfully." << std::endl;
-    return mrb_str_to_cstr(mrb, mrb_funcall(mrb, result, "inspect", 0));
+    LOG_DEBUG(Ruby, "Executing Ruby code (%zu bytes).", code.size());
+    std::lock_guard<std::mutex> lock(mrb_mutex);
+    return evaluate(code, repl_cxt, "(repl)", true);
+}
+
+std::string RubyService::stream_code(const std::string& code, const InspectLimits& limits,
+                                     const std::function<void(std::string chunk)>& partial) {
+    LOG_DEBUG(Ruby, "Streaming Ruby code (%zu bytes).", code.size());
+    std::lock_guard<std::mutex> lock(mrb_mutex);
+    StreamTarget stream{limits, partial};
+    return evaluate(code, repl_cxt, "(repl)", true, &stream);
 }
 
 std::string RubyService::load_file(const std::string& filename) {
-    std::cout << "Loading Ruby file: " << filename << std::endl;
+    if (filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".mrb") == 0) {
+        return load_bytecode_file(filename);
+    }
+    LOG_INFO(Ruby, "Loading Ruby file: %s", filename.c_str());
     std::ifstream file(filename);
     if (!file.is_open()) {
-        std::cerr << "Failed to open Ruby file: " << filename << std::endl;
+        LOG_ERROR(Ruby, "Failed to open Ruby file: %s", filename.c_str());
         throw std::runtime_error("Failed to open " + filename);
     }
     std::stringstream buffer;
     buffer << file.rdbuf();
     file.close();
-    std::cout << "Ruby file loaded successfully." << std::endl;
-    return execute_code(buffer.str());
+    LOG_DEBUG(Ruby, "Ruby file loaded successfully.");
+
+    // Files get their own context so error messages carry the file name
+    std::lock_guard<std::mutex> lock(mrb_mutex);
+    mrbc_context* cxt = mrbc_context_new(mrb);
+    cxt->capture_errors = TRUE;
+    mrbc_filename(mrb, cxt, filename.c_str());
+    std::string result = evaluate(buffer.str(), cxt, filename, false);
+    mrbc_context_free(mrb, cxt);
+    return result;
+}
+
+std::string RubyService::load_script(const std::string& name) {
+    if (const char* dir = std::getenv("MODERNX_SCRIPT_DIR")) {
+        // Development override: prefer fresh bytecode, then the source
+        std::string base = std::string(dir) + "/" + name;
+        if (base.size() > 3 && base.compare(base.size() - 3, 3, ".rb") == 0) {
+            std::string compiled = base.substr(0, base.size() - 3) + ".mrb";
+            struct stat info;
+            if (stat(compiled.c_str(), &info) == 0) {
+                return load_file(compiled);
+            }
+        }
+        return load_file(base);
+    }
+
+    const EmbeddedScript* script = find_embedded_script(name);
+    if (!script) {
+        LOG_WARN(Ruby, "Script %s is not embedded; reading scripts/%s.", name.c_str(), name.c_str());
+        return load_file("scripts/" + name);
+    }
+    LOG_INFO(Ruby, "Loading embedded script: %s", name.c_str());
+    std::lock_guard<std::mutex> lock(mrb_mutex);
+    return evaluate_irep(script->bytecode, 0);
+}
+
+std::string RubyService::load_bytecode_file(const std::string& filename) {
+    LOG_INFO(Ruby, "Loading mruby bytecode: %s", filename.c_str());
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR(Ruby, "Failed to open bytecode file: %s", filename.c_str());
+        throw std::runtime_error("Failed to open " + filename);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Empty or unreadable bytecode file " + filename);
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Failed to map " + filename);
+    }
+
+    std::string result;
+    {
+        // mrb_load_irep_buf copies what the irep keeps, so the mapping can go right after
+        std::lock_guard<std::mutex> lock(mrb_mutex);
+        result = evaluate_irep(static_cast<const uint8_t*>(data), size);
+    }
+    munmap(data, size);
+    return result;
+}
+
+void* RubyService::heap_allocf(mrb_state* mrb, void* ptr, size_t size, void* ud) {
+    (void)mrb;
+    return static_cast<RubyService*>(ud)->memory.reallocate(ptr, size);
+}
+
+void RubyService::set_memory_limit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mrb_mutex);
+    memory.set_limit(bytes);
+    LOG_INFO(Ruby, "Interpreter memory limit: %zu KiB.", bytes / 1024);
+}
+
+void RubyService::add_extension(Extension extension) {
+    std::lock_guard<std::mutex> lock(mrb_mutex);
+    int arena = mrb_gc_arena_save(mrb);
+    extension(mrb);
+    if (mrb->exc) {
+        auto error = handle_error();
+        LOG_ERROR(Ruby, "Ruby extension failed: %s", error.c_str());
+    }
+    mrb_gc_arena_restore(mrb, arena);
+}
+
+template<typename Body>
+std::string RubyService::measured(Body&& body) {
+    RubyHeap::Counters before = memory.counters();
+    std::string output;
+    {
+        ScopedTimer eval_timer(telemetry.get(), Metric::RubyEval);
+        // The result, its inspect string and the error message are all
+        // temporaries: once copied into output they may be collected
+        int arena = mrb_gc_arena_save(mrb);
+        output = body();
+        mrb_gc_arena_restore(mrb, arena);
+    }
+    if (telemetry) {
+        const RubyHeap::Counters& after = memory.counters();
+        telemetry->add_ruby_allocations(after.allocations - before.allocations,
+                                        after.allocated_bytes - before.allocated_bytes);
+    }
+    report_heap();
+    return output;
+}
+
+std::string RubyService::evaluate(const std::string& code, mrbc_context* cxt,
+                                  const std::string& scope, bool keep_locals, const StreamTarget* stream) {
+    return measured([&]() { return run_compiled(code, cxt, scope, keep_locals, stream); });
+}
+
+std::string RubyService::evaluate_irep(const uint8_t* bytecode, size_t size) {
+    return measured([&]() {
+        arm_watchdog();
+        // A static image is used in place; a buffer is copied from
+        mrb_value result = size ? mrb_load_irep_buf(mrb, bytecode, size) : mrb_load_irep(mrb, bytecode);
+        disarm_watchdog();
+        return result_string(result, nullptr);
+    });
+}
+
+std::string RubyService::run_compiled(const std::string& code, mrbc_context* cxt,
+                                      const std::string& scope, bool keep_locals, const StreamTarget* stream) {
+    mrb_value result = mrb_nil_value();
+    // Keep the registers holding REPL locals from earlier evaluations. Counted
+    // before compiling, as mirb does: this code's new locals are added to cxt
+    // and start out nil.
+    mrb_int keep = keep_locals && repl_started ? cxt->slen + 1 : 0;
+    struct RProc* proc = compile_cached(code, cxt, scope);
+    if (proc) {
+        if (keep_locals) {
+            repl_started = true;
+        }
+        arm_watchdog();
+        result = mrb_top_run(mrb, proc, mrb_top_self(mrb), keep);
+        disarm_watchdog();
+    }
+    return result_string(result, stream);
+}
+
+std::string RubyService::result_string(mrb_value result, const StreamTarget* stream) {
+    if (mrb->exc) {
+        auto error = handle_error();
+        LOG_WARN(Ruby, "Ruby Execution Error: %s", error.c_str());
+        return "Error: " + error;
+    }
+    LOG_TRACE(Ruby, "Ruby code executed successfully.");
+    RubyHeap::Headroom headroom(memory, kFormatHeadroom);
+    if (stream) {
+        StreamingInspector inspector(mrb, stream->limits, stream->partial, &memory);
+        return inspector.inspect(result);
+    }
+    bool raised = false;
+    std::string text = inspect_protected(result, raised);
+    if (raised) {
+        LOG_WARN(Ruby, "Inspecting the result failed: %s", text.c_str());
+        return "Error: " + text;
+    }
+    return text;
+}
+
+std::string RubyService::inspect_protected(mrb_value value, bool& raised) {
+    mrb_bool error = FALSE;
+    mrb_value text = mrb_protect_error(mrb, inspect_body, &value, &error);
+    raised = error;
+    if (error) {
+        // text is what #inspect raised; describe that instead, once
+        mrb_value exc = text;
+        text = mrb_protect_error(mrb, inspect_body, &exc, &error);
+        if (error || !mrb_string_p(text)) {
+            return "(unprintable exception)";
+        }
+    } else if (!mrb_string_p(text)) {
+        return "(unprintable value)";
+    }
+    // Not mrb_str_to_cstr: it raises on embedded NULs
+    return std::string(RSTRING_PTR(text), static_cast<size_t>(RSTRING_LEN(text)));
+}
+
+void RubyService::set_error(struct RClass* error_class, const std::string& text) {
+    ErrorText error{ error_class, text };
+    mrb_bool raised = FALSE;
+    // Either the new exception or whatever creating it raised (NoMemoryError)
+    mrb_value exc = mrb_protect_error(mrb, error_body, &error, &raised);
+    mrb->exc = mrb_obj_ptr(exc);
+}
+
+struct RProc* RubyService::compile_cached(const std::string& code, mrbc_context* cxt,
+                                          const std::string& scope) {
+    int locals = cxt->slen;
+    uint64_t key = hash_source(code, scope, locals);
+
+    auto it = irep_cache.find(key);
+    if (it != irep_cache.end() && it->second.locals == locals &&
+        it->second.scope == scope && it->second.source == code) {
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            stats.hits++;
+        }
+        irep_lru.splice(irep_lru.begin(), irep_lru, it->second.lru);
+
+        // Same setup mrb_generate_code performs for a freshly compiled irep
+        mrb_bool failed = FALSE;
+        mrb_value made = mrb_protect_error(mrb, proc_body, it->second.irep, &failed);
+        if (failed) {
+            mrb->exc = mrb_obj_ptr(made); // Reported as the evaluation's error
+            return nullptr;
+        }
+        struct RProc* proc = mrb_proc_ptr(made);
+        if (mrb->c->cibase && mrb->c->cibase->proc == proc->upper) {
+            proc->upper = NULL;
+        }
+        MRB_PROC_SET_TARGET_CLASS(proc, mrb->object_class);
+        return proc;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats.misses++;
+    }
+    struct RProc* proc = compile(code, cxt);
+    if (!proc) {
+        return nullptr;
+    }
+
+    if (it != irep_cache.end()) {
+        // Hash collision or stale locals layout: replace the old entry
+        mrb_irep_decref(mrb, it->second.irep);
+        irep_lru.erase(it->second.lru);
+        irep_cache.erase(it);
+    }
+    if (irep_cache.size() >= kIrepCacheCapacity) {
+        auto victim = irep_cache.find(irep_lru.back());
+        mrb_irep_decref(mrb, victim->second.irep);
+        irep_cache.erase(victim);
+        irep_lru.pop_back();
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats.evictions++;
+    }
+
+    mrb_irep* irep = const_cast<mrb_irep*>(proc->body.irep);
+    mrb_irep_incref(mrb, irep);
+    irep_lru.push_front(key);
+    irep_cache.emplace(key, CompiledEntry{code, scope, locals, irep, irep_lru.begin()});
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats.entries = irep_cache.size();
+    }
+    MRB_PROC_SET_TARGET_CLASS(proc, mrb->object_class);
+    return proc;
+}
+
+struct RProc* RubyService::compile(const std::string& code, mrbc_context* cxt) {
+    struct mrb_parser_state* parser = mrb_parse_nstring(mrb, code.data(), code.size(), cxt);
+    if (!parser) {
+        set_error(E_SCRIPT_ERROR, "parser error");
+        return nullptr;
+    }
+    if (parser->nerr > 0) {
+        std::ostringstream message;
+        message << "line " << parser->error_buffer[0].lineno << ": " << parser->error_buffer[0].message;
+        std::string text = message.str();
+        mrb_parser_free(parser);
+        set_error(mrb_exc_get(mrb, "SyntaxError"), text);
+        return nullptr;
+    }
+    struct RProc* proc = mrb_generate_code(mrb, parser);
+    mrb_parser_free(parser);
+    if (!proc && !mrb->exc) {
+        set_error(E_SCRIPT_ERROR, "codegen error");
+    }
+    return proc;
+}
+
+void RubyService::clear_cache() {
+    for (auto& entry : irep_cache) {
+        mrb_irep_decref(mrb, entry.second.irep);
+    }
+    irep_cache.clear();
+    irep_lru.clear();
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    stats.entries = 0;
+}
+
+RubyCacheStats RubyService::cache_stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return stats;
+}
+
+IRubyService::EvalId RubyService::execute_async(const std::string& code, EvalCallback on_done) {
+    EvalId id;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (!worker.joinable()) {
+            worker = std::thread(&RubyService::worker_loop, this);
+        }
+        id = next_id++;
+        jobs.push_back(Job{id, code, std::move(on_done), nullptr, InspectLimits()});
+    }
+    queue_cv.notify_one();
+    return id;
+}
+
+IRubyService::EvalId RubyService::execute_streaming(const std::string& code, const InspectLimits& limits,
+                                                    ChunkCallback on_chunk) {
+    EvalId id;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (!worker.joinable()) {
+            worker = std::thread(&RubyService::worker_loop, this);
+        }
+        id = next_id++;
+        EvalCallback on_partial = [on_chunk](const std::string& chunk) { on_chunk(chunk, false); };
+        EvalCallback on_done = [on_chunk](const std::string& chunk) { on_chunk(chunk, true); };
+        jobs.push_back(Job{id, code, std::move(on_done), std::move(on_partial), limits});
+    }
+    queue_cv.notify_one();
+    return id;
+}
+
+bool RubyService::cancel(EvalId id) {
+    if (id == 0) {
+        return false;
+    }
+    EvalCallback dropped;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (running_id == id) {
+            cancel_id = id;
+#ifdef MODERNX_HAS_FETCH_HOOK
+            return true;
+#else
+            return false; // Running code can only be stopped through the fetch hook
+#endif
+        }
+        bool found = false;
+        for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+            if (it->id == id) {
+                dropped = std::move(it->on_done);
+                jobs.erase(it);
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    post_completion(std::move(dropped), "Error: evaluation cancelled");
+    return true;
+}
+
+void RubyService::set_eval_timeout(std::chrono::milliseconds timeout) {
+#ifndef MODERNX_HAS_FETCH_HOOK
+    if (timeout.count() > 0) {
+        LOG_WARN(Ruby, "Evaluation timeout ignored: mruby lacks MRB_USE_DEBUG_HOOK.");
+    }
+#endif
+    timeout_ms = timeout.count();
+}
+
+bool RubyService::collect_garbage(std::chrono::microseconds budget) {
+    std::unique_lock<std::mutex> lock(mrb_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return false; // Its completion wakes the UI loop, which asks again
+    }
+    mrb_gc* gc = &mrb->gc;
+    if (gc->disabled || (gc->state == MRB_GC_STATE_ROOT && memory.counters().allocations == allocs_at_last_cycle)) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + budget;
+    uint64_t slices = 0;
+    uint64_t cycles = 0;
+    do {
+        mrb_incremental_gc(mrb);
+        slices++;
+        if (gc->state == MRB_GC_STATE_ROOT) {
+            cycles++;
+            allocs_at_last_cycle = memory.counters().allocations;
+            break;
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    if (telemetry) {
+        telemetry->record(Metric::RubyGc, elapsed);
+    }
+    double pause_us = std::chrono::duration<double, std::micro>(elapsed).count();
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex);
+        heap.gc_slices += slices;
+        heap.gc_cycles += cycles;
+        heap.last_pause_us = pause_us;
+        heap.max_pause_us = std::max(heap.max_pause_us, pause_us);
+    }
+    report_heap();
+    LOG_TRACE(Ruby, "Idle GC: %llu steps in %.0f us, %zu live objects.",
+              static_cast<unsigned long long>(slices), pause_us, static_cast<size_t>(gc->live));
+    return gc->state != MRB_GC_STATE_ROOT;
+}
+
+RubyHeapStats RubyService::heap_stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return heap;
+}
+
+void RubyService::report_heap() {
+    int64_t live = static_cast<int64_t>(mrb->gc.live);
+    const RubyHeap::Counters& counters = memory.counters();
+    int64_t heap_bytes = static_cast<int64_t>(counters.held_bytes);
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        heap.live_objects = static_cast<size_t>(live);
+        heap.heap_bytes = counters.held_bytes;
+        heap.heap_reserved = counters.reserved_bytes;
+        heap.heap_limit = memory.get_limit();
+        heap.allocations = counters.allocations;
+        heap.pool_reuses = counters.pool_reuses;
+        heap.refused = counters.refused;
+    }
+    if (telemetry) {
+        telemetry->adjust_ruby_heap(heap_bytes - reported_heap_bytes, live - reported_live_objects);
+    }
+    reported_heap_bytes = heap_bytes;
+    reported_live_objects = live;
+}
+
+void RubyService::dispatch_completions() {
+    uint64_t counter;
+    while (read(wake_fd, &counter, sizeof(counter)) > 0) {
+        // Drain the eventfd so poll() blocks again
+    }
+    if (profiler.enabled()) {
+        profiler.collect(); // The ring holds seconds of samples; keep it from filling
+    }
+
+    std::vector<std::pair<EvalCallback, std::string>> ready;
+    {
+        std::lock_guard<std::mutex> lock(completion_mutex);
+        ready.swap(completions);
+    }
+    for (auto& completion : ready) {
+        if (completion.first) {
+            completion.first(completion.second);
+        }
+    }
+}
+
+void RubyService::worker_loop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            running_id = job.id;
+        }
+
+        std::string result;
+        if (job.on_partial) {
+            result = stream_code(job.code, job.limits, [this, &job](std::string chunk) {
+                post_completion(job.on_partial, std::move(chunk));
+            });
+        } else {
+            result = execute_code(job.code);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            running_id = 0;
+        }
+        post_completion(std::move(job.on_done), std::move(result));
+    }
+}
+
+void RubyService::post_completion(EvalCallback on_done, std::string result) {
+    {
+        std::lock_guard<std::mutex> lock(completion_mutex);
+        completions.emplace_back(std::move(on_done), std::move(result));
+    }
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0) {
+        LOG_ERROR(Ruby, "Failed to signal Ruby completion.");
+    }
+}
+
+void RubyService::arm_watchdog() {
+    int64_t limit = timeout_ms.load();
+    deadline_armed = limit > 0;
+    if (deadline_armed) {
+        eval_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limit);
+    }
+#ifdef MODERNX_HAS_FETCH_HOOK
+    profiling = profiler.enabled();
+    if (profiling) {
+        profiler.rearm();
+    }
+    // The hook costs a call per instruction, so it is installed only when needed
+    if (deadline_armed || running_id != 0 || profiling) {
+        hook_ticks = 0;
+        mrb->code_fetch_hook = &RubyService::fetch_hook;
+    }
+#endif
+}
+
+void RubyService::disarm_watchdog() {
+#ifdef MODERNX_HAS_FETCH_HOOK
+    mrb->code_fetch_hook = nullptr;
+#endif
+    deadline_armed = false;
+}
+
+void RubyService::fetch_hook(mrb_state* mrb, const struct mrb_irep* irep, const mrb_code* pc, mrb_value* regs) {
+    (void)regs;
+    auto* self = static_cast<RubyService*>(mrb->ud);
+    if (self->profiling) {
+        self->profiler.tick(mrb, irep, pc);
+    }
+    if ((++self->hook_ticks & 1023) != 0) {
+        return;
+    }
+
+    const char* reason = nullptr;
+    EvalId running = self->running_id.load();
+    if (running != 0 && self->cancel_id.load() == running) {
+        reason = "evaluation cancelled";
+    } else if (self->deadline_armed && std::chrono::steady_clock::now() >= self->eval_deadline) {
+        reason = "evaluation timed out";
+    }
+    if (reason) {
+        // Point the frame at the current instruction so the right handlers unwind
+        mrb->c->ci->pc = pc;
+        self->hook_ticks = 1023; // Re-check on the very next instruction while unwinding
+        mrb_raise(mrb, self->interrupt_class, reason);
+    }
+}
+
+void RubyService::start_profiling(std::chrono::microseconds interval) {
+#ifdef MODERNX_HAS_FETCH_HOOK
+    profiler.start(interval);
+    LOG_INFO(Ruby, "Profiling Ruby every %lld us.", static_cast<long long>(interval.count()));
+#else
+    (void)interval;
+    LOG_WARN(Ruby, "Profiling needs mruby built with MRB_USE_DEBUG_HOOK.");
+#endif
+}
+
+void RubyService::stop_profiling() {
+    profiler.stop();
+    [[maybe_unused]] RubyProfiler::Stats stats = profiler.stats();
+    LOG_INFO(Ruby, "Profiling stopped: %llu samples, %llu dropped.",
+             static_cast<unsigned long long>(stats.samples), static_cast<unsigned long long>(stats.dropped));
+}
+
+std::string RubyService::profile_folded(bool reset) {
+    return profiler.folded(reset);
 }
 
 std::string RubyService::handle_error() {
     mrb_value exc = mrb_obj_value(mrb->exc);
-    mrb_value msg = mrb_funcall(mrb, exc, "inspect", 0);
-    return mrb_str_to_cstr(mrb, msg);
-}
\ No newline at end of file
+    mrb->exc = NULL;
+    RubyHeap::Headroom headroom(memory, kFormatHeadroom);
+    bool raised = false;
+    return inspect_protected(exc, raised);
+}
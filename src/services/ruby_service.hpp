@@ -1,16 +1,153 @@
 #pragma once
 #include "../interfaces/iruby_service.hpp"
+#include "../core/telemetry.hpp"
+#include "ruby_heap.hpp"
+#include "ruby_profiler.hpp"
 #include <mruby.h>
+#include <mruby/compile.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 class RubyService : public IRubyService {
 public:
-    RubyService();
+    explicit RubyService(std::shared_ptr<Telemetry> telemetry = nullptr);
     ~RubyService() override;
 
     std::string execute_code(const std::string& code) override;
     std::string load_file(const std::string& filename) override;
+    std::string load_script(const std::string& name) override;
+    RubyCacheStats cache_stats() const override;
+    void add_extension(Extension extension) override;
+
+    EvalId execute_async(const std::string& code, EvalCallback on_done) override;
+    EvalId execute_streaming(const std::string& code, const InspectLimits& limits,
+                             ChunkCallback on_chunk) override;
+    bool cancel(EvalId id) override;
+    void set_eval_timeout(std::chrono::milliseconds timeout) override;
+    void set_memory_limit(size_t bytes) override;
+    bool collect_garbage(std::chrono::microseconds budget) override;
+    RubyHeapStats heap_stats() const override;
+    void start_profiling(std::chrono::microseconds interval) override;
+    void stop_profiling() override;
+    std::string profile_folded(bool reset) override;
+    int completion_fd() const override { return wake_fd; }
+    void dispatch_completions() override;
+
+    // Synchronous streaming evaluation on the calling thread: full chunks go
+    // to partial as they are produced, the final piece is returned
+    std::string stream_code(const std::string& code, const InspectLimits& limits,
+                            const std::function<void(std::string chunk)>& partial);
 
 private:
+    // Every interpreter allocation, with its counters; declared before mrb, which mrb_open already uses
+    RubyHeap memory;
+    std::shared_ptr<Telemetry> telemetry;
+
     mrb_state* mrb; // Assuming you have a typedef or using statement
+
+    // Serializes every use of mrb between the caller and the worker thread
+    std::mutex mrb_mutex;
+
+    // Long-lived compile context: REPL lines share local variables
+    mrbc_context* repl_cxt = nullptr;
+    bool repl_started = false;
+
+    // Compiled ireps keyed by source hash, evicted least-recently-used first
+    struct CompiledEntry {
+        std::string source;
+        std::string scope;
+        int locals;
+        mrb_irep* irep;
+        std::list<uint64_t>::iterator lru;
+    };
+    static constexpr size_t kIrepCacheCapacity = 256;
+    std::unordered_map<uint64_t, CompiledEntry> irep_cache;
+    std::list<uint64_t> irep_lru;
+    mutable std::mutex stats_mutex;
+    RubyCacheStats stats;
+    RubyHeapStats heap;
+
+    // Idle GC bookkeeping: a finished cycle with no allocations since has nothing to do
+    uint64_t allocs_at_last_cycle = 0;
+    // Last values pushed to the telemetry gauges
+    int64_t reported_heap_bytes = 0;
+    int64_t reported_live_objects = 0;
+
+    // Worker thread, started on the first execute_async
+    struct Job {
+        EvalId id;
+        std::string code;
+        EvalCallback on_done;
+        // Set for streaming jobs: receives every chunk except the last
+        EvalCallback on_partial;
+        InspectLimits limits;
+    };
+    std::thread worker;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<Job> jobs;
+    bool stopping = false;
+    EvalId next_id = 1;
+
+    // Finished jobs waiting for dispatch_completions
+    std::mutex completion_mutex;
+    std::vector<std::pair<EvalCallback, std::string>> completions;
+    int wake_fd = -1;
+
+    // Watchdog state read by the code-fetch hook
+    std::atomic<EvalId> running_id{0};
+    std::atomic<EvalId> cancel_id{0};
+    std::atomic<int64_t> timeout_ms{0};
+    std::chrono::steady_clock::time_point eval_deadline;
+    bool deadline_armed = false;
+    uint32_t hook_ticks = 0;
+    struct RClass* interrupt_class = nullptr;
+
+    // Sampled from the same hook; profiling is latched when an evaluation starts
+    RubyProfiler profiler;
+    bool profiling = false;
+
+    // Result sink for streamed evaluations; null means a plain inspect string
+    struct StreamTarget {
+        const InspectLimits& limits;
+        const std::function<void(std::string chunk)>& partial;
+    };
+    std::string evaluate(const std::string& code, mrbc_context* cxt, const std::string& scope, bool keep_locals,
+                         const StreamTarget* stream = nullptr);
+    // Precompiled RITE image; size 0 means a static image trusted to be well formed
+    std::string evaluate_irep(const uint8_t* bytecode, size_t size);
+    std::string load_bytecode_file(const std::string& filename);
+    // Timing, allocation accounting and GC arena shared by every evaluation
+    template<typename Body>
+    std::string measured(Body&& body);
+    std::string result_string(mrb_value result, const StreamTarget* stream);
+    std::string run_compiled(const std::string& code, mrbc_context* cxt, const std::string& scope, bool keep_locals,
+                             const StreamTarget* stream);
+    struct RProc* compile_cached(const std::string& code, mrbc_context* cxt, const std::string& scope);
+    struct RProc* compile(const std::string& code, mrbc_context* cxt);
+    void clear_cache();
+    // Takes mrb->exc (clearing it) and returns its inspect string
     std::string handle_error();
-};
\ No newline at end of file
+    // #inspect under mrb_protect_error; raised reports that formatting failed,
+    // and the text then describes that exception
+    std::string inspect_protected(mrb_value value, bool& raised);
+    // Sets mrb->exc without raising on the host side
+    void set_error(struct RClass* error_class, const std::string& text);
+    // Called with mrb_mutex held
+    void report_heap();
+
+    static void* heap_allocf(mrb_state* mrb, void* ptr, size_t size, void* ud);
+
+    void worker_loop();
+    void post_completion(EvalCallback on_done, std::string result);
+    void arm_watchdog();
+    void disarm_watchdog();
+    static void fetch_hook(mrb_state* mrb, const struct mrb_irep* irep, const mrb_code* pc, mrb_value* regs);
+};
@@ -0,0 +1,322 @@
+#include "ruby_service_pool.hpp"
+#include "../utils/log.hpp"
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+RubyServicePool::RubyServicePool(size_t count, std::shared_ptr<Telemetry> telemetry) {
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        throw std::runtime_error("Failed to create eventfd for Ruby pool completions");
+    }
+
+    // All interpreters exist before any thread starts, so add_extension and
+    // the stealing loop never see a partially built pool
+    workers.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->ruby = std::make_unique<RubyService>(telemetry);
+        workers.push_back(std::move(worker));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        workers[i]->thread = std::thread(&RubyServicePool::worker_loop, this, i);
+    }
+    LOG_INFO(Ruby, "Ruby pool started with %zu interpreters.", count);
+}
+
+RubyServicePool::~RubyServicePool() {
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        stopping = true;
+    }
+    idle_cv.notify_all();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    // Jobs never started still owe their callers an answer
+    for (auto& worker : workers) {
+        for (auto& task : worker->queue) {
+            task.done("Error: evaluation cancelled");
+        }
+    }
+    workers.clear();
+    if (wake_fd >= 0) {
+        close(wake_fd);
+    }
+}
+
+std::vector<std::string> RubyServicePool::run_batch(const std::vector<ScriptJob>& batch) {
+    std::vector<std::string> results(batch.size());
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    size_t remaining = batch.size();
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        submit(batch[i], [&, i](std::string result) {
+            results[i] = std::move(result);
+            std::lock_guard<std::mutex> lock(done_mutex);
+            if (--remaining == 0) {
+                done_cv.notify_one();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_cv.wait(lock, [&remaining]() { return remaining == 0; });
+    return results;
+}
+
+std::string RubyServicePool::execute_code(const std::string& code) {
+    return run_sync(ScriptJob::code(code));
+}
+
+std::string RubyServicePool::load_file(const std::string& filename) {
+    return run_sync(ScriptJob::file(filename));
+}
+
+std::string RubyServicePool::load_script(const std::string& name) {
+    return run_sync(ScriptJob::script(name));
+}
+
+RubyCacheStats RubyServicePool::cache_stats() const {
+    RubyCacheStats total;
+    for (const auto& worker : workers) {
+        RubyCacheStats stats = worker->ruby->cache_stats();
+        total.hits += stats.hits;
+        total.misses += stats.misses;
+        total.evictions += stats.evictions;
+        total.entries += stats.entries;
+    }
+    return total;
+}
+
+void RubyServicePool::add_extension(Extension extension) {
+    // Each service takes its own interpreter lock, waiting out a running job
+    for (auto& worker : workers) {
+        worker->ruby->add_extension(extension);
+    }
+}
+
+IRubyService::EvalId RubyServicePool::execute_async(const std::string& code, EvalCallback on_done) {
+    return submit(ScriptJob::code(code), [this, on_done = std::move(on_done)](std::string result) mutable {
+        post_completion(std::move(on_done), std::move(result));
+    });
+}
+
+IRubyService::EvalId RubyServicePool::execute_streaming(const std::string& code, const InspectLimits& limits,
+                                                        ChunkCallback on_chunk) {
+    EvalCallback on_partial = [on_chunk](const std::string& chunk) { on_chunk(chunk, false); };
+    EvalCallback on_done = [on_chunk](const std::string& chunk) { on_chunk(chunk, true); };
+    return submit(ScriptJob::code(code),
+                  [this, on_done = std::move(on_done)](std::string result) mutable {
+                      post_completion(on_done, std::move(result));
+                  },
+                  [this, on_partial = std::move(on_partial)](std::string chunk) {
+                      post_completion(on_partial, std::move(chunk));
+                  },
+                  limits);
+}
+
+bool RubyServicePool::cancel(EvalId id) {
+    if (id == 0) {
+        return false;
+    }
+    for (auto& worker : workers) {
+        Done done;
+        {
+            std::lock_guard<std::mutex> lock(worker->queue_mutex);
+            for (auto it = worker->queue.begin(); it != worker->queue.end(); ++it) {
+                if (it->id == id) {
+                    done = std::move(it->done);
+                    worker->queue.erase(it);
+                    break;
+                }
+            }
+        }
+        if (done) {
+            queued--;
+            done("Error: evaluation cancelled");
+            return true;
+        }
+    }
+    return false;
+}
+
+void RubyServicePool::set_eval_timeout(std::chrono::milliseconds timeout) {
+    for (auto& worker : workers) {
+        worker->ruby->set_eval_timeout(timeout);
+    }
+}
+
+void RubyServicePool::set_memory_limit(size_t bytes) {
+    for (auto& worker : workers) {
+        worker->ruby->set_memory_limit(bytes);
+    }
+}
+
+void RubyServicePool::start_profiling(std::chrono::microseconds interval) {
+    for (auto& worker : workers) {
+        worker->ruby->start_profiling(interval);
+    }
+}
+
+void RubyServicePool::stop_profiling() {
+    for (auto& worker : workers) {
+        worker->ruby->stop_profiling();
+    }
+}
+
+std::string RubyServicePool::profile_folded(bool reset) {
+    std::string out;
+    for (auto& worker : workers) {
+        out += worker->ruby->profile_folded(reset);
+    }
+    return out;
+}
+
+bool RubyServicePool::collect_garbage(std::chrono::microseconds budget) {
+    auto deadline = std::chrono::steady_clock::now() + budget;
+    bool more = false;
+    for (auto& worker : workers) {
+        auto left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            return true; // The rest get their turn in the next idle slice
+        }
+        more |= worker->ruby->collect_garbage(left);
+    }
+    return more;
+}
+
+RubyHeapStats RubyServicePool::heap_stats() const {
+    RubyHeapStats total;
+    for (const auto& worker : workers) {
+        RubyHeapStats stats = worker->ruby->heap_stats();
+        total.live_objects += stats.live_objects;
+        total.heap_bytes += stats.heap_bytes;
+        total.heap_reserved += stats.heap_reserved;
+        total.heap_limit += stats.heap_limit;
+        total.allocations += stats.allocations;
+        total.pool_reuses += stats.pool_reuses;
+        total.refused += stats.refused;
+        total.gc_slices += stats.gc_slices;
+        total.gc_cycles += stats.gc_cycles;
+        total.last_pause_us = std::max(total.last_pause_us, stats.last_pause_us);
+        total.max_pause_us = std::max(total.max_pause_us, stats.max_pause_us);
+    }
+    return total;
+}
+
+void RubyServicePool::dispatch_completions() {
+    uint64_t counter;
+    while (read(wake_fd, &counter, sizeof(counter)) > 0) {
+        // Drain the eventfd so poll() blocks again
+    }
+
+    std::vector<std::pair<EvalCallback, std::string>> ready;
+    {
+        std::lock_guard<std::mutex> lock(completion_mutex);
+        ready.swap(completions);
+    }
+    for (auto& completion : ready) {
+        if (completion.first) {
+            completion.first(completion.second);
+        }
+    }
+}
+
+IRubyService::EvalId RubyServicePool::submit(ScriptJob job, Done done, Done partial, InspectLimits limits) {
+    EvalId id = next_id++;
+    Worker& target = *workers[next_worker++ % workers.size()];
+    {
+        std::lock_guard<std::mutex> lock(target.queue_mutex);
+        target.queue.push_back(Task{id, std::move(job), std::move(done), std::move(partial), limits});
+    }
+    {
+        // Taken under idle_mutex so a worker cannot miss the wakeup between
+        // finding every queue empty and going to sleep
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        queued++;
+    }
+    idle_cv.notify_one();
+    return id;
+}
+
+std::string RubyServicePool::run_sync(ScriptJob job) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> result = promise->get_future();
+    submit(std::move(job), [promise](std::string output) {
+        promise->set_value(std::move(output));
+    });
+    return result.get();
+}
+
+bool RubyServicePool::take_task(size_t self, Task& task) {
+    // Own queue from the front, victims from the back
+    for (size_t offset = 0; offset < workers.size(); ++offset) {
+        Worker& worker = *workers[(self + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(worker.queue_mutex);
+        if (worker.queue.empty()) {
+            continue;
+        }
+        if (offset == 0) {
+            task = std::move(worker.queue.front());
+            worker.queue.pop_front();
+        } else {
+            task = std::move(worker.queue.back());
+            worker.queue.pop_back();
+        }
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+void RubyServicePool::worker_loop(size_t self) {
+    RubyService& ruby = *workers[self]->ruby;
+    for (;;) {
+        Task task;
+        if (!take_task(self, task)) {
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            idle_cv.wait(lock, [this]() { return stopping || queued > 0; });
+            if (stopping) {
+                return;
+            }
+            continue;
+        }
+        task.done(run_job(ruby, task));
+    }
+}
+
+std::string RubyServicePool::run_job(RubyService& ruby, const Task& task) {
+    const ScriptJob& job = task.job;
+    if (job.kind == ScriptJob::Kind::Code) {
+        return task.partial ? ruby.stream_code(job.source, task.limits, task.partial)
+                            : ruby.execute_code(job.source);
+    }
+    try {
+        if (job.kind == ScriptJob::Kind::Script) {
+            return ruby.load_script(job.source);
+        }
+        return ruby.load_file(job.source);
+    } catch (const std::exception& e) {
+        return std::string("Error: ") + e.what();
+    }
+}
+
+void RubyServicePool::post_completion(EvalCallback on_done, std::string result) {
+    {
+        std::lock_guard<std::mutex> lock(completion_mutex);
+        completions.emplace_back(std::move(on_done), std::move(result));
+    }
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0) {
+        LOG_ERROR(Ruby, "Failed to signal Ruby completion.");
+    }
+}
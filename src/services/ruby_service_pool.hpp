@@ -0,0 +1,103 @@
+#pragma once
+#include "ruby_service.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One unit of batch work: inline source, a script path or an embedded script name
+struct ScriptJob {
+    enum class Kind { Code, File, Script };
+    Kind kind;
+    std::string source;
+
+    static ScriptJob code(std::string text) { return ScriptJob{Kind::Code, std::move(text)}; }
+    static ScriptJob file(std::string path) { return ScriptJob{Kind::File, std::move(path)}; }
+    static ScriptJob script(std::string name) { return ScriptJob{Kind::Script, std::move(name)}; }
+};
+
+// N isolated interpreters, each owned by one worker thread. Jobs go to
+// per-worker deques; an idle worker steals from the back of the others.
+// Interpreters share nothing, so globals and REPL locals only carry over
+// between calls that happen to land on the same worker.
+class RubyServicePool : public IRubyService {
+public:
+    // workers == 0 picks one per hardware thread
+    explicit RubyServicePool(size_t workers = 0, std::shared_ptr<Telemetry> telemetry = nullptr);
+    ~RubyServicePool() override;
+
+    size_t size() const { return workers.size(); }
+
+    // Runs every job and returns the results in job order
+    std::vector<std::string> run_batch(const std::vector<ScriptJob>& batch);
+
+    std::string execute_code(const std::string& code) override;
+    std::string load_file(const std::string& filename) override;
+    std::string load_script(const std::string& name) override;
+    RubyCacheStats cache_stats() const override;
+    // Applied to every interpreter in the pool
+    void add_extension(Extension extension) override;
+
+    EvalId execute_async(const std::string& code, EvalCallback on_done) override;
+    EvalId execute_streaming(const std::string& code, const InspectLimits& limits,
+                             ChunkCallback on_chunk) override;
+    // Only queued jobs can be dropped; running ones stop on the eval timeout
+    bool cancel(EvalId id) override;
+    void set_eval_timeout(std::chrono::milliseconds timeout) override;
+    // Applies to each interpreter separately
+    void set_memory_limit(size_t bytes) override;
+    void start_profiling(std::chrono::microseconds interval) override;
+    void stop_profiling() override;
+    // Every interpreter's stacks, concatenated; folding tools sum repeated stacks
+    std::string profile_folded(bool reset) override;
+    // The budget is shared by every interpreter; busy ones are skipped
+    bool collect_garbage(std::chrono::microseconds budget) override;
+    // Summed over the pool; pauses are the worst of any interpreter
+    RubyHeapStats heap_stats() const override;
+    int completion_fd() const override { return wake_fd; }
+    void dispatch_completions() override;
+
+private:
+    using Done = std::function<void(std::string result)>;
+    struct Task {
+        EvalId id;
+        ScriptJob job;
+        Done done;    // Runs on the worker thread
+        Done partial; // Streaming tasks only: every chunk but the last
+        InspectLimits limits;
+    };
+
+    struct Worker {
+        std::unique_ptr<RubyService> ruby;
+        std::mutex queue_mutex;
+        std::deque<Task> queue;
+        std::thread thread;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // Idle workers sleep here; queued counts tasks not yet taken by anyone
+    // (signed: a task can be taken before its submitter bumps the count)
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
+    std::atomic<long> queued{0};
+    bool stopping = false;
+    std::atomic<size_t> next_worker{0};
+    std::atomic<EvalId> next_id{1};
+
+    // Finished execute_async jobs waiting for dispatch_completions
+    std::mutex completion_mutex;
+    std::vector<std::pair<EvalCallback, std::string>> completions;
+    int wake_fd = -1;
+
+    EvalId submit(ScriptJob job, Done done, Done partial = nullptr, InspectLimits limits = InspectLimits());
+    std::string run_sync(ScriptJob job);
+    bool take_task(size_t self, Task& task);
+    void worker_loop(size_t self);
+    static std::string run_job(RubyService& ruby, const Task& task);
+    void post_completion(EvalCallback on_done, std::string result);
+};
@@ -0,0 +1,317 @@
+#include "streaming_inspector.hpp"
+#include "ruby_heap.hpp"
+#include <mruby/array.h>
+#include <mruby/class.h>
+#include <mruby/error.h>
+#include <mruby/hash.h>
+#include <mruby/string.h>
+#include <mruby/variable.h>
+#include <cstring>
+
+namespace {
+
+struct InspectArgs {
+    mrb_value value;
+    size_t max_bytes; // Longer strings are cut to this many bytes first
+};
+
+// Runs under mrb_protect_error: #inspect is user code and may raise, and so
+// may the allocations (NoMemoryError at the heap cap)
+mrb_value inspect_body(mrb_state* mrb, void* data) {
+    auto* args = static_cast<InspectArgs*>(data);
+    mrb_value v = args->value;
+    if (mrb_string_p(v) && static_cast<size_t>(RSTRING_LEN(v)) > args->max_bytes) {
+        // Inspect output is never shorter than the string, so the prefix still
+        // reaches the byte cap and the result is marked truncated
+        v = mrb_str_new(mrb, RSTRING_PTR(v), args->max_bytes);
+    }
+    return mrb_inspect(mrb, v);
+}
+
+// Whose #inspect a value would run, deciding whether value() may walk it
+enum Shape : mrb_int { kCustom, kPlainObject, kStruct };
+
+mrb_value shape_body(mrb_state* mrb, void* data) {
+    mrb_value v = *static_cast<mrb_value*>(data);
+    struct RClass* owner = mrb_class(mrb, v); // Singleton class first
+    mrb_method_t method = mrb_method_search_vm(mrb, &owner, mrb_intern_lit(mrb, "inspect"));
+    if (MRB_METHOD_UNDEF_P(method)) {
+        return mrb_int_value(mrb, kCustom);
+    }
+    if (owner->tt == MRB_TT_ICLASS) {
+        owner = owner->c; // Found in an included module
+    }
+    if (owner == mrb->kernel_module && mrb_type(v) == MRB_TT_OBJECT) {
+        return mrb_int_value(mrb, kPlainObject);
+    }
+    if (mrb_class_defined(mrb, "Struct") && owner == mrb_class_get(mrb, "Struct")) {
+        return mrb_int_value(mrb, kStruct);
+    }
+    return mrb_int_value(mrb, kCustom);
+}
+
+mrb_value class_name_body(mrb_state* mrb, void* data) {
+    return mrb_str_new_cstr(mrb, mrb_obj_classname(mrb, *static_cast<mrb_value*>(data)));
+}
+
+mrb_value ivars_body(mrb_state* mrb, void* data) {
+    return mrb_funcall(mrb, *static_cast<mrb_value*>(data), "instance_variables", 0);
+}
+
+// [members, values] of a Struct
+mrb_value struct_body(mrb_state* mrb, void* data) {
+    mrb_value v = *static_cast<mrb_value*>(data);
+    mrb_value members = mrb_funcall(mrb, v, "members", 0);
+    return mrb_assoc_new(mrb, members, mrb_funcall(mrb, v, "to_a", 0));
+}
+
+} // namespace
+
+struct StreamingInspector::HashWalk {
+    StreamingInspector* inspector;
+    int depth;
+    bool lines;
+    mrb_int index;
+};
+
+StreamingInspector::StreamingInspector(mrb_state* mrb, const InspectLimits& limits, Flush flush, RubyHeap* heap)
+    : mrb(mrb), limits(limits), flush(std::move(flush)), heap(heap) {
+    buffer.reserve(this->limits.chunk_bytes);
+}
+
+std::string StreamingInspector::inspect(mrb_value v) {
+    // Top-level containers get one entry per line so a viewer can show them line by line
+    if (mrb_array_p(v)) {
+        write("[\n");
+        mrb_int length = RARRAY_LEN(v);
+        for (mrb_int i = 0; i < length && !truncated; ++i) {
+            if (!take_element()) {
+                break;
+            }
+            int arena = mrb_gc_arena_save(mrb);
+            write("  ");
+            value(mrb_ary_ref(mrb, v, i), 1);
+            write(",\n");
+            mrb_gc_arena_restore(mrb, arena);
+        }
+        write("]");
+    } else if (mrb_hash_p(v)) {
+        write("{\n");
+        hash(v, 0);
+        write("}");
+    } else {
+        value(v, 0);
+    }
+    return std::move(buffer);
+}
+
+void StreamingInspector::value(mrb_value v, int depth) {
+    if (truncated) {
+        return;
+    }
+    if (depth > kMaxDepth) {
+        write("...");
+        return;
+    }
+    if (mrb_array_p(v)) {
+        array(v, depth);
+        return;
+    }
+    if (mrb_hash_p(v)) {
+        write("{");
+        hash(v, depth);
+        write("}");
+        return;
+    }
+
+    if (!mrb_string_p(v)) {
+        mrb_value shape = protect(shape_body, &v);
+        if (mrb_integer_p(shape) && mrb_integer(shape) == kPlainObject) {
+            object(v, depth);
+            return;
+        }
+        if (mrb_integer_p(shape) && mrb_integer(shape) == kStruct) {
+            structure(v, depth);
+            return;
+        }
+    }
+
+    // Strings, scalars and classes with their own #inspect. Its output can
+    // only be cut afterwards, so the heap it may grow meanwhile is capped.
+    size_t remaining = limits.max_bytes - written;
+    InspectArgs args{ v, remaining + 1 };
+    mrb_value text;
+    if (heap) {
+        RubyHeap::Ceiling ceiling(*heap, 4 * remaining + kInspectSlack);
+        text = protect(inspect_body, &args);
+    } else {
+        text = protect(inspect_body, &args);
+    }
+    if (!mrb_string_p(text)) {
+        write("#<inspect failed>"); // A broken #inspect only spoils its own entry
+        return;
+    }
+    write(RSTRING_PTR(text), static_cast<size_t>(RSTRING_LEN(text)));
+}
+
+mrb_value StreamingInspector::protect(mrb_value (*body)(mrb_state*, void*), void* data) {
+    mrb_bool failed = FALSE;
+    mrb_value result = mrb_protect_error(mrb, body, data, &failed);
+    return failed ? mrb_undef_value() : result;
+}
+
+void StreamingInspector::class_prefix(mrb_value v, const char* prefix) {
+    write(prefix);
+    mrb_value name = protect(class_name_body, &v);
+    if (mrb_string_p(name)) {
+        write(RSTRING_PTR(name), static_cast<size_t>(RSTRING_LEN(name)));
+    }
+}
+
+void StreamingInspector::object(mrb_value obj, int depth) {
+    // Kernel#inspect's "#<Class @a=1, @b=2>", one ivar at a time
+    class_prefix(obj, "#<");
+    mrb_value names = protect(ivars_body, &obj);
+    if (mrb_array_p(names)) {
+        mrb_int length = RARRAY_LEN(names);
+        for (mrb_int i = 0; i < length && !truncated; ++i) {
+            mrb_value name = mrb_ary_ref(mrb, names, i);
+            if (!mrb_symbol_p(name) || !take_element()) {
+                break;
+            }
+            int arena = mrb_gc_arena_save(mrb);
+            write(i > 0 ? ", " : " ");
+            symbol_name(mrb_symbol(name));
+            write("=");
+            value(mrb_iv_get(mrb, obj, mrb_symbol(name)), depth + 1);
+            mrb_gc_arena_restore(mrb, arena);
+        }
+    }
+    write(">");
+}
+
+void StreamingInspector::structure(mrb_value st, int depth) {
+    // Struct#inspect's "#<struct Name a=1, b=2>"
+    class_prefix(st, "#<struct ");
+    mrb_value parts = protect(struct_body, &st);
+    if (mrb_array_p(parts) && RARRAY_LEN(parts) == 2) {
+        mrb_value members = mrb_ary_ref(mrb, parts, 0);
+        mrb_value values = mrb_ary_ref(mrb, parts, 1);
+        if (mrb_array_p(members) && mrb_array_p(values)) {
+            mrb_int length = RARRAY_LEN(members) < RARRAY_LEN(values) ? RARRAY_LEN(members) : RARRAY_LEN(values);
+            for (mrb_int i = 0; i < length && !truncated; ++i) {
+                mrb_value member = mrb_ary_ref(mrb, members, i);
+                if (!mrb_symbol_p(member) || !take_element()) {
+                    break;
+                }
+                int arena = mrb_gc_arena_save(mrb);
+                write(i > 0 ? ", " : " ");
+                symbol_name(mrb_symbol(member));
+                write("=");
+                value(mrb_ary_ref(mrb, values, i), depth + 1);
+                mrb_gc_arena_restore(mrb, arena);
+            }
+        }
+    }
+    write(">");
+}
+
+void StreamingInspector::symbol_name(mrb_sym sym) {
+    // Only looks the name up; nothing is allocated
+    mrb_int length = 0;
+    const char* name = mrb_sym_name_len(mrb, sym, &length);
+    if (name) {
+        write(name, static_cast<size_t>(length));
+    }
+}
+
+void StreamingInspector::array(mrb_value ary, int depth) {
+    write("[");
+    mrb_int length = RARRAY_LEN(ary);
+    for (mrb_int i = 0; i < length && !truncated; ++i) {
+        if (!take_element()) {
+            break;
+        }
+        int arena = mrb_gc_arena_save(mrb);
+        if (i > 0) {
+            write(", ");
+        }
+        value(mrb_ary_ref(mrb, ary, i), depth + 1);
+        mrb_gc_arena_restore(mrb, arena);
+    }
+    write("]");
+}
+
+void StreamingInspector::hash(mrb_value hash, int depth) {
+    // depth 0 is the top-level hash: one pair per line. Walked in place, so
+    // a huge hash costs only the pairs written, not a copy of its keys.
+    HashWalk walk{ this, depth, depth == 0, 0 };
+    mrb_hash_foreach(mrb, mrb_hash_ptr(hash), hash_entry, &walk);
+}
+
+int StreamingInspector::hash_entry(mrb_state* mrb, mrb_value key, mrb_value val, void* data) {
+    auto* walk = static_cast<HashWalk*>(data);
+    StreamingInspector& self = *walk->inspector;
+    if (self.truncated || !self.take_element()) {
+        return 1; // Stop iterating
+    }
+    int arena = mrb_gc_arena_save(mrb);
+    self.write(walk->lines ? "  " : (walk->index > 0 ? ", " : ""));
+    self.value(key, walk->depth + 1);
+    self.write("=>");
+    self.value(val, walk->depth + 1);
+    if (walk->lines) {
+        self.write(",\n");
+    }
+    mrb_gc_arena_restore(mrb, arena);
+    walk->index++;
+    return 0;
+}
+
+bool StreamingInspector::take_element() {
+    if (elements >= limits.max_elements) {
+        truncate("element limit reached");
+        return false;
+    }
+    elements++;
+    return true;
+}
+
+void StreamingInspector::write(const char* text) {
+    write(text, std::strlen(text));
+}
+
+void StreamingInspector::write(const char* data, size_t length) {
+    if (truncated) {
+        return;
+    }
+    if (written + length > limits.max_bytes) {
+        length = limits.max_bytes - written;
+        // Cut on a character boundary
+        while (length > 0 && (static_cast<unsigned char>(data[length]) & 0xC0) == 0x80) {
+            --length;
+        }
+        buffer.append(data, length);
+        written += length;
+        truncate("byte limit reached");
+        return;
+    }
+    buffer.append(data, length);
+    written += length;
+    if (buffer.size() >= limits.chunk_bytes) {
+        flush(std::move(buffer));
+        buffer.clear();
+        buffer.reserve(limits.chunk_bytes);
+    }
+}
+
+void StreamingInspector::truncate(const char* reason) {
+    if (truncated) {
+        return;
+    }
+    truncated = true;
+    // The marker is not counted against the byte cap
+    buffer += "\n... (truncated: ";
+    buffer += reason;
+    buffer += ")";
+}
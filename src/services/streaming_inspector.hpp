@@ -0,0 +1,53 @@
+#pragma once
+#include "../interfaces/iruby_service.hpp"
+#include <mruby.h>
+#include <functional>
+#include <string>
+
+class RubyHeap;
+
+// Walks a Ruby value and writes its inspect form in bounded chunks, instead of
+// building one string the size of the whole result. Arrays, hashes, plain
+// objects and Structs are walked element by element; strings are cut to the
+// bytes still allowed before #inspect. Classes with their own #inspect run it,
+// with heap growth capped when heap is given.
+class StreamingInspector {
+public:
+    using Flush = std::function<void(std::string chunk)>;
+
+    StreamingInspector(mrb_state* mrb, const InspectLimits& limits, Flush flush, RubyHeap* heap = nullptr);
+
+    // Hands every full chunk to flush and returns the final (possibly empty) piece
+    std::string inspect(mrb_value value);
+
+private:
+    static constexpr int kMaxDepth = 16;
+    // Heap a custom #inspect may use beyond 4x the bytes still allowed
+    static constexpr size_t kInspectSlack = 64 * 1024;
+
+    mrb_state* mrb;
+    InspectLimits limits;
+    Flush flush;
+    RubyHeap* heap;
+    std::string buffer;
+    size_t written = 0;
+    size_t elements = 0;
+    bool truncated = false;
+
+    void value(mrb_value v, int depth);
+    void array(mrb_value ary, int depth);
+    void hash(mrb_value hash, int depth);
+    void object(mrb_value obj, int depth);
+    void structure(mrb_value st, int depth);
+    void class_prefix(mrb_value v, const char* prefix);
+    void symbol_name(mrb_sym sym);
+    // mrb_protect_error; undef when body raised
+    mrb_value protect(mrb_value (*body)(mrb_state*, void*), void* data);
+    struct HashWalk;
+    static int hash_entry(mrb_state* mrb, mrb_value key, mrb_value val, void* data);
+    // Counts one container entry; false once the element cap is reached
+    bool take_element();
+    void write(const char* data, size_t length);
+    void write(const char* text);
+    void truncate(const char* reason);
+};
@@ -2,18 +2,30 @@
 #include <X11/Xutil.h>
 #include <X11/Xft/Xft.h>
 #include <stdexcept>
-#include <iostream>
+#include "../utils/log.hpp"
+#include "../gui/software_canvas.hpp"
+#include "../gui/xft_canvas.hpp"
 #include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+#include <poll.h>
 
 // Конструктор
-WindowService::WindowService(std::shared_ptr<IRubyService> ruby_service) 
+WindowService::WindowService(std::shared_ptr<IRubyService> ruby_service,
+                             std::shared_ptr<IResourceCache> resources,
+                             std::shared_ptr<Telemetry> telemetry,
+                             RenderBackend backend,
+                             std::shared_ptr<Reactor> reactor)
     : ruby_service(std::move(ruby_service)),
+      resources(std::move(resources)),
+      telemetry(telemetry ? std::move(telemetry) : std::make_shared<Telemetry>()),
+      reactor(reactor ? std::move(reactor) : std::make_shared<Reactor>()),
       display(XOpenDisplay(""), DisplayDeleter()),
-      screen(DefaultScreen(display.get())),
-      text_buffer() // Initialize as an empty string
+      screen(DefaultScreen(display.get()))
 {
     if (!display) {
-        std::cerr << "Failed to open display." << std::endl;
+        LOG_ERROR(Window, "Failed to open display.");
         throw std::runtime_error("Failed to open display");
     }
 
@@ -24,35 +36,35 @@ WindowService::WindowService(std::shared_ptr<IRubyService> ruby_service)
     create_window();
     setup_gc();
     setup_xft();
+    setup_canvas(backend);
+    ensure_back_buffer();
+
+    clipboard_atom = XInternAtom(display.get(), "CLIPBOARD", False);
+    utf8_atom = XInternAtom(display.get(), "UTF8_STRING", False);
+    paste_property = XInternAtom(display.get(), "MODERNX_PASTE", False);
+    incr_atom = XInternAtom(display.get(), "INCR", False);
 
     // Selection of input events
     XSelectInput(display.get(), window, 
-                ButtonPressMask | KeyPressMask | ExposureMask | PointerMotionMask | ButtonReleaseMask | StructureNotifyMask); // Added StructureNotifyMask for resize
+                ButtonPressMask | KeyPressMask | ExposureMask | PointerMotionMask | ButtonReleaseMask | StructureNotifyMask | // Added StructureNotifyMask for resize
+                PropertyChangeMask); // Chunks of INCR clipboard transfers
     XMapRaised(display.get(), window);
-    std::cout << "Window created and mapped." << std::endl;
+    LOG_INFO(Window, "Window created and mapped.");
 }
 
 // Деструктор
 WindowService::~WindowService() {
-    // Разрушение XftDraw
-    if (draw) {
-        XftDrawDestroy(draw.release());
-        std::cout << "Destroyed XftDraw." << std::endl;
-    }
-
-    // Освобождение XftColor
-    XftColorFree(display.get(), visual, colormap, &color_);
-    std::cout << "Freed XftColor." << std::endl;
-
-    // Закрытие XftFont
-    if (font_) {
-        XftFontClose(display.get(), font_);
-        std::cout << "Closed XftFont." << std::endl;
+    // The interpreter records into ui_commands, which is declared after it and
+    // so would be released first; drop the interpreter before anything else
+    ruby_service.reset();
+    // Cached Pictures must go before the display closes; widgets drop theirs with widgets
+    if (images) {
+        images->attach(nullptr, 0, false);
     }
-
+    // Шрифты и цвета освобождаются кешем, когда виджеты их отпускают
     // Display закрывается уникальным указателем
     // Виджеты автоматически разрушаются уникальными указателями
-    std::cout << "WindowService destroyed." << std::endl;
+    LOG_DEBUG(Window, "WindowService destroyed.");
 }
 
 void WindowService::create_window() {
@@ -72,184 +84,885 @@ void WindowService::create_window() {
 
     XSetStandardProperties(display.get(), window, "X11 Window2", "X11 Window2",
                            None, nullptr, 0, &hints);
-    std::cout << "Simple window created." << std::endl;
+    LOG_DEBUG(Window, "Simple window created.");
 }
 
 void WindowService::setup_gc() {
     gc = XCreateGC(display.get(), window, 0, nullptr);
     XSetBackground(display.get(), gc, WhitePixel(display.get(), screen));
     XSetForeground(display.get(), gc, BlackPixel(display.get(), screen));
-    std::cout << "Graphics Context (GC) set up." << std::endl;
+    LOG_DEBUG(Window, "Graphics Context (GC) set up.");
 }
 
 void WindowService::setup_xft() {
     visual = DefaultVisual(display.get(), screen);
     colormap = DefaultColormap(display.get(), screen);
-    font_ = XftFontOpenName(display.get(), screen, "monospace-10");
-    if (!font_) {
-        std::cerr << "Failed to load XftFont." << std::endl;
-        throw std::runtime_error("Failed to load font");
-    }
-    std::cout << "Loaded XftFont: monospace-10" << std::endl;
-
-    // Allocate color using Xft
-    if (!XftColorAllocName(display.get(), visual, colormap, "black", &color_)) {
-        std::cerr << "Failed to allocate XftColor." << std::endl;
-        XftFontClose(display.get(), font_);
-        throw std::runtime_error("Failed to allocate color");
-    }
-    std::cout << "Allocated XftColor: black" << std::endl;
+    // Fonts and colors are shared through the resource cache
+    resources->attach(display.get(), screen);
+    LOG_DEBUG(Window, "Resource cache attached to display.");
+    background = resources->color("#ffffff");
+}
 
-    // Create XftDraw using RAII
-    XftDraw* raw_xftDraw = XftDrawCreate(display.get(), window, visual, colormap);
-    if (!raw_xftDraw) {
-        std::cerr << "Failed to create XftDraw." << std::endl;
-        XftColorFree(display.get(), visual, colormap, &color_);
-        XftFontClose(display.get(), font_);
-        throw std::runtime_error("Failed to create XftDraw");
+void WindowService::setup_canvas(RenderBackend backend) {
+    if (backend == RenderBackend::Software) {
+        try {
+            canvas = std::make_unique<SoftwareCanvas>(display.get(), screen, *resources);
+            LOG_INFO(Window, "Using the software renderer.");
+            return;
+        } catch (const std::exception& e) {
+            LOG_WARN(Window, "Software renderer unavailable (%s), using Xft.", e.what());
+        }
     }
-    draw = XftDrawPtr(raw_xftDraw, XftDrawDeleter());
-    std::cout << "Created XftDraw." << std::endl;
+    canvas = std::make_unique<XftCanvas>(display.get(), window, screen);
+    LOG_INFO(Window, "Using the Xft renderer.");
 }
 
 void WindowService::run() {
+    if (!ruby_service) {
+        throw std::runtime_error("WindowService started without a Ruby service");
+    }
     try {
-        std::string ruby_output = ruby_service->load_file("scripts/hello.rb");
-        std::cout << "Loaded Ruby script: scripts/hello.rb" << std::endl;
-        main_loop(ruby_output);
+        load_startup_script();
+        main_loop();
     } catch (const std::exception& e) {
-        std::cerr << "Error during run: " << e.what() << std::endl;
+        LOG_ERROR(Window, "Error during run: %s", e.what());
     }
 }
 
-void WindowService::setInputLabel(std::unique_ptr<Label> label) {
-    inputLabel = label.get(); // Устанавливаем указатель
-    addWidget(std::move(label)); // Перемещаем владение в widgets
-    std::cout << "Input label set." << std::endl;
+void WindowService::load_startup_script() {
+    ruby_output = ruby_service->load_script("hello.rb");
+    LOG_INFO(Window, "Loaded Ruby script: hello.rb");
+    if (resultView) {
+        resultView->setText(ruby_output);
+    }
+}
+
+void WindowService::setInputEditor(std::unique_ptr<TextEditor> editor) {
+    inputEditor = editor.get(); // Устанавливаем указатель
+    focus = inputEditor;
+    addWidget(std::move(editor)); // Перемещаем владение в widgets
+    LOG_DEBUG(Window, "Input editor set.");
+}
+
+void WindowService::setResultView(std::unique_ptr<OutputView> view) {
+    resultView = view.get(); // Устанавливаем указатель
+    addWidget(std::move(view)); // Перемещаем владение в widgets
+    LOG_DEBUG(Window, "Result view set.");
+}
+
+void WindowService::setPerfOverlay(std::unique_ptr<PerfOverlay> overlay) {
+    perfOverlay = overlay.get();
+    addWidget(std::move(overlay));
+    place_perf_overlay();
+    LOG_DEBUG(Window, "Perf overlay set.");
+}
+
+void WindowService::place_perf_overlay() {
+    // Top-right corner, following the window width
+    if (perfOverlay) {
+        int margin = 10;
+        int x = std::max(margin, window_width - perfOverlay->bounds().width - margin);
+        perfOverlay->setPosition(x, margin);
+    }
+}
+
+void WindowService::setCommandBuffer(std::shared_ptr<UiCommandBuffer> commands) {
+    ui_commands = std::move(commands);
+}
+
+void WindowService::setImageCache(std::shared_ptr<IImageCache> cache) {
+    images = std::move(cache);
+    // Server-side Pictures only help the Xft renderer; software composites client pixels
+    images->attach(display.get(), screen, canvas->backend() == RenderBackend::Xft);
 }
 
-void WindowService::setResultLabel(std::unique_ptr<Label> label) {
-    resultLabel = label.get(); // Устанавливаем указатель
-    addWidget(std::move(label)); // Перемещаем владение в widgets
-    std::cout << "Result label set." << std::endl;
+void WindowService::set_frame_budget(std::chrono::microseconds budget) {
+    frame_budget = budget;
 }
 
 void WindowService::addWidget(std::unique_ptr<VisibleComponent> widget) {
+    widget->setDamageTracker(&damage);
+    widget->invalidate();
+    if (widget->eventMask() != NoEventMask) {
+        widget->setEventIndex(&event_index);
+        event_index.insert(widget.get(), widget->bounds(), widget->eventMask());
+    }
     widgets.emplace_back(std::move(widget));
-    std::cout << "Widget added to WindowService." << std::endl;
+    LOG_DEBUG(Window, "Widget added to WindowService.");
 }
 
-void WindowService::main_loop(std::string& ruby_output) {
+void WindowService::ensure_back_buffer() {
+    if (back_buffer_width == window_width && back_buffer_height == window_height) {
+        return;
+    }
+    canvas->resize(window_width, window_height);
+    back_buffer_width = window_width;
+    back_buffer_height = window_height;
+
+    // Fresh pixmap contents are undefined: everything has to be painted again
+    damage.add(0, 0, window_width, window_height);
+    LOG_DEBUG(Window, "Allocated back buffer %dx%d.", window_width, window_height);
+}
+
+void WindowService::main_loop() {
+    int x_fd = ConnectionNumber(display.get());
+    int ruby_fd = ruby_service->completion_fd();
+    // X events are read below; the watch only wakes the loop
+    reactor->add_fd(x_fd, []() {});
+    reactor->add_fd(ruby_fd, [this]() {
+        ruby_service->dispatch_completions();
+        request_idle_gc();
+    });
+    int image_fd = images ? images->completion_fd() : -1;
+    if (images) {
+        // Decoded images are uploaded here; their widgets damage themselves
+        reactor->add_fd(image_fd, [this]() { images->dispatch_completions(); });
+    }
+    request_idle_gc();
+    paced = true;
+
     bool done = false;
     while (!done) {
+        // Sleep until X events, finished Ruby evaluations, timers or wakeups.
+        // Events Xlib already read off the socket leave the fd quiet, so don't block on them.
+        XFlush(display.get());
+        reactor->run_once(XPending(display.get()) > 0 ? std::chrono::milliseconds(0)
+                                                      : std::chrono::milliseconds(-1));
+
+        // Drain everything already queued
+        auto batch_start = std::chrono::steady_clock::now();
+        EventBatch batch;
         XEvent event;
-        XNextEvent(display.get(), &event);
+        while (!done && XPending(display.get()) > 0) {
+            if (batch.events > 0 && std::chrono::steady_clock::now() - batch_start >= frame_budget) {
+                break; // Leave the rest for the next batch so rendering is not starved
+            }
+            XNextEvent(display.get(), &event);
+            if (trace_writer) {
+                trace_writer->append(event);
+            }
+            done = process_event(event, batch);
+        }
+        if (done) {
+            break;
+        }
+        finish_batch(batch);
+        telemetry->record(Metric::Batch, std::chrono::steady_clock::now() - batch_start);
+    }
+
+    if (trace_writer) {
+        LOG_INFO(Window, "Recorded %zu events.", trace_writer->count());
+        trace_writer.reset();
+    }
+    paced = false;
+    if (frame_timer != 0) {
+        reactor->cancel_timer(frame_timer);
+        frame_timer = 0;
+    }
+    reactor->remove_fd(ruby_fd);
+    reactor->remove_fd(x_fd);
+    if (images) {
+        reactor->remove_fd(image_fd);
+        [[maybe_unused]] ImageCacheStats image_stats = images->stats();
+        LOG_INFO(Window, "Images: %llu hits, %llu misses, %zu cached (%zu KiB), %llu evicted.",
+                 static_cast<unsigned long long>(image_stats.hits),
+                 static_cast<unsigned long long>(image_stats.misses),
+                 image_stats.entries, image_stats.bytes / 1024,
+                 static_cast<unsigned long long>(image_stats.evictions));
+    }
+    LOG_INFO(Window, "Exiting main loop. Events: %llu, coalesced: %llu, batches: %llu, frames: %llu.",
+             static_cast<unsigned long long>(loop_stats.events_handled),
+             static_cast<unsigned long long>(loop_stats.events_coalesced),
+             static_cast<unsigned long long>(loop_stats.batches),
+             static_cast<unsigned long long>(loop_stats.frames_rendered));
+}
+
+void WindowService::request_idle_gc() {
+    if (gc_pending || idle_gc_slice.count() <= 0) {
+        return;
+    }
+    gc_pending = true;
+    // Nothing to draw and no input: collect Ruby garbage in short slices so a
+    // keystroke never waits behind more than one of them
+    reactor->add_idle([this]() {
+        gc_pending = ruby_service->collect_garbage(idle_gc_slice);
+        return gc_pending;
+    });
+}
+
+bool WindowService::frame_due() {
+    if (!paced || (damage.empty() && exposed.empty())) {
+        return true; // redraw() skips clean frames itself
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto next = last_frame + frame_interval;
+    if (now >= next) {
+        last_frame = now;
+        return true;
+    }
+    // Too soon after the last frame: wake up when the next one is due
+    if (frame_timer == 0) {
+        frame_timer = reactor->add_timer(next - now, std::chrono::nanoseconds(0), [this]() { frame_timer = 0; });
+    }
+    return false;
+}
+
+bool WindowService::finish_batch(EventBatch& batch) {
+    // Apply coalesced state once per batch
+    if (batch.resized) {
+        LOG_DEBUG(Window, "Window resized to %dx%d.", window_width, window_height);
+        ensure_back_buffer();
+        place_perf_overlay();
+    }
+    if (batch.has_motion) {
+        dispatch_to_widgets(batch.last_motion);
+    }
+    // Hold script mutations back while our evaluation runs, so its changes land in one frame
+    if (ui_commands && pending_eval == 0) {
+        apply_ui_commands();
+    }
+    if (perfOverlay && perfOverlay->isVisible()) {
+        perfOverlay->update(telemetry->snapshot(2));
+    }
+
+    bool rendered = frame_due() && redraw();
+
+    loop_stats.batches++;
+    loop_stats.events_handled += batch.events;
+    loop_stats.events_coalesced += batch.coalesced;
+    loop_stats.last_batch_events = batch.events;
+    loop_stats.last_batch_frames = rendered ? 1 : 0;
+    loop_stats.max_batch_events = std::max(loop_stats.max_batch_events, batch.events);
+    if (rendered) {
+        if (loop_stats.frames_rendered == 0) {
+            XFlush(display.get());
+            loop_stats.first_frame_ms =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launch_time).count();
+            LOG_INFO(Window, "First frame %.1f ms after launch.", loop_stats.first_frame_ms);
+        }
+        loop_stats.frames_rendered++;
+    }
+    return rendered;
+}
+
+bool WindowService::dispatch_event(XEvent& event) {
+    EventBatch batch;
+    if (process_event(event, batch)) {
+        return true;
+    }
+    finish_batch(batch);
+    return false;
+}
+
+bool WindowService::render_frame() {
+    return redraw();
+}
+
+void WindowService::record_events(const std::string& path) {
+    trace_writer = std::make_unique<EventTraceWriter>(path, window_width, window_height);
+    LOG_INFO(Window, "Recording input events to %s.", path.c_str());
+}
+
+bool WindowService::pump_completions(std::chrono::milliseconds timeout) {
+    // poll() skips the -1 entry when there is no image cache
+    pollfd fds[2] = { { ruby_service->completion_fd(), POLLIN, 0 },
+                      { images ? images->completion_fd() : -1, POLLIN, 0 } };
+    if (poll(fds, 2, static_cast<int>(timeout.count())) <= 0) {
+        return false;
+    }
+    if (fds[0].revents) {
+        ruby_service->dispatch_completions();
+    }
+    if (fds[1].revents) {
+        images->dispatch_completions();
+    }
+    return true;
+}
+
+ReplayReport WindowService::replay(EventTraceReader& trace, const ReplayOptions& options) {
+    ReplayReport report;
+    resize(trace.width(), trace.height());
+    load_startup_script();
+    render_frame();
+    uint64_t frames_before = loop_stats.frames_rendered;
+
+    auto start = std::chrono::steady_clock::now();
+    TraceRecord record;
+    XEvent event;
+    bool quit = false;
+    while (!quit && trace.next(record)) {
+        if (options.original_timing) {
+            auto due = start + record.time;
+            for (auto now = std::chrono::steady_clock::now(); now < due; now = std::chrono::steady_clock::now()) {
+                // Round up: a truncated sub-millisecond wait would poll with 0 and spin
+                pump_completions(std::chrono::ceil<std::chrono::milliseconds>(due - now));
+            }
+        }
+        // The trace alone drives the window: whatever the server sends meanwhile is dropped
+        XSync(display.get(), False);
+        while (XPending(display.get()) > 0) {
+            XNextEvent(display.get(), &event);
+        }
+        EventTraceReader::to_event(record, display.get(), window, event);
+        if (record.type == ConfigureNotify) {
+            XResizeWindow(display.get(), window, event.xconfigure.width, event.xconfigure.height);
+        }
+
+        auto dispatch_start = std::chrono::steady_clock::now();
+        quit = dispatch_event(event);
+        XSync(display.get(), False); // Until the server has drawn the frame
+        report.latency_us.push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - dispatch_start).count());
+        report.events++;
+        pump_completions(std::chrono::milliseconds(0));
+    }
+
+    // Results of evaluations the trace started belong in the final frame
+    auto settle_deadline = std::chrono::steady_clock::now() + options.settle_timeout;
+    while (pending_eval != 0 && std::chrono::steady_clock::now() < settle_deadline) {
+        pump_completions(std::chrono::milliseconds(10));
+    }
+    if (pending_eval != 0) {
+        LOG_WARN(Window, "Replay ended with an evaluation still running.");
+    }
+    EventBatch batch;
+    finish_batch(batch);
+    XSync(display.get(), False);
+
+    report.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    report.frames = loop_stats.frames_rendered - frames_before;
+    if (options.checksum) {
+        report.checksum = frame_checksum();
+    }
+    return report;
+}
+
+void WindowService::invalidate_all() {
+    damage.add(0, 0, window_width, window_height);
+}
+
+void WindowService::resize(int width, int height) {
+    XResizeWindow(display.get(), window, width, height);
+    window_width = width;
+    window_height = height;
+    ensure_back_buffer();
+    place_perf_overlay();
+}
+
+bool WindowService::process_event(XEvent& event, EventBatch& batch) {
+    batch.events++;
+
+    switch (event.type) {
+        case Expose:
+            // Back buffer still holds valid pixels: exposed areas only need a copy
+            exposed.add(event.xexpose.x, event.xexpose.y, event.xexpose.width, event.xexpose.height);
+            if (batch.has_expose) {
+                batch.coalesced++;
+            }
+            batch.has_expose = true;
+            break;
+        case ConfigureNotify: { // Handle resize event; only the last size of a batch matters
+            XConfigureEvent xce = event.xconfigure;
+            // Every configure after the first folds into the batch's single resize,
+            // whether or not the one before it changed the size
+            if (batch.has_configure) {
+                batch.coalesced++;
+            }
+            batch.has_configure = true;
+            if (xce.width != window_width || xce.height != window_height) {
+                window_width = xce.width;
+                window_height = xce.height;
+                batch.resized = true;
+            }
+            break;
+        }
+        case MotionNotify:
+            // Only the latest pointer position is delivered to widgets
+            if (batch.has_motion) {
+                batch.coalesced++;
+            }
+            batch.last_motion = event;
+            batch.has_motion = true;
+            return false;
+        case KeyPress:
+            dispatch_to_widgets(event);
+            return handle_key_press(event);
+        case MappingNotify:
+            XRefreshKeyboardMapping(&event.xmapping);
+            break;
+        case SelectionNotify:
+            finish_paste(event.xselection);
+            break;
+        case PropertyNotify:
+            if (paste_incr && event.xproperty.atom == paste_property && event.xproperty.state == PropertyNewValue) {
+                continue_paste();
+            }
+            break;
+        default:
+            break;
+    }
+
+    dispatch_to_widgets(event);
+    return false;
+}
+
+namespace {
 
+constexpr unsigned int kButtonsMask = Button1Mask | Button2Mask | Button3Mask | Button4Mask | Button5Mask;
+
+// Motion masks a widget may have asked for, given the buttons held
+long motion_mask(unsigned int state) {
+    long mask = PointerMotionMask;
+    if (state & kButtonsMask) {
+        mask |= ButtonMotionMask;
+    }
+    if (state & Button1Mask) {
+        mask |= Button1MotionMask;
+    }
+    if (state & Button2Mask) {
+        mask |= Button2MotionMask;
+    }
+    if (state & Button3Mask) {
+        mask |= Button3MotionMask;
+    }
+    return mask;
+}
+
+// Selection mask for events that carry no pointer position; 0 for the rest
+long broadcast_mask(int type) {
+    switch (type) {
+        case Expose:
+            return ExposureMask;
+        case ConfigureNotify:
+        case MapNotify:
+        case UnmapNotify:
+            return StructureNotifyMask;
+        case FocusIn:
+        case FocusOut:
+            return FocusChangeMask;
+        case PropertyNotify:
+            return PropertyChangeMask;
+        default:
+            return NoEventMask;
+    }
+}
+
+} // namespace
+
+void WindowService::dispatch_to_widgets(XEvent& event) {
+    switch (event.type) {
+        case ButtonPress: {
+            VisibleComponent* target = event_index.at(event.xbutton.x, event.xbutton.y, ButtonPressMask);
+            if (!target) {
+                return;
+            }
+            pointer_grab = target;
+            if (target->eventMask() & KeyPressMask) {
+                focus = target;
+            }
+            target->handleEvent(event);
+            return;
+        }
+        case ButtonRelease: {
+            VisibleComponent* target = pointer_grab
+                ? pointer_grab
+                : event_index.at(event.xbutton.x, event.xbutton.y, ButtonReleaseMask);
+            // state still includes the released button
+            unsigned int released = Button1Mask << (event.xbutton.button - Button1);
+            if ((event.xbutton.state & kButtonsMask & ~released) == 0) {
+                pointer_grab = nullptr;
+            }
+            if (target && (target->eventMask() & ButtonReleaseMask)) {
+                target->handleEvent(event);
+            }
+            return;
+        }
+        case MotionNotify: {
+            long mask = motion_mask(event.xmotion.state);
+            VisibleComponent* target = pointer_grab
+                ? pointer_grab
+                : event_index.at(event.xmotion.x, event.xmotion.y, mask);
+            if (target && (target->eventMask() & mask)) {
+                target->handleEvent(event);
+            }
+            return;
+        }
+        case KeyPress:
+        case KeyRelease: {
+            long mask = event.type == KeyPress ? KeyPressMask : KeyReleaseMask;
+            if (focus && (focus->eventMask() & mask)) {
+                focus->handleEvent(event);
+            }
+            return;
+        }
+        default:
+            break;
+    }
+
+    long mask = broadcast_mask(event.type);
+    if (mask == NoEventMask) {
+        return;
+    }
+    event_index.interested(mask, event_listeners);
+    for (VisibleComponent* widget : event_listeners) {
+        widget->handleEvent(event);
+    }
+}
+
+void WindowService::forget_widget(VisibleComponent* widget) {
+    event_index.remove(widget);
+    if (focus == widget) {
+        focus = nullptr;
+    }
+    if (pointer_grab == widget) {
+        pointer_grab = nullptr;
+    }
+}
+
+void WindowService::apply_ui_commands() {
+    ui_commands->take(ui_batch);
+    if (ui_batch.empty()) {
+        return;
+    }
+
+    std::unordered_set<const VisibleComponent*> removed;
+    for (UiCommand& cmd : ui_batch) {
+        try {
+            apply_ui_command(cmd, removed);
+        } catch (const std::exception& e) {
+            // A bad font or color name only loses that one change
+            LOG_WARN(Window, "Script UI command failed: %s", e.what());
+        }
+    }
+
+    if (!removed.empty()) {
+        widgets.erase(std::remove_if(widgets.begin(), widgets.end(),
+                                     [&removed](const std::unique_ptr<VisibleComponent>& widget) {
+                                         return removed.count(widget.get()) != 0;
+                                     }),
+                      widgets.end());
+    }
+    LOG_TRACE(Window, "Applied %zu script UI commands.", ui_batch.size());
+}
+
+void WindowService::apply_ui_command(UiCommand& cmd, std::unordered_set<const VisibleComponent*>& removed) {
+    if (cmd.op == UiCommand::Op::CreateLabel) {
+        auto label = std::make_unique<Label>(display.get(), window, gc, *resources,
+                                             cmd.x, cmd.y, cmd.width, cmd.height,
+                                             cmd.text, cmd.font, cmd.color);
+        ScriptedWidget entry{ label.get() };
+        entry.label = label.get();
+        scripted_widgets[cmd.id] = entry;
+        addWidget(std::move(label));
+        return;
+    }
+    if (cmd.op == UiCommand::Op::CreatePlot) {
+        auto plot = std::make_unique<Plot>(display.get(), window, gc, *resources,
+                                           cmd.x, cmd.y, cmd.width, cmd.height, cmd.color);
+        ScriptedWidget entry{ plot.get() };
+        entry.plot = plot.get();
+        scripted_widgets[cmd.id] = entry;
+        addWidget(std::move(plot));
+        return;
+    }
+    if (cmd.op == UiCommand::Op::CreateImage) {
+        if (!images) {
+            throw std::runtime_error("no image cache attached");
+        }
+        auto image = std::make_unique<Image>(display.get(), window, gc, *images, *resources,
+                                             cmd.x, cmd.y, cmd.width, cmd.height, cmd.text);
+        ScriptedWidget entry{ image.get() };
+        entry.image = image.get();
+        scripted_widgets[cmd.id] = entry;
+        addWidget(std::move(image));
+        return;
+    }
+
+    auto it = scripted_widgets.find(cmd.id);
+    if (it == scripted_widgets.end()) {
+        return; // Removed, or its creation failed
+    }
+    // The Ruby classes only expose each op on the matching widget kind
+    Label* label = it->second.label;
+    Plot* plot = it->second.plot;
+    Image* image = it->second.image;
+    switch (cmd.op) {
+        case UiCommand::Op::Move:
+            if (label) {
+                label->setPosition(cmd.x, cmd.y);
+            } else if (plot) {
+                plot->setPosition(cmd.x, cmd.y);
+            } else {
+                image->setPosition(cmd.x, cmd.y);
+            }
+            break;
+        case UiCommand::Op::SetText:
+            if (label) {
+                label->setText(cmd.text);
+            }
+            break;
+        case UiCommand::Op::SetFont:
+            if (label) {
+                label->setFont(resources->font(cmd.font));
+            }
+            break;
+        case UiCommand::Op::SetColor:
+            if (label) {
+                label->setColor(resources->color(cmd.color));
+            }
+            break;
+        case UiCommand::Op::SetAlign:
+            if (label) {
+                label->setAlignment(cmd.align);
+            }
+            break;
+        case UiCommand::Op::SetSeries:
+            if (plot) {
+                // No color keeps the series' current one
+                plot->setSeries(cmd.series, std::move(cmd.samples),
+                                cmd.color.empty() ? nullptr : resources->color(cmd.color));
+            }
+            break;
+        case UiCommand::Op::AppendSamples:
+            if (plot) {
+                plot->appendSamples(cmd.series, cmd.samples.data(), cmd.samples.size());
+            }
+            break;
+        case UiCommand::Op::SetRange:
+            if (plot) {
+                plot->setRange(cmd.low, cmd.high);
+            }
+            break;
+        case UiCommand::Op::ClearPlot:
+            if (plot) {
+                plot->clear();
+            }
+            break;
+        case UiCommand::Op::Remove: {
+            // Erased from widgets in one pass once the batch is applied
+            VisibleComponent* widget = it->second.widget;
+            widget->invalidate();
+            telemetry->forget_widget(widget);
+            forget_widget(widget);
+            scripted_widgets.erase(it);
+            removed.insert(widget);
+            break;
+        }
+        case UiCommand::Op::CreateLabel:
+        case UiCommand::Op::CreatePlot:
+        case UiCommand::Op::CreateImage:
+            break;
+    }
+}
+
+bool WindowService::redraw() {
+    if (damage.empty() && exposed.empty()) {
+        return false;
+    }
+    auto frame_start = std::chrono::steady_clock::now();
+    ensure_back_buffer();
+
+    if (!damage.empty()) {
+        // A box-clipping canvas clears the whole box, so every widget in it repaints
+        if (!canvas->exactClip()) {
+            damage.flatten();
+        }
+        // Repaint only the damaged area of the back buffer
+        Region clip = damage.region();
+        XRectangle box = damage.bounds();
+        canvas->setClip(clip);
+        canvas->fillRect(box.x, box.y, box.width, box.height, *background);
+
+        widget_samples.clear();
         for (const auto& widget : widgets) {
-            widget->handleEvent(event);
-        }
-
-        switch (event.type) {
-            case Expose:
-                if (event.xexpose.count == 0) {
-                    std::cout << "Expose event: Redrawing window." << std::endl;
-                    redraw(ruby_output);
-                }
-                break;
-            case ConfigureNotify: { // Handle resize event
-                XConfigureEvent xce = event.xconfigure;
-                if (xce.width != window_width || xce.height != window_height) {
-                    window_width = xce.width;
-                    window_height = xce.height;
-                    std::cout << "Window resized to " << window_width << "x" << window_height << "." << std::endl;
-                    redraw(ruby_output);
-                }
-                break;
-            }
-            case KeyPress:
-                std::cout << "KeyPress event received." << std::endl;
-                done = handle_key_press(event, ruby_output);
-                break;
-            case ButtonPress:
-            case MotionNotify:
-                // Optional: handle pointer events
-                break;
-            case MappingNotify:
-                XRefreshKeyboardMapping(&event.xmapping);
-                break;
-            default:
-                break;
-        }
-    }
-    std::cout << "Exiting main loop." << std::endl;
-}
-
-void WindowService::redraw(const std::string& ruby_output) {
-    if (inputLabel) {
-        inputLabel->setText(text_buffer);
-        std::cout << "Updated inputLabel text: " << inputLabel->getText() << std::endl;
-    }
-    if (resultLabel) {
-        resultLabel->setText(ruby_output);
-        std::cout << "Updated resultLabel text: " << resultLabel->getText() << std::endl;
-    }
-
-    // Use member variables for window dimensions
-    int win_width = window_width;
-    int win_height = window_height;
-
-    // Создание оффскрин Pixmap с использованием RAII
-    PixmapHolder buffer(display.get(), window, win_width, win_height, DefaultDepth(display.get(), screen));
-    std::cout << "Created offscreen Pixmap." << std::endl;
-
-    // Заполнение фона
-    XSetForeground(display.get(), gc, WhitePixel(display.get(), screen));
-    XFillRectangle(display.get(), buffer.get(), gc, 0, 0, win_width, win_height);
-    std::cout << "Filled background with white." << std::endl;
-
-    // Рисование всех виджетов
-    for (const auto& widget : widgets) {
-        widget->draw(buffer.get());
-    }
-    std::cout << "All widgets drawn to Pixmap." << std::endl;
-
-    // Копирование буфера в окно
-    XCopyArea(display.get(), buffer.get(), window, gc, 0, 0, win_width, win_height, 0, 0);
-    XFlush(display.get());
-    std::cout << "Copied Pixmap to window and flushed display." << std::endl;
-}
-
-bool WindowService::handle_key_press(XEvent& event, std::string& ruby_output) {
+            if (damage.intersects(widget->bounds())) {
+                auto draw_start = std::chrono::steady_clock::now();
+                widget->draw(*canvas, clip);
+                auto elapsed = std::chrono::steady_clock::now() - draw_start;
+                widget_samples.push_back({ widget.get(), widget->typeName(),
+                    static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) });
+            }
+        }
+        telemetry->record_widget_draws(widget_samples);
+    }
+
+    // Present repainted and exposed areas only
+    exposed.add(damage);
+    {
+        // The software canvas uploads here, so the upload counts as flush time
+        ScopedTimer flush_timer(telemetry.get(), Metric::XFlush);
+        canvas->present(window, gc, exposed.region());
+        XFlush(display.get());
+    }
+
+    damage.clear();
+    exposed.clear();
+    telemetry->record(Metric::Frame, std::chrono::steady_clock::now() - frame_start);
+    return true;
+}
+
+void WindowService::toggle_profiling() {
+    if (!profiling) {
+        ruby_service->profile_folded(true); // Drop samples from an earlier session
+        ruby_service->start_profiling(std::chrono::microseconds(1000));
+        profiling = true;
+        return;
+    }
+    ruby_service->stop_profiling();
+    profiling = false;
+    const char* path = std::getenv("MODERNX_PROFILE");
+    std::string target = path ? path : "modernx.folded";
+    std::ofstream out(target);
+    out << ruby_service->profile_folded(true);
+    if (out) {
+        LOG_INFO(Window, "Ruby profile written to %s.", target.c_str());
+    } else {
+        LOG_ERROR(Window, "Failed to write Ruby profile to %s.", target.c_str());
+    }
+}
+
+bool WindowService::handle_key_press(XEvent& event) {
     char buf[32] = {0};
     KeySym key;
     int len = XLookupString(&event.xkey, buf, sizeof(buf), &key, nullptr);
+    unsigned int state = event.xkey.state;
+    bool ctrl = (state & ControlMask) != 0;
+    LOG_TRACE(Window, "KeyPress: KeySym=%lu, state=%u", static_cast<unsigned long>(key), state);
 
-    if (len > 0) {
-        std::cout << "KeyPress: KeySym=" << key << ", KeyString=" << buf << std::endl;
+    if (key == XK_F12 && perfOverlay) {
+        perfOverlay->setVisible(!perfOverlay->isVisible());
+        return false;
+    }
+    if (key == XK_F11) {
+        toggle_profiling();
+        return false;
+    }
+    if (ctrl && (key == XK_q || key == XK_Q)) {
+        LOG_INFO(Window, "Pressed Ctrl+Q. Exiting application.");
+        return true; // Exit the main loop
+    }
+
+    if ((key == XK_Return || key == XK_KP_Enter) && !(state & ShiftMask)) {
+        // Shift+Enter falls through to the editor as a new line
+        LOG_DEBUG(Window, "Pressed Enter. Executing Ruby code.");
+        evaluate_input();
+    } else if (key == XK_Escape) {
+        if (pending_eval != 0 && ruby_service->cancel(pending_eval)) {
+            LOG_INFO(Window, "Pressed Escape. Cancelling Ruby evaluation.");
+        }
+    } else if (ctrl && (key == XK_v || key == XK_V)) {
+        request_paste();
+    } else if (inputEditor && focus == inputEditor) {
+        // The editor damages only the lines an edit touches
+        inputEditor->handleKey(key, state, buf, len);
+    }
+    return false; // Do not exit
+}
 
-        if (key == XK_q) {
-            std::cout << "Pressed 'q'. Exiting application." << std::endl;
-            return true; // Exit the main loop
+void WindowService::evaluate_input() {
+    if (pending_eval != 0) {
+        LOG_INFO(Window, "Ruby evaluation still running; press Escape to cancel.");
+        return;
+    }
+    if (!inputEditor) {
+        return;
+    }
+    if (resultView) {
+        resultView->setText("Evaluating...");
+    }
+    awaiting_first_chunk = true;
+    // Chunks arrive from dispatch_completions() on this thread; the view only
+    // lays out what scrolls into sight, so large results stay cheap
+    pending_eval = ruby_service->execute_streaming(inputEditor->text(), inspect_limits,
+                                                   [this](const std::string& chunk, bool last) {
+        if (awaiting_first_chunk) {
+            awaiting_first_chunk = false;
+            if (resultView) {
+                resultView->clear();
+            }
         }
-        if (key == XK_BackSpace && !text_buffer.empty()) {
-            text_buffer.pop_back();
-            std::cout << "Pressed BackSpace. Current text_buffer: " << text_buffer << std::endl;
+        if (resultView) {
+            resultView->append(chunk);
         }
-        else if (key == XK_Return) {
-            std::cout << "Pressed Enter. Executing Ruby code." << std::endl;
-            ruby_output = ruby_service->execute_code(text_buffer);
-            std::cout << "Ruby execution output: " << ruby_output << std::endl;
+        if (last) {
+            pending_eval = 0;
+            LOG_DEBUG(Window, "Ruby evaluation finished (%zu result lines).",
+                      resultView ? resultView->lineCount() : size_t(0));
         }
-        else {
-            text_buffer.append(buf, len);
-            std::cout << "Updated text_buffer: " << text_buffer << std::endl;
+    });
+}
+
+void WindowService::request_paste() {
+    // The owner answers with SelectionNotify once the text is in paste_property
+    XConvertSelection(display.get(), clipboard_atom, utf8_atom, paste_property, window, CurrentTime);
+}
+
+void WindowService::finish_paste(const XSelectionEvent& event) {
+    if (event.property == None || !inputEditor) {
+        return; // Nobody owns the clipboard, or it has no text
+    }
+    Atom type;
+    int format;
+    unsigned long items = 0;
+    unsigned long remaining = 0;
+    unsigned char* data = nullptr;
+    // Length is in 32-bit units: ask for everything in one round trip
+    if (XGetWindowProperty(display.get(), window, event.property, 0, 0x1000000, True, AnyPropertyType,
+                           &type, &format, &items, &remaining, &data) != Success) {
+        return;
+    }
+    if (type == incr_atom) {
+        // Too large for one property: deleting it (done by the read above)
+        // asks the owner for the first chunk, announced by PropertyNotify
+        paste_incr = true;
+        paste_buffer.clear();
+        LOG_DEBUG(Window, "Clipboard arrives incrementally.");
+    } else if (data && format == 8) {
+        inputEditor->insert(std::string(reinterpret_cast<const char*>(data), items));
+        LOG_DEBUG(Window, "Pasted %lu bytes.", items);
+    } else {
+        LOG_WARN(Window, "Clipboard contents not pasteable (format %d).", format);
+    }
+    if (data) {
+        XFree(data);
+    }
+}
+
+void WindowService::continue_paste() {
+    Atom type;
+    int format;
+    unsigned long items = 0;
+    unsigned long remaining = 0;
+    unsigned char* data = nullptr;
+    // Deleting each chunk asks for the next one
+    if (XGetWindowProperty(display.get(), window, paste_property, 0, 0x1000000, True, AnyPropertyType,
+                           &type, &format, &items, &remaining, &data) != Success) {
+        paste_incr = false;
+        LOG_WARN(Window, "Incremental paste failed.");
+        return;
+    }
+    if (items == 0) {
+        // An empty chunk ends the transfer
+        paste_incr = false;
+        if (inputEditor) {
+            inputEditor->insert(paste_buffer);
+            LOG_DEBUG(Window, "Pasted %zu bytes incrementally.", paste_buffer.size());
         }
-        redraw(ruby_output);
+        std::string().swap(paste_buffer);
+    } else if (data && format == 8 && paste_buffer.size() + items <= kMaxPasteBytes) {
+        paste_buffer.append(reinterpret_cast<const char*>(data), items);
+    } else {
+        // Chunks left unread stall the owner, which then gives up on its own
+        paste_incr = false;
+        std::string().swap(paste_buffer);
+        LOG_WARN(Window, "Incremental paste abandoned: format %d, or over %zu bytes.", format, kMaxPasteBytes);
+    }
+    if (data) {
+        XFree(data);
     }
-    return false; // Do not exit
 }
 
 void WindowService::draw_at_pointer(const XEvent& event) {
     // Реализовать при необходимости
-    std::cout << "draw_at_pointer called." << std::endl;
+    LOG_TRACE(Window, "draw_at_pointer called.");
 }
\ No newline at end of file
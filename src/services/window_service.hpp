@@ -1,13 +1,31 @@
 #pragma once
 #include "interfaces/iwindow_service.hpp"
 #include "interfaces/iruby_service.hpp"
+#include "interfaces/iresource_cache.hpp"
+#include "interfaces/iimage_cache.hpp"
 #include <X11/Xlib.h>
 #include <X11/Xft/Xft.h>
 #include <memory>
 #include <string>
 #include <vector>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
 #include "../gui/visible_component.hpp"
+#include "../gui/canvas.hpp"
+#include "../gui/damage_tracker.hpp"
+#include "../gui/widget_grid.hpp"
+#include "../gui/perf_overlay.hpp"
+#include "../gui/ui_command_buffer.hpp"
+#include "../core/telemetry.hpp"
+#include "../core/reactor.hpp"
+#include "event_trace.hpp"
 #include "../gui/label.hpp" // For using Label
+#include "../gui/text_editor.hpp"
+#include "../gui/output_view.hpp"
+#include "../gui/plot.hpp"
+#include "../gui/image.hpp"
 #include "../utils/x11_raii.hpp"
 
 struct DisplayDeleter {
@@ -16,51 +34,217 @@ struct DisplayDeleter {
     }
 };
 
+// Counters for the batched event loop
+struct EventLoopStats {
+    uint64_t batches = 0;
+    uint64_t events_handled = 0;
+    uint64_t events_coalesced = 0;
+    uint64_t frames_rendered = 0;
+    size_t last_batch_events = 0;
+    size_t last_batch_frames = 0;
+    size_t max_batch_events = 0;
+    double first_frame_ms = 0.0; // From the launch time to the first frame on screen
+};
+
+// How a recorded trace is fed back in
+struct ReplayOptions {
+    bool original_timing = false; // Wait out the recorded gaps instead of running flat out
+    bool checksum = false;        // Hash the final frame's pixels
+    // Evaluations the trace started get this long to finish before the final frame
+    std::chrono::milliseconds settle_timeout{5000};
+};
+
+struct ReplayReport {
+    size_t events = 0;
+    uint64_t frames = 0;
+    std::vector<double> latency_us; // Per event: dispatch plus the frame it caused
+    double wall_ms = 0.0;
+    uint64_t checksum = 0;          // Set with ReplayOptions::checksum
+};
+
 class WindowService : public IWindowService {
 public:
-    WindowService(std::shared_ptr<IRubyService> ruby_service);
+    WindowService(std::shared_ptr<IRubyService> ruby_service,
+                  std::shared_ptr<IResourceCache> resources,
+                  std::shared_ptr<Telemetry> telemetry = std::make_shared<Telemetry>(),
+                  RenderBackend backend = RenderBackend::Xft,
+                  std::shared_ptr<Reactor> reactor = nullptr);
     ~WindowService() override;
     void run() override;
 
     Display* getDisplay() const { return display.get(); }
     Window getWindow() const { return window; }
     GC getGC() const { return gc; } // Добавленный метод
+    IResourceCache& getResources() const { return *resources; }
+    // May differ from the requested one when the display cannot support it
+    RenderBackend getRenderBackend() const { return canvas->backend(); }
+    // Loop driving run(); services add their own fds, timers and idle work here
+    Reactor& getReactor() const { return *reactor; }
 
-    // Методы для установки меток
-    void setInputLabel(std::unique_ptr<Label> label);
-    void setResultLabel(std::unique_ptr<Label> label);
+    // Поле ввода кода и область результата
+    void setInputEditor(std::unique_ptr<TextEditor> editor);
+    void setResultView(std::unique_ptr<OutputView> view);
+    // Caps for streamed results shown in the result view
+    void set_inspect_limits(const InspectLimits& limits) { inspect_limits = limits; }
 
     // Метод для добавления виджетов
     void addWidget(std::unique_ptr<VisibleComponent> widget);
+    // Topmost widget at x, y handling any of mask; nullptr if none
+    VisibleComponent* widgetAt(int x, int y, long mask) const { return event_index.at(x, y, mask); }
+    // Receives key events; clicking a widget that handles keys moves it there
+    void setFocus(VisibleComponent* widget) { focus = widget; }
+    // Statistics overlay, toggled with F12
+    void setPerfOverlay(std::unique_ptr<PerfOverlay> overlay);
+    // Widget mutations recorded by scripts, applied once per frame
+    void setCommandBuffer(std::shared_ptr<UiCommandBuffer> commands);
+    // For a service constructed without one; must be set before run()
+    void setRubyService(std::shared_ptr<IRubyService> ruby) { ruby_service = std::move(ruby); }
+    // Decoded images for Image widgets; attached to this display and renderer
+    void setImageCache(std::shared_ptr<IImageCache> images);
+    IImageCache& getImages() const { return *images; }
+
+    // Upper bound on time spent draining events before a frame is rendered
+    void set_frame_budget(std::chrono::microseconds budget);
+    // Longest single Ruby GC slice run while the loop is idle; zero disables idle GC
+    void set_idle_gc_slice(std::chrono::microseconds slice) { idle_gc_slice = slice; }
+    // Minimum time between frames rendered by run(); damage arriving sooner waits for the next one
+    void set_frame_interval(std::chrono::microseconds interval) { frame_interval = interval; }
+    const EventLoopStats& get_loop_stats() const { return loop_stats; }
+    // Start of time-to-first-frame; defaults to when the service was constructed
+    void set_launch_time(std::chrono::steady_clock::time_point time) { launch_time = time; }
+
+    // Entry points for drivers without a main loop (benchmarks, replay).
+    // dispatch_event handles one event as its own batch and returns true on quit.
+    bool dispatch_event(XEvent& event);
+    bool render_frame();
+    // Writes every input event run() handles to path until the service goes away
+    void record_events(const std::string& path);
+    // Drives the window from a trace through the same dispatch and redraw path
+    ReplayReport replay(EventTraceReader& trace, const ReplayOptions& options);
+    uint64_t frame_checksum() { return canvas->checksum(); }
+    void invalidate_all();
+    void resize(int width, int height);
 
 private:
     std::shared_ptr<IRubyService> ruby_service;
+    std::shared_ptr<IResourceCache> resources;
+    std::shared_ptr<IImageCache> images;
+    std::shared_ptr<Telemetry> telemetry;
+    std::shared_ptr<Reactor> reactor;
     std::unique_ptr<Display, DisplayDeleter> display;
     Window window;
     GC gc;
     int screen;
-    std::string text_buffer;
+    std::string ruby_output;
+    InspectLimits inspect_limits;
+    bool awaiting_first_chunk = false;
+    // Evaluation currently running on the Ruby worker, 0 when idle
+    IRubyService::EvalId pending_eval = 0;
     int window_width;
     int window_height;
 
     Visual* visual;
     Colormap colormap;
-    XftFont* font_;
-    XftColor color_;
-    XftDrawPtr draw;
+
+    // Clipboard paste (Ctrl+V): CLIPBOARD converted to UTF8_STRING into paste_property
+    Atom clipboard_atom;
+    Atom utf8_atom;
+    Atom paste_property;
+    // Large selections come as INCR: chunks are collected here until an empty one
+    static constexpr size_t kMaxPasteBytes = 64 * 1024 * 1024;
+    Atom incr_atom;
+    bool paste_incr = false;
+    std::string paste_buffer;
+
+    // Back buffer persists across frames; reallocated only on resize
+    std::unique_ptr<Canvas> canvas;
+    int back_buffer_width = 0;
+    int back_buffer_height = 0;
+    ColorHandle background;
+
+    // Areas to repaint into the back buffer / areas only to re-copy to the window
+    DamageTracker damage;
+    DamageTracker exposed;
+
+    std::chrono::microseconds frame_budget{16000};
+    std::chrono::microseconds idle_gc_slice{2000};
+    // Set while an idle callback is collecting after Ruby ran
+    bool gc_pending = false;
+    // Frame pacing, only while run() drives the loop
+    bool paced = false;
+    std::chrono::microseconds frame_interval{16000};
+    std::chrono::steady_clock::time_point last_frame;
+    Reactor::TimerId frame_timer = 0;
+    EventLoopStats loop_stats;
+    std::chrono::steady_clock::time_point launch_time = std::chrono::steady_clock::now();
+    bool profiling = false;
+    std::unique_ptr<EventTraceWriter> trace_writer;
+
+    // State merged across one batch of events
+    struct EventBatch {
+        size_t events = 0;
+        size_t coalesced = 0;
+        bool resized = false;
+        bool has_configure = false;
+        bool has_expose = false;
+        bool has_motion = false;
+        XEvent last_motion;
+    };
 
     // Контейнер для виджетов, управляемых через unique_ptr
     std::vector<std::unique_ptr<VisibleComponent>> widgets;
 
-    // Указатели на метки
-    Label* inputLabel = nullptr;
-    Label* resultLabel = nullptr;
+    // Указатели на поле ввода и область результата
+    TextEditor* inputEditor = nullptr;
+    OutputView* resultView = nullptr;
+    PerfOverlay* perfOverlay = nullptr;
+
+    // Widgets with a non-empty eventMask(), by bounds
+    WidgetGrid event_index;
+    VisibleComponent* focus = nullptr;
+    // Widget that took the last ButtonPress; gets motion and release until all buttons are up
+    VisibleComponent* pointer_grab = nullptr;
+    std::vector<VisibleComponent*> event_listeners; // Scratch for non-pointer events
+
+    // Reused every frame to hand per-widget draw times to telemetry
+    std::vector<Telemetry::WidgetSample> widget_samples;
+
+    // Widgets created from Ruby, by script-side id
+    std::shared_ptr<UiCommandBuffer> ui_commands;
+    std::vector<UiCommand> ui_batch;
+    struct ScriptedWidget {
+        VisibleComponent* widget;
+        Label* label = nullptr; // Exactly one of label, plot, image is set
+        Plot* plot = nullptr;
+        Image* image = nullptr;
+    };
+    std::unordered_map<uint32_t, ScriptedWidget> scripted_widgets;
 
     void create_window();
     void setup_gc();
     void setup_xft();
-    void main_loop(std::string& ruby_output);
-    void redraw(const std::string& ruby_output);
-    bool handle_key_press(XEvent& event, std::string& ruby_output);
+    void setup_canvas(RenderBackend backend);
+    void ensure_back_buffer();
+    void load_startup_script();
+    void main_loop();
+    // Delivers finished evaluations without running the main loop
+    bool pump_completions(std::chrono::milliseconds timeout);
+    void request_idle_gc();
+    bool frame_due();
+    bool process_event(XEvent& event, EventBatch& batch);
+    bool finish_batch(EventBatch& batch);
+    void dispatch_to_widgets(XEvent& event);
+    void forget_widget(VisibleComponent* widget);
+    void apply_ui_commands();
+    void apply_ui_command(UiCommand& cmd, std::unordered_set<const VisibleComponent*>& removed);
+    bool redraw();
+    bool handle_key_press(XEvent& event);
+    // F11: start sampling Ruby, or stop and write folded stacks to $MODERNX_PROFILE
+    void toggle_profiling();
+    void place_perf_overlay();
+    void evaluate_input();
+    void request_paste();
+    void finish_paste(const XSelectionEvent& event);
+    void continue_paste();
     void draw_at_pointer(const XEvent& event);
 };
\ No newline at end of file
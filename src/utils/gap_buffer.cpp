@@ -0,0 +1,80 @@
+#include "gap_buffer.hpp"
+#include <algorithm>
+#include <cstring>
+
+void GapBuffer::insert(size_t pos, const char* text, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    pos = std::min(pos, size());
+    move_gap(pos);
+    reserve_gap(length);
+    std::memcpy(data.data() + gap_begin, text, length);
+    gap_begin += length;
+}
+
+void GapBuffer::erase(size_t pos, size_t length) {
+    if (pos >= size()) {
+        return;
+    }
+    length = std::min(length, size() - pos);
+    move_gap(pos);
+    gap_end += length; // The erased bytes simply join the gap
+}
+
+void GapBuffer::clear() {
+    gap_begin = 0;
+    gap_end = data.size();
+}
+
+void GapBuffer::copy(size_t pos, size_t length, std::string& out) const {
+    out.clear();
+    if (pos >= size()) {
+        return;
+    }
+    length = std::min(length, size() - pos);
+    out.reserve(length);
+    size_t end = pos + length;
+    if (pos < gap_begin) {
+        size_t before = std::min(end, gap_begin);
+        out.append(data.data() + pos, before - pos);
+        pos = before;
+    }
+    if (pos < end) {
+        out.append(data.data() + pos + gap_size(), end - pos);
+    }
+}
+
+std::string GapBuffer::text() const {
+    std::string out;
+    copy(0, size(), out);
+    return out;
+}
+
+void GapBuffer::move_gap(size_t pos) {
+    if (pos < gap_begin) {
+        size_t count = gap_begin - pos;
+        std::memmove(data.data() + gap_end - count, data.data() + pos, count);
+        gap_begin -= count;
+        gap_end -= count;
+    } else if (pos > gap_begin) {
+        size_t count = pos - gap_begin;
+        std::memmove(data.data() + gap_begin, data.data() + gap_end, count);
+        gap_begin += count;
+        gap_end += count;
+    }
+}
+
+void GapBuffer::reserve_gap(size_t length) {
+    if (gap_size() >= length) {
+        return;
+    }
+    // Grow geometrically so a run of keystrokes or a large paste stays amortised O(1) per byte
+    size_t tail = data.size() - gap_end;
+    size_t capacity = std::max(data.size() * 2, size() + length + 64);
+    std::vector<char> grown(capacity);
+    std::memcpy(grown.data(), data.data(), gap_begin);
+    std::memcpy(grown.data() + capacity - tail, data.data() + gap_end, tail);
+    gap_end = capacity - tail;
+    data.swap(grown);
+}
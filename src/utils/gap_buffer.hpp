@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Byte buffer with a movable gap at the edit point: inserting or erasing next
+// to the previous edit is O(edit size), moving the gap is O(distance).
+class GapBuffer {
+public:
+    size_t size() const { return data.size() - gap_size(); }
+    bool empty() const { return size() == 0; }
+
+    char at(size_t pos) const { return pos < gap_begin ? data[pos] : data[pos + gap_size()]; }
+
+    void insert(size_t pos, const char* text, size_t length);
+    void insert(size_t pos, const std::string& text) { insert(pos, text.data(), text.size()); }
+    void erase(size_t pos, size_t length);
+    void clear();
+
+    // Copies [pos, pos + length) into out without moving the gap
+    void copy(size_t pos, size_t length, std::string& out) const;
+    std::string text() const;
+
+private:
+    std::vector<char> data;
+    size_t gap_begin = 0;
+    size_t gap_end = 0;
+
+    size_t gap_size() const { return gap_end - gap_begin; }
+    void move_gap(size_t pos);
+    void reserve_gap(size_t length);
+};
@@ -0,0 +1,47 @@
+#include "line_store.hpp"
+#include <algorithm>
+#include <cstring>
+
+void LineStore::append(const char* data, size_t length) {
+    const char* end = data + length;
+    while (data < end) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', static_cast<size_t>(end - data)));
+        const char* stop = newline ? newline : end;
+        chunks.back().text.append(data, static_cast<size_t>(stop - data));
+        total_bytes += static_cast<size_t>(stop - data);
+        if (!newline) {
+            break;
+        }
+        // Start the next line, in a fresh chunk once this one is full
+        Chunk& current = chunks.back();
+        if (current.text.size() >= kChunkBytes) {
+            first_line.push_back(first_line.back() + current.starts.size());
+            chunks.emplace_back();
+            chunks.back().text.reserve(kChunkBytes);
+            chunks.back().starts.push_back(0);
+        } else {
+            current.starts.push_back(static_cast<uint32_t>(current.text.size()));
+        }
+        data = newline + 1;
+    }
+}
+
+void LineStore::clear() {
+    chunks.assign(1, Chunk());
+    chunks.back().starts.push_back(0);
+    first_line.assign(1, 0);
+    total_bytes = 0;
+}
+
+std::string_view LineStore::line(size_t index) const {
+    auto it = std::upper_bound(first_line.begin(), first_line.end(), index);
+    size_t chunk_index = static_cast<size_t>(it - first_line.begin()) - 1;
+    const Chunk& chunk = chunks[chunk_index];
+    size_t local = index - first_line[chunk_index];
+    if (local >= chunk.starts.size()) {
+        return std::string_view();
+    }
+    size_t begin = chunk.starts[local];
+    size_t end = local + 1 < chunk.starts.size() ? chunk.starts[local + 1] : chunk.text.size();
+    return std::string_view(chunk.text).substr(begin, end - begin);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Append-only text split into lines, kept in chunks of about kChunkBytes so
+// growing output never reallocates (or copies) what is already stored.
+// Newlines are not stored; a line never spans two chunks.
+class LineStore {
+public:
+    LineStore() { clear(); }
+
+    void append(const char* data, size_t length);
+    void append(const std::string& text) { append(text.data(), text.size()); }
+    void clear();
+
+    // Number of lines, counting the (possibly empty) line being appended to
+    size_t size() const { return first_line.back() + chunks.back().starts.size(); }
+    size_t bytes() const { return total_bytes; }
+    std::string_view line(size_t index) const;
+
+private:
+    static constexpr size_t kChunkBytes = 64 * 1024;
+
+    struct Chunk {
+        std::string text;
+        std::vector<uint32_t> starts; // Offset of each line within text
+    };
+    std::vector<Chunk> chunks;
+    std::vector<size_t> first_line; // Index of each chunk's first line
+    size_t total_bytes = 0;
+};
@@ -0,0 +1,277 @@
+#include "log.hpp"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace logging {
+
+std::atomic<uint8_t> thresholds[static_cast<int>(LogSubsystem::Count)] = {
+    {static_cast<uint8_t>(LogLevel::Info)},
+    {static_cast<uint8_t>(LogLevel::Info)},
+    {static_cast<uint8_t>(LogLevel::Info)},
+    {static_cast<uint8_t>(LogLevel::Info)},
+    {static_cast<uint8_t>(LogLevel::Info)},
+};
+
+namespace {
+
+const char* const kLevelNames[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "OFF" };
+const char* const kSubsystemNames[] = { "app", "window", "gui", "ruby", "container" };
+
+// Bounded multi-producer/single-consumer queue (Vyukov): producers claim a
+// slot with one CAS and format straight into it, the writer drains in order.
+class RingBuffer {
+public:
+    static constexpr size_t kCapacity = 1024; // power of two
+    static constexpr size_t kMessageSize = 240;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        uint64_t timestamp_us;
+        LogSubsystem subsystem;
+        LogLevel level;
+        char text[kMessageSize];
+    };
+
+    RingBuffer() {
+        for (size_t i = 0; i < kCapacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    Slot* claim() {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[pos & (kCapacity - 1)];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return &slot;
+                }
+            } else if (diff < 0) {
+                return nullptr; // Full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void publish(Slot* slot) {
+        size_t seq = slot->sequence.load(std::memory_order_relaxed);
+        slot->sequence.store(seq + 1, std::memory_order_release);
+    }
+
+    Slot* peek() {
+        Slot& slot = slots[dequeue_pos & (kCapacity - 1)];
+        size_t seq = slot.sequence.load(std::memory_order_acquire);
+        return seq == dequeue_pos + 1 ? &slot : nullptr;
+    }
+
+    void release(Slot* slot) {
+        slot->sequence.store(dequeue_pos + kCapacity, std::memory_order_release);
+        ++dequeue_pos;
+    }
+
+private:
+    std::array<Slot, kCapacity> slots;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) size_t dequeue_pos = 0; // Writer thread only
+};
+
+class Writer {
+public:
+    Writer() : started(std::chrono::steady_clock::now()) {
+        thread = std::thread(&Writer::run, this);
+    }
+
+    ~Writer() { stop(); }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                return;
+            }
+            stopping = true;
+        }
+        cv.notify_one();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    bool running() const { return !stopping_flag.load(std::memory_order_seq_cst); }
+
+    uint64_t now_us() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started).count();
+    }
+
+    void wake() { cv.notify_one(); }
+
+    RingBuffer ring;
+    std::atomic<uint64_t> dropped{0};
+    // Threads between their running() check and publish; the final drain waits for them
+    std::atomic<int> producers{0};
+
+private:
+    std::chrono::steady_clock::time_point started;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::atomic<bool> stopping_flag{false};
+    uint64_t reported_drops = 0;
+
+    void run() {
+        for (;;) {
+            bool exiting;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait_for(lock, std::chrono::milliseconds(20));
+                exiting = stopping;
+            }
+            drain();
+            if (exiting) {
+                stopping_flag.store(true, std::memory_order_seq_cst);
+                // A producer that saw running() before the flip may still be
+                // formatting; its message would land after the last drain
+                while (producers.load(std::memory_order_seq_cst) != 0) {
+                    std::this_thread::yield();
+                }
+                drain(); // Anything published while we were switching over
+                return;
+            }
+        }
+    }
+
+    void drain() {
+        bool wrote_out = false;
+        bool wrote_err = false;
+        while (RingBuffer::Slot* slot = ring.peek()) {
+            FILE* stream = slot->level >= LogLevel::Warn ? stderr : stdout;
+            std::fprintf(stream, "[%8.3f] %-5s %s: %s\n",
+                         static_cast<double>(slot->timestamp_us) / 1e6,
+                         kLevelNames[static_cast<int>(slot->level)],
+                         kSubsystemNames[static_cast<int>(slot->subsystem)],
+                         slot->text);
+            (stream == stderr ? wrote_err : wrote_out) = true;
+            ring.release(slot);
+        }
+        if (wrote_out) {
+            std::fflush(stdout);
+        }
+        if (wrote_err) {
+            std::fflush(stderr);
+        }
+        uint64_t total = dropped.load(std::memory_order_relaxed);
+        if (total > reported_drops) {
+            std::fprintf(stderr, "[logging] %llu messages dropped (ring buffer full)\n",
+                         static_cast<unsigned long long>(total - reported_drops));
+            reported_drops = total;
+        }
+    }
+};
+
+Writer& writer() {
+    static Writer instance;
+    return instance;
+}
+
+bool parse_level(const std::string& name, LogLevel& level) {
+    for (int i = 0; i <= static_cast<int>(LogLevel::Off); ++i) {
+        if (strcasecmp(name.c_str(), kLevelNames[i]) == 0) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+void write(LogSubsystem subsystem, LogLevel level, const char* format, ...) {
+    Writer& w = writer();
+    va_list args;
+    va_start(args, format);
+    w.producers.fetch_add(1, std::memory_order_seq_cst);
+    if (!w.running()) {
+        w.producers.fetch_sub(1, std::memory_order_seq_cst);
+        // After shutdown (static destructors) fall back to a direct write
+        std::vfprintf(stderr, format, args);
+        std::fputc('\n', stderr);
+        va_end(args);
+        return;
+    }
+
+    RingBuffer::Slot* slot = w.ring.claim();
+    if (!slot) {
+        w.producers.fetch_sub(1, std::memory_order_seq_cst);
+        va_end(args);
+        w.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    slot->timestamp_us = w.now_us();
+    slot->subsystem = subsystem;
+    slot->level = level;
+    std::vsnprintf(slot->text, RingBuffer::kMessageSize, format, args);
+    va_end(args);
+    w.ring.publish(slot);
+    w.producers.fetch_sub(1, std::memory_order_seq_cst);
+
+    if (level >= LogLevel::Error) {
+        w.wake();
+    }
+}
+
+void set_level(LogSubsystem subsystem, LogLevel level) {
+    thresholds[static_cast<int>(subsystem)].store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+void configure(const char* spec) {
+    std::string text(spec);
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string item = text.substr(start, end - start);
+        size_t eq = item.find('=');
+        LogLevel level;
+        if (eq == std::string::npos) {
+            // Bare level applies to every subsystem
+            if (parse_level(item, level)) {
+                for (int i = 0; i < static_cast<int>(LogSubsystem::Count); ++i) {
+                    set_level(static_cast<LogSubsystem>(i), level);
+                }
+            }
+        } else if (parse_level(item.substr(eq + 1), level)) {
+            std::string name = item.substr(0, eq);
+            for (int i = 0; i < static_cast<int>(LogSubsystem::Count); ++i) {
+                if (name == kSubsystemNames[i]) {
+                    set_level(static_cast<LogSubsystem>(i), level);
+                }
+            }
+        }
+        start = end + 1;
+    }
+}
+
+uint64_t dropped() {
+    return writer().dropped.load(std::memory_order_relaxed);
+}
+
+void shutdown() {
+    writer().stop();
+}
+
+} // namespace logging
@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Compile-time floor: calls below MODERNX_LOG_LEVEL expand to nothing.
+#define MODERNX_LOG_LEVEL_TRACE 0
+#define MODERNX_LOG_LEVEL_DEBUG 1
+#define MODERNX_LOG_LEVEL_INFO  2
+#define MODERNX_LOG_LEVEL_WARN  3
+#define MODERNX_LOG_LEVEL_ERROR 4
+#define MODERNX_LOG_LEVEL_OFF   5
+
+#ifndef MODERNX_LOG_LEVEL
+#ifdef NDEBUG
+#define MODERNX_LOG_LEVEL MODERNX_LOG_LEVEL_INFO
+#else
+#define MODERNX_LOG_LEVEL MODERNX_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+enum class LogLevel : uint8_t { Trace, Debug, Info, Warn, Error, Off };
+enum class LogSubsystem : uint8_t { App, Window, Gui, Ruby, Container, Count };
+
+namespace logging {
+
+// Runtime threshold per subsystem (defaults to Info)
+extern std::atomic<uint8_t> thresholds[static_cast<int>(LogSubsystem::Count)];
+
+inline bool enabled(LogSubsystem subsystem, LogLevel level) {
+    return static_cast<uint8_t>(level) >=
+           thresholds[static_cast<int>(subsystem)].load(std::memory_order_relaxed);
+}
+
+// Formats into the lock-free ring buffer; never blocks the caller
+void write(LogSubsystem subsystem, LogLevel level, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+void set_level(LogSubsystem subsystem, LogLevel level);
+// Spec such as "debug" or "window=debug,ruby=warn" (main passes $MODERNX_LOG)
+void configure(const char* spec);
+
+// Messages dropped because the ring buffer was full
+uint64_t dropped();
+
+// Drains pending messages and stops the writer thread
+void shutdown();
+
+} // namespace logging
+
+#define MODERNX_LOG(subsystem, level, ...)                                  \
+    do {                                                                     \
+        if (logging::enabled(LogSubsystem::subsystem, LogLevel::level)) {    \
+            logging::write(LogSubsystem::subsystem, LogLevel::level, __VA_ARGS__); \
+        }                                                                    \
+    } while (0)
+
+#if MODERNX_LOG_LEVEL <= MODERNX_LOG_LEVEL_TRACE
+#define LOG_TRACE(subsystem, ...) MODERNX_LOG(subsystem, Trace, __VA_ARGS__)
+#else
+#define LOG_TRACE(subsystem, ...) ((void)0)
+#endif
+
+#if MODERNX_LOG_LEVEL <= MODERNX_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(subsystem, ...) MODERNX_LOG(subsystem, Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(subsystem, ...) ((void)0)
+#endif
+
+#if MODERNX_LOG_LEVEL <= MODERNX_LOG_LEVEL_INFO
+#define LOG_INFO(subsystem, ...) MODERNX_LOG(subsystem, Info, __VA_ARGS__)
+#else
+#define LOG_INFO(subsystem, ...) ((void)0)
+#endif
+
+#if MODERNX_LOG_LEVEL <= MODERNX_LOG_LEVEL_WARN
+#define LOG_WARN(subsystem, ...) MODERNX_LOG(subsystem, Warn, __VA_ARGS__)
+#else
+#define LOG_WARN(subsystem, ...) ((void)0)
+#endif
+
+#if MODERNX_LOG_LEVEL <= MODERNX_LOG_LEVEL_ERROR
+#define LOG_ERROR(subsystem, ...) MODERNX_LOG(subsystem, Error, __VA_ARGS__)
+#else
+#define LOG_ERROR(subsystem, ...) ((void)0)
+#endif